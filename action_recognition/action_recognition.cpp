@@ -1,6 +1,7 @@
 
 #include "action_recognition.hpp"
 #include <stdexcept>
+#include <algorithm>
 
 ActionRecognition::ActionRecognition(const std::string& model_path, int seg, int num_joint,
     int num_classes, int channels, int dev_id)
@@ -11,22 +12,21 @@ ActionRecognition::ActionRecognition(const std::string& model_path, int seg, int
     bm_ctx_ = std::make_shared<BMNNContext>(bm_handle, model_path.c_str());
     network_ = std::make_shared<BMNNNetwork>(bm_ctx_->bmrt(), bm_ctx_->network_name(0));
 
-    // ȡ״
-    input_shape_ = *network_->inputTensor(0)->get_shape();
-    output_shape_ = *network_->outputTensor(0)->get_shape();
-
-    // ֤״ [1, seg, num_joint * channels]
-    if (input_shape_.dims[0] != 1 || input_shape_.dims[1] != seg ||
-        input_shape_.dims[2] != num_joint * channels) {
-        throw std::runtime_error("Invalid SGN input shape, expected [1, " +
-            std::to_string(seg) + ", " +
-            std::to_string(num_joint * channels) + "]");
-    }
-
-    // ֤״ [1, num_classes]
-    if (output_shape_.dims[0] != 1 || output_shape_.dims[1] != num_classes) {
-        throw std::runtime_error("Invalid SGN output shape, expected [1, " +
-            std::to_string(num_classes) + "]");
+    //  stage ֤״ [N, seg, num_joint * channels] ״ [N, num_classes]
+    const bm_net_info_t* net_info = network_->m_netinfo;
+    for (int s = 0; s < net_info->stage_num; ++s) {
+        const bm_shape_t& input_shape = net_info->stages[s].input_shapes[0];
+        const bm_shape_t& output_shape = net_info->stages[s].output_shapes[0];
+        int batch = input_shape.dims[0];
+        if (input_shape.dims[1] != seg || input_shape.dims[2] != num_joint * channels) {
+            throw std::runtime_error("Invalid SGN input shape, expected [" + std::to_string(batch) + ", " +
+                std::to_string(seg) + ", " +
+                std::to_string(num_joint * channels) + "]");
+        }
+        if (output_shape.dims[0] != batch || output_shape.dims[1] != num_classes) {
+            throw std::runtime_error("Invalid SGN output shape, expected [" + std::to_string(batch) + ", " +
+                std::to_string(num_classes) + "]");
+        }
     }
 
     // ֤ labels_ ĴС num_classes һ
@@ -34,9 +34,18 @@ ActionRecognition::ActionRecognition(const std::string& model_path, int seg, int
         throw std::runtime_error("Labels size (" + std::to_string(labels_.size()) +
             ") does not match num_classes (" + std::to_string(num_classes) + ")");
     }
+
+    // Դ水 stage һΣʱ
+    max_batch_ = network_->maxBatch();
+    bm_status_t ret = bm_malloc_device_byte(bm_ctx_->handle(), &input_mem_,
+        max_batch_ * seg_ * num_joint_ * channels_ * sizeof(float));
+    if (ret != BM_SUCCESS) {
+        throw std::runtime_error("Failed to allocate SGN input memory");
+    }
 }
 
 ActionRecognition::~ActionRecognition() {
+    bm_free_device(bm_ctx_->handle(), input_mem_);
     // ͷԴ
     //if (bm_ctx_ && bm_ctx_->handle()) {
     //    // ȷ豸ڴͷ
@@ -58,49 +67,72 @@ ActionRecognition::~ActionRecognition() {
 }
 
 std::pair<std::string, float> ActionRecognition::infer(const std::vector<std::vector<cv::Point2f>>& frames_buffer) {
-    if (frames_buffer.size() < static_cast<size_t>(seg_)) {
-        return { "Tracking", 0.0f };
-    }
+    return infer(std::vector<const std::vector<std::vector<cv::Point2f>>*>{ &frames_buffer })[0];
+}
 
-    // ׼
-    std::vector<float> input_data(seg_ * num_joint_ * channels_);
-    for (int t = 0; t < seg_; ++t) {
-        for (int j = 0; j < num_joint_; ++j) {
-            input_data[t * num_joint_ * channels_ + j * channels_] = frames_buffer[t][j].x;
-            input_data[t * num_joint_ * channels_ + j * channels_ + 1] = frames_buffer[t][j].y;
-        }
-    }
+std::vector<std::pair<std::string, float>> ActionRecognition::infer(const std::vector<const std::vector<std::vector<cv::Point2f>>*>& frames_buffers) {
+    std::vector<std::pair<std::string, float>> results(frames_buffers.size(), { "Tracking", 0.0f });
 
-    // 豸ڴ沢
-    bm_device_mem_t input_mem;
-    bm_malloc_device_byte(bm_ctx_->handle(), &input_mem, input_shape_.dims[1] * input_shape_.dims[2] * sizeof(float));
-    bm_memcpy_s2d(bm_ctx_->handle(), input_mem, input_data.data());
-    network_->inputTensor(0)->set_device_mem(&input_mem);
-
-    // ִǰ
-    network_->forward();
-
-    // ȡ
-    std::vector<float> output_data(num_classes_);
-    bm_device_mem_t output_mem = *network_->outputTensor(0)->get_device_mem();
-    bm_memcpy_d2s(bm_ctx_->handle(), output_data.data(), output_mem);
-
-    // ҵʵ
-    float max_prob = output_data[0];
-    int max_idx = 0;
-    for (int i = 1; i < num_classes_; ++i) {
-        if (output_data[i] > max_prob) {
-            max_prob = output_data[i];
-            max_idx = i;
+    // гȲ seg Ŀ겻
+    std::vector<int> valid;
+    valid.reserve(frames_buffers.size());
+    for (size_t i = 0; i < frames_buffers.size(); ++i) {
+        if (frames_buffers[i]->size() >= static_cast<size_t>(seg_)) {
+            valid.push_back(i);
         }
     }
 
-    // ʹ labels_ Աȡǩ
-    std::string label = labels_[max_idx];
-    float prob = max_prob / (output_data[0] + output_data[1]);
+    const int frame_size = num_joint_ * channels_;
+    const int sample_size = seg_ * frame_size;
+    for (size_t start = 0; start < valid.size(); start += max_batch_) {
+        int num = std::min<int>(max_batch_, valid.size() - start);
+        // ѡ num С stage
+        int stage_batch = network_->select_stage(num);
+
+        // ׼
+        input_data_.assign(stage_batch * sample_size, 0.0f);
+        for (int b = 0; b < num; ++b) {
+            const auto& frames_buffer = *frames_buffers[valid[start + b]];
+            float* dst = input_data_.data() + b * sample_size;
+            for (int t = 0; t < seg_; ++t) {
+                for (int j = 0; j < num_joint_; ++j) {
+                    dst[t * frame_size + j * channels_] = frames_buffer[t][j].x;
+                    dst[t * frame_size + j * channels_ + 1] = frames_buffer[t][j].y;
+                }
+            }
+        }
 
-    // ͷ豸ڴ
-    bm_free_device(bm_ctx_->handle(), input_mem);
+        // ݵԤԴ
+        bm_memcpy_s2d_partial(bm_ctx_->handle(), input_mem_, input_data_.data(), input_data_.size() * sizeof(float));
+        network_->inputTensor(0)->set_device_mem(&input_mem_);
+
+        // ִǰ
+        network_->forward();
+
+        // ȡ
+        output_data_.resize(stage_batch * num_classes_);
+        bm_device_mem_t output_mem = *network_->outputTensor(0)->get_device_mem();
+        bm_memcpy_d2s_partial(bm_ctx_->handle(), output_data_.data(), output_mem, output_data_.size() * sizeof(float));
+
+        for (int b = 0; b < num; ++b) {
+            const float* output_data = output_data_.data() + b * num_classes_;
+
+            // ҵʵ
+            float max_prob = output_data[0];
+            int max_idx = 0;
+            for (int i = 1; i < num_classes_; ++i) {
+                if (output_data[i] > max_prob) {
+                    max_prob = output_data[i];
+                    max_idx = i;
+                }
+            }
+
+            // ʹ labels_ Աȡǩ
+            std::string label = labels_[max_idx];
+            float prob = max_prob / (output_data[0] + output_data[1]);
+            results[valid[start + b]] = { label, prob };
+        }
+    }
 
-    return { label, prob };
+    return results;
 }
@@ -22,11 +22,16 @@ public:
     // ڹؼԤ⶯
     std::pair<std::string, float> infer(const std::vector<std::vector<cv::Point2f>>& frames_buffer);
 
+    // ĿĹؼа stage һǰ
+    std::vector<std::pair<std::string, float>> infer(const std::vector<const std::vector<std::vector<cv::Point2f>>*>& frames_buffers);
+
 private:
     std::shared_ptr<BMNNContext> bm_ctx_;
     std::shared_ptr<BMNNNetwork> network_;
-    bm_shape_t input_shape_;
-    bm_shape_t output_shape_;
+    bm_device_mem_t input_mem_;     //  batch ԤԴ
+    std::vector<float> input_data_;
+    std::vector<float> output_data_;
+    int max_batch_;
     int seg_;
     int num_joint_;
     int num_classes_;
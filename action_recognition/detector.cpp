@@ -0,0 +1,69 @@
+#include "detector.hpp"
+#include <stdexcept>
+
+YoloV5Detector::YoloV5Detector(std::shared_ptr<BMNNHandle> handle, const std::string& bmodel_path,
+	float conf_thresh, float nms_thresh) {
+	auto bm_ctx = std::make_shared<BMNNContext>(handle, bmodel_path.c_str());
+	yolov5_ = std::make_unique<YoloV5>(bm_ctx);
+	yolov5_->Init(conf_thresh, nms_thresh, "");
+}
+
+int YoloV5Detector::Detect(const std::vector<bm_image>& images, std::vector<DetectBoxVec>& boxes) {
+	return yolov5_->Detect(images, boxes);
+}
+
+int YoloV5Detector::batch_size() {
+	return yolov5_->batch_size();
+}
+
+void YoloV5Detector::enableProfile(std::shared_ptr<TimeStamp> ts) {
+	yolov5_->enableProfile(ts);
+}
+
+YoloV8Detector::YoloV8Detector(std::shared_ptr<BMNNHandle> handle, const std::string& bmodel_path,
+	float conf_thresh, float nms_thresh) {
+	auto bm_ctx = std::make_shared<BMNNContext>(handle, bmodel_path.c_str());
+	yolov8_ = std::make_unique<YoloV8_det>(bm_ctx, "", conf_thresh, nms_thresh);
+}
+
+int YoloV8Detector::Detect(const std::vector<bm_image>& images, std::vector<DetectBoxVec>& boxes) {
+	std::vector<YoloV8BoxVec> v8_boxes;
+	int ret = yolov8_->Detect(images, v8_boxes);
+	for (const auto& v8_vec : v8_boxes) {
+		DetectBoxVec vec;
+		vec.reserve(v8_vec.size());
+		for (const auto& b : v8_vec) {
+			DetectBox box;
+			box.x = b.x1;
+			box.y = b.y1;
+			box.width = b.x2 - b.x1;
+			box.height = b.y2 - b.y1;
+			box.score = b.score;
+			box.class_id = b.class_id;
+			vec.push_back(box);
+		}
+		boxes.push_back(std::move(vec));
+	}
+	return ret;
+}
+
+int YoloV8Detector::batch_size() {
+	return yolov8_->batch_size;
+}
+
+void YoloV8Detector::enableProfile(std::shared_ptr<TimeStamp> ts) {
+	// YoloV8_det ָֻ,  ts ֤
+	ts_ = ts;
+	yolov8_->m_ts = ts_.get();
+}
+
+std::unique_ptr<Detector> create_detector(const std::string& type, std::shared_ptr<BMNNHandle> handle,
+	const std::string& bmodel_path, float conf_thresh, float nms_thresh) {
+	if (type == "yolov5") {
+		return std::make_unique<YoloV5Detector>(handle, bmodel_path, conf_thresh, nms_thresh);
+	}
+	if (type == "yolov8") {
+		return std::make_unique<YoloV8Detector>(handle, bmodel_path, conf_thresh, nms_thresh);
+	}
+	throw std::runtime_error("ֵ֧ļ: " + type);
+}
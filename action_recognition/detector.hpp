@@ -0,0 +1,60 @@
+#ifndef DETECTOR_HPP
+#define DETECTOR_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "bmnn_utils.h"
+#include "yolov5.hpp"
+#include "yolov8_det.hpp"
+
+// ͳһļ: Ͻ (x, y) + ,  BYTETracker һ
+using DetectBox = YoloV5Box;
+using DetectBoxVec = std::vector<DetectBox>;
+
+// ӿ, ͬģͨˮ
+class Detector {
+public:
+	virtual ~Detector() {}
+
+	// , ÿͼĽ˳׷ӵ boxes
+	virtual int Detect(const std::vector<bm_image>& images, std::vector<DetectBoxVec>& boxes) = 0;
+	// ģֵ֧ batch
+	virtual int batch_size() = 0;
+	virtual void enableProfile(std::shared_ptr<TimeStamp> ts) = 0;
+};
+
+// YOLOv5 (anchor based) 
+class YoloV5Detector : public Detector {
+public:
+	YoloV5Detector(std::shared_ptr<BMNNHandle> handle, const std::string& bmodel_path,
+		float conf_thresh, float nms_thresh);
+
+	int Detect(const std::vector<bm_image>& images, std::vector<DetectBoxVec>& boxes) override;
+	int batch_size() override;
+	void enableProfile(std::shared_ptr<TimeStamp> ts) override;
+
+private:
+	std::unique_ptr<YoloV5> yolov5_;
+};
+
+// YOLOv8 (anchor free) ,  xyxy תΪ xywh
+class YoloV8Detector : public Detector {
+public:
+	YoloV8Detector(std::shared_ptr<BMNNHandle> handle, const std::string& bmodel_path,
+		float conf_thresh, float nms_thresh);
+
+	int Detect(const std::vector<bm_image>& images, std::vector<DetectBoxVec>& boxes) override;
+	int batch_size() override;
+	void enableProfile(std::shared_ptr<TimeStamp> ts) override;
+
+private:
+	std::unique_ptr<YoloV8_det> yolov8_;
+	std::shared_ptr<TimeStamp> ts_;
+};
+
+// ʹ, type Ϊ "yolov5"  "yolov8"
+std::unique_ptr<Detector> create_detector(const std::string& type, std::shared_ptr<BMNNHandle> handle,
+	const std::string& bmodel_path, float conf_thresh, float nms_thresh);
+
+#endif // DETECTOR_HPP
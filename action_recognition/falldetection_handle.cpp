@@ -92,22 +92,28 @@ extern "C" {
                     std::cerr << "Failed to allocate humans" << std::endl;
                     return -2;
                 }
+                std::memset(result->humans, 0, result->human_count * sizeof(KeypointSet));
                 for (int i = 0; i < result->human_count; ++i) {
                     result->humans[i].point_count = cpp_result.humans[i].size();
                     if (result->humans[i].point_count > 0) {
                         result->humans[i].points = (Point2f*)malloc(result->humans[i].point_count * sizeof(Point2f));
-                        if (!result->humans[i].points) {
+                        result->humans[i].confidences = (float*)malloc(result->humans[i].point_count * sizeof(float));
+                        if (!result->humans[i].points || !result->humans[i].confidences) {
                             falldetection_free_result(result);
                             std::cerr << "Failed to allocate humans[" << i << "].points" << std::endl;
                             return -2;
                         }
+                        bool has_conf = i < (int)cpp_result.confidences.size() &&
+                            cpp_result.confidences[i].size() == cpp_result.humans[i].size();
                         for (int j = 0; j < result->humans[i].point_count; ++j) {
                             result->humans[i].points[j].x = cpp_result.humans[i][j].x;
                             result->humans[i].points[j].y = cpp_result.humans[i][j].y;
+                            result->humans[i].confidences[j] = has_conf ? cpp_result.confidences[i][j] : 0.0f;
                         }
                     }
                     else {
                         result->humans[i].points = nullptr;
+                        result->humans[i].confidences = nullptr;
                     }
                 }
             }
@@ -189,6 +195,9 @@ extern "C" {
                 if (result->humans[i].points) {
                     free(result->humans[i].points);
                 }
+                if (result->humans[i].confidences) {
+                    free(result->humans[i].confidences);
+                }
             }
             free(result->humans);
             result->humans = nullptr;
@@ -44,6 +44,7 @@ extern "C" {
     typedef struct {
         Point2f* points;      // ؼ
         int point_count;      // ؼ
+        float* confidences;   // ؼŶ飬Ϊ point_count
     } KeypointSet;
 
     // ʾC 汾
@@ -1,11 +1,14 @@
 #include "falldetection_pipeline.hpp"
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <yaml-cpp/yaml.h>
 #include <fstream>
 
 FalldetectionPipeline::FalldetectionPipeline(const std::string& config_path, int dev_id)
-	: dev_id_(dev_id), counter_(0), text_duration_(0) {
+	: dev_id_(dev_id), counter_(0), text_duration_(0), pose_ms_per_person_(0.0f),
+	last_timestamp_(0.0), has_timestamp_(false) {
 	parse_config(config_path);
 	init_models();
 }
@@ -13,12 +16,10 @@ FalldetectionPipeline::FalldetectionPipeline(const std::string& config_path, int
 FalldetectionPipeline::~FalldetectionPipeline() {
 	// ͷԴ
 	reset(); // ״̬
-	yolov5_.reset();
+	detector_.reset();
 	bytetrack_.reset();
 	hrnet_pose_.reset();
 	classifier_.reset();
-	filter_.reset();
-	scaled_filter_.reset();
 	time_stamp_.reset();
 	handle_.reset();
 }
@@ -29,6 +30,7 @@ void FalldetectionPipeline::parse_config(const std::string& config_path) {
 	args_.device = "tpu";
 	args_.estimator_bmodel_path = "models/pose_estimator_int8.bmodel";
 	args_.detector_bmodel_path = "models/detector_int8_4b.bmodel";
+	args_.detector_type = "yolov5";
 	args_.classifier_bmodel_path = "models/action_recognition_fp32_1b.bmodel";
 	args_.class_names = { "fall", "normal" };
 	args_.seg = 30;
@@ -36,6 +38,12 @@ void FalldetectionPipeline::parse_config(const std::string& config_path) {
 	args_.num_classes = 2;
 	args_.channels = 2;
 	args_.detector_prob_threshold = 0.7f;
+	args_.keypoint_threshold = 0.3f;
+	args_.min_valid_joints = 9;
+	args_.min_valid_frames = 20;
+	args_.pose_budget = 0;
+	args_.pose_budget_ms = 0.0f;
+	args_.frame_rate = 30.0f;
 	args_.disable_filter = false;
 	args_.skeleton_visible = true;
 	args_.enable_log = true;
@@ -56,6 +64,9 @@ void FalldetectionPipeline::parse_config(const std::string& config_path) {
 			if (fall_recog["detector_bmodel_path"]) {
 				args_.detector_bmodel_path = fall_recog["detector_bmodel_path"].as<std::string>();
 			}
+			if (fall_recog["detector_type"]) {
+				args_.detector_type = fall_recog["detector_type"].as<std::string>();
+			}
 			if (fall_recog["classifier_bmodel_path"]) {
 				args_.classifier_bmodel_path = fall_recog["classifier_bmodel_path"].as<std::string>();
 			}
@@ -70,6 +81,30 @@ void FalldetectionPipeline::parse_config(const std::string& config_path) {
 				args_.detector_prob_threshold = fall_recog["detector_prob_threshold"].as<float>();
 			}
 
+			// ȡؼŶ
+			if (fall_recog["keypoint_threshold"]) {
+				args_.keypoint_threshold = fall_recog["keypoint_threshold"].as<float>();
+			}
+			if (fall_recog["min_valid_joints"]) {
+				args_.min_valid_joints = fall_recog["min_valid_joints"].as<int>();
+			}
+			if (fall_recog["min_valid_frames"]) {
+				args_.min_valid_frames = fall_recog["min_valid_frames"].as<int>();
+			}
+
+			// ȡ̬Ԥ
+			if (fall_recog["pose_budget"]) {
+				args_.pose_budget = fall_recog["pose_budget"].as<int>();
+			}
+			if (fall_recog["pose_budget_ms"]) {
+				args_.pose_budget_ms = fall_recog["pose_budget_ms"].as<float>();
+			}
+
+			// ȡ֡
+			if (fall_recog["frame_rate"]) {
+				args_.frame_rate = fall_recog["frame_rate"].as<float>();
+			}
+
 			// ȡ˲͹ӻ
 			if (fall_recog["disable_filter"]) {
 				args_.disable_filter = fall_recog["disable_filter"].as<bool>();
@@ -104,17 +139,20 @@ void FalldetectionPipeline::init_models() {
 	bm_handle_t h = handle_->handle();
 
 	auto ts = std::make_shared<TimeStamp>();
-	auto bm_ctx_detector = std::make_shared<BMNNContext>(handle_, args_.detector_bmodel_path.c_str());
-	yolov5_ = std::make_unique<YoloV5>(bm_ctx_detector);
-	yolov5_->Init(args_.detector_prob_threshold, 0.6f, "");
-	yolov5_->enableProfile(ts);
+	detector_ = create_detector(args_.detector_type, handle_, args_.detector_bmodel_path,
+		args_.detector_prob_threshold, 0.6f);
+	detector_->enableProfile(ts);
 	time_stamp_ = ts;
 
-	bytetrack_params params;
-	params.track_thresh = 0.1f;
-	params.track_buffer = 30;
-	params.match_thresh = 0.80f;
-	bytetrack_ = std::make_unique<BYTETracker>(params);
+	track_params_ = bytetrack_params();
+	track_params_.conf_thresh = args_.detector_prob_threshold;
+	track_params_.nms_thresh = 0.6f;
+	track_params_.track_thresh = 0.1f;
+	track_params_.match_thresh = 0.80f;
+	track_params_.frame_rate = static_cast<int>(std::lround(args_.frame_rate));
+	track_params_.track_buffer = 30;
+	track_params_.min_box_area = 0;
+	bytetrack_ = std::make_unique<BYTETracker>(track_params_);
 
 	auto bm_ctx_pose = std::make_shared<BMNNContext>(handle_, args_.estimator_bmodel_path.c_str());
 	hrnet_pose_ = std::make_unique<HRNetPose>(bm_ctx_pose);
@@ -125,9 +163,6 @@ void FalldetectionPipeline::init_models() {
 		args_.seg, args_.num_joint,
 		args_.num_classes, args_.channels,
 		dev_id_);
-
-	filter_ = std::make_unique<OneEuroFilter>(1.0f / 30.0f, 1.0f, 0.007f, 1.0f);
-	scaled_filter_ = std::make_unique<OneEuroFilter>(1.0f / 30.0f, 1.0f, 0.007f, 1.0f);
 }
 
 void FalldetectionPipeline::video_inference() {
@@ -175,7 +210,8 @@ void FalldetectionPipeline::video_inference() {
 			}
 		}
 
-		ActionInferenceResult result = inference(frame);
+		// ļʱƽ, ȡʱĺ˰֡ƽ
+		ActionInferenceResult result = inference(frame, cap.get(cv::CAP_PROP_POS_MSEC) / 1000.0);
 		if (args_.save_result && args_.enable_log) {
 			out.write(result.visualized_frame);
 		}
@@ -190,10 +226,21 @@ void FalldetectionPipeline::video_inference() {
 
 
 ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
+    return inference(frame, has_timestamp_ ? last_timestamp_ + 1.0 / args_.frame_rate : 0.0);
+}
+
+ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame, double timestamp) {
     if (frame.empty()) {
         throw std::runtime_error("֡Ϊ");
     }
 
+    // ʱǰ (ظ֡ȡʱ) ʱ֡ƽ
+    if (has_timestamp_ && timestamp <= last_timestamp_) {
+        timestamp = last_timestamp_ + 1.0 / args_.frame_rate;
+    }
+    last_timestamp_ = timestamp;
+    has_timestamp_ = true;
+
     cv::Mat frame_copy = frame.clone();
 
     //cv::imwrite("./frame_copy.jpg", frame_copy);
@@ -213,39 +260,43 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
         throw std::runtime_error("޷豸״̬=" + std::to_string(status));
     }
 
+    // 64stride, Ԥٿ
     bm_image bm_img;
-    bm_image_create(handle, frame_copy.rows, frame_copy.cols, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE, &bm_img);
+    int bm_stride[1] = { FFALIGN(frame_copy.cols * 3, 64) };
+    bm_image_create(handle, frame_copy.rows, frame_copy.cols, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE, &bm_img, bm_stride);
     bm_image_alloc_dev_mem(bm_img, BMCV_IMAGE_FOR_IN);
     cv::bmcv::toBMI(frame_copy, &bm_img);
 
     double det_time = cv::getTickCount() / cv::getTickFrequency() * 1000;
 
-    std::vector<YoloV5BoxVec> yolov5_boxes;
+    std::vector<DetectBoxVec> det_boxes;
     std::vector<bm_image> batch_imgs = { bm_img };
-    if (!yolov5_) {
+    if (!detector_) {
         bm_image_destroy(bm_img);
         bm_dev_free(handle);
-        throw std::runtime_error("YoloV5 δʼ");
+        throw std::runtime_error("δʼ");
     }
-    yolov5_->Detect(batch_imgs, yolov5_boxes);
+    detector_->Detect(batch_imgs, det_boxes);
 
     double track_time = cv::getTickCount() / cv::getTickFrequency() * 1000;
 
     // յǰ֡״̬
     humans_.clear();
+    confidences_.clear();
     scaled_humans_.clear();
     labels_.clear();
     probs_.clear();
     online_targets_.targets.clear();
 
     humans_.reserve(10);
+    confidences_.reserve(10);
     scaled_humans_.reserve(10);
     labels_.reserve(10);
     probs_.reserve(10);
 
-    if (!yolov5_boxes.empty() && !yolov5_boxes[0].empty()) {
+    if (!det_boxes.empty() && !det_boxes[0].empty()) {
         STracks stracks; // ʱ洢 BYTETracker 
-        bytetrack_->update(stracks, yolov5_boxes[0]);
+        bytetrack_->update(stracks, det_boxes[0], timestamp);
         counter_++;
 
         //  STracks תΪ TrackInfo
@@ -254,7 +305,7 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
             TrackEntry entry;
             entry.track_id = box->track_id;
             entry.state = box->state;
-            entry.tlbr = box->tlbr; // ֱʹ tlbr
+            entry.tlbr.assign(box->tlbr.begin(), box->tlbr.end()); // ֱʹ tlbr
             entry.frame_id = box->frame_id;
             entry.tracklet_len = box->tracklet_len;
             entry.start_frame = box->start_frame;
@@ -263,8 +314,10 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
             online_targets_.targets.push_back(entry);
         }
 
+        std::vector<DetectBox> person_boxes;
+        person_boxes.reserve(online_targets_.targets.size());
         for (const auto& box : online_targets_.targets) {
-            YoloV5Box person_box;
+            DetectBox person_box;
             //  tlbr תΪ tlwh
             person_box.x = box.tlbr[0]; // top-left x
             person_box.y = box.tlbr[1]; // top-left y
@@ -272,20 +325,82 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
             person_box.height = box.tlbr[3] - box.tlbr[1]; // bottom - top
             person_box.score = box.score;
             person_box.class_id = box.class_id;
+            person_boxes.push_back(person_box);
+        }
 
-            std::vector<cv::Point2f> keypoints;
-            std::vector<float> maxvals;
-            std::vector<cv::Mat> heatmaps;
-            hrnet_pose_->poseEstimate(bm_img, person_box, keypoints, maxvals, heatmaps);
+        // ԤȼѡĿ, һ̬
+        std::vector<size_t> scheduled = schedule_pose(person_boxes, timestamp);
+        std::vector<DetectBox> pose_boxes;
+        pose_boxes.reserve(scheduled.size());
+        for (size_t idx : scheduled) {
+            pose_boxes.push_back(person_boxes[idx]);
+        }
+        std::vector<std::vector<cv::Point2f>> pose_keypoints;
+        std::vector<std::vector<float>> pose_maxvals;
+        if (!pose_boxes.empty()) {
+            double pose_start = cv::getTickCount() / cv::getTickFrequency() * 1000;
+            hrnet_pose_->poseEstimate(bm_img, pose_boxes, pose_keypoints, pose_maxvals);
+            float per_person = static_cast<float>(cv::getTickCount() / cv::getTickFrequency() * 1000 - pose_start) / pose_boxes.size();
+            pose_ms_per_person_ = pose_ms_per_person_ == 0.0f ? per_person : 0.9f * pose_ms_per_person_ + 0.1f * per_person;
+        }
+
+        // ŶȹؽøĿһοŵλ, ƽ˲
+        std::vector<std::vector<cv::Point2f>> batch_keypoints(person_boxes.size());
+        std::vector<std::vector<float>> batch_maxvals(person_boxes.size());
+        std::vector<char> frame_valid(person_boxes.size(), false);
+        for (size_t k = 0; k < scheduled.size(); ++k) {
+            size_t idx = scheduled[k];
+            TrackHistory& history = frames_buffer_[online_targets_.targets[idx].track_id];
+            frame_valid[idx] = gate_keypoints(history, pose_keypoints[k], pose_maxvals[k]);
+            history.pose_keypoints = pose_keypoints[k];
+            history.pose_maxvals = pose_maxvals[k];
+            history.pose_box = cv::Rect2f(person_boxes[idx].x, person_boxes[idx].y, person_boxes[idx].width, person_boxes[idx].height);
+            history.pose_valid = frame_valid[idx];
+            history.pose_frame = counter_;
+            batch_keypoints[idx] = std::move(pose_keypoints[k]);
+            batch_maxvals[idx] = std::move(pose_maxvals[k]);
+        }
+
+        // δȵĿ: ϴεĹؼƽŵǰ
+        for (size_t idx = 0; idx < person_boxes.size(); ++idx) {
+            TrackHistory& history = frames_buffer_[online_targets_.targets[idx].track_id];
+            if (history.pose_frame == counter_ || history.pose_keypoints.empty()) {
+                continue;
+            }
+            const cv::Rect2f& from = history.pose_box;
+            const DetectBox& to = person_boxes[idx];
+            float sx = to.width / std::max(from.width, 1e-3f);
+            float sy = to.height / std::max(from.height, 1e-3f);
+            batch_keypoints[idx].resize(history.pose_keypoints.size());
+            for (size_t j = 0; j < history.pose_keypoints.size(); ++j) {
+                batch_keypoints[idx][j].x = to.x + (history.pose_keypoints[j].x - from.x) * sx;
+                batch_keypoints[idx][j].y = to.y + (history.pose_keypoints[j].y - from.y) * sy;
+            }
+            batch_maxvals[idx] = history.pose_maxvals;
+            frame_valid[idx] = history.pose_valid;
+        }
 
+        // ÿĿֻԼ˲, ǰһͬһ˵ĹǼ
+        for (size_t idx = 0; idx < batch_keypoints.size(); ++idx) {
+            std::vector<cv::Point2f>& keypoints = batch_keypoints[idx];
             if (!args_.disable_filter && !keypoints.empty()) {
-                keypoints = filter_->predict(keypoints, 1.0f / 30.0f);
+                TrackHistory& history = frames_buffer_[online_targets_.targets[idx].track_id];
+                float track_dt = 1.0f / args_.frame_rate;
+                if (!history.filter) {
+                    history.filter = std::make_unique<OneEuroFilter>(track_dt, 1.0f, 0.007f, 1.0f);
+                    history.scaled_filter = std::make_unique<OneEuroFilter>(track_dt, 1.0f, 0.007f, 1.0f);
+                }
+                else {
+                    track_dt = static_cast<float>(timestamp - history.filter_time);
+                }
+                history.filter_time = timestamp;
+                keypoints = history.filter->predict(keypoints, track_dt);
                 std::vector<cv::Point2f> scaled_keypoints = keypoints;
                 for (auto& pt : scaled_keypoints) {
                     pt.x /= 384.0f;
                     pt.y /= 512.0f;
                 }
-                scaled_keypoints = scaled_filter_->predict(scaled_keypoints, 1.0f / 30.0f);
+                scaled_keypoints = history.scaled_filter->predict(scaled_keypoints, track_dt);
                 humans_.push_back(keypoints);
                 scaled_humans_.push_back(scaled_keypoints);
             }
@@ -317,29 +432,38 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
             }
         }
 
-        //  frames_buffer_ Ͷʶ
+        //  frames_buffer_, ֻдЧ֡㹻Ŀͷ
+        std::vector<const std::vector<std::vector<cv::Point2f>>*> windows;
+        std::vector<size_t> window_targets;
+        windows.reserve(online_targets_.targets.size());
+        window_targets.reserve(online_targets_.targets.size());
         for (size_t idx = 0; idx < online_targets_.targets.size(); ++idx) {
             int track_id = online_targets_.targets[idx].track_id;
             if (args_.enable_log) {
                 std::cout << "frame " << counter_ << ": targets " << idx << ", track_id=" << track_id << "\n";
             }
-            frames_buffer_[track_id].push_back(scaled_humans_[idx]);
-            if (frames_buffer_[track_id].size() > static_cast<size_t>(args_.seg)) {
-                frames_buffer_[track_id].erase(frames_buffer_[track_id].begin());
+            TrackHistory& history = frames_buffer_[track_id];
+            if (!scaled_humans_[idx].empty()) { // δ̬ƵĿ겻
+                push_frame(history, scaled_humans_[idx], frame_valid[idx], timestamp);
             }
-            if (frames_buffer_[track_id].size() >= static_cast<size_t>(args_.seg)) {
-                auto [label, prob] = classifier_->infer(frames_buffer_[track_id]);
-                if (label == args_.class_names[0]) { // "fall"
-                    text_duration_ = 30;
-                }
-                labels_.push_back(label);
-                probs_.push_back(prob);
+            if (history.frames.size() >= static_cast<size_t>(args_.seg) && history.valid_count >= args_.min_valid_frames) {
+                windows.push_back(&history.frames);
+                window_targets.push_back(idx);
             }
-            else {
-                labels_.push_back("Tracking");
-                probs_.push_back(0.0f);
+        }
+
+        // ʶв seg ֡Ч֡Ŀ귵 "Tracking"
+        labels_.assign(online_targets_.targets.size(), "Tracking");
+        probs_.assign(online_targets_.targets.size(), 0.0f);
+        std::vector<std::pair<std::string, float>> actions = classifier_->infer(windows);
+        for (size_t k = 0; k < actions.size(); ++k) {
+            if (actions[k].first == args_.class_names[0]) { // "fall"
+                text_duration_ = 30;
             }
+            labels_[window_targets[k]] = actions[k].first;
+            probs_[window_targets[k]] = actions[k].second;
         }
+        confidences_ = std::move(batch_maxvals);
 
         double end = cv::getTickCount() / cv::getTickFrequency() * 1000;
 
@@ -349,7 +473,8 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
             for (const auto& box : online_targets_.targets) {
                 std::cout << box.track_id << " ";
             }
-            std::cout << "\nframes_buffer_size: " << frames_buffer_.size() << "\n";
+            std::cout << "\nframes_buffer_size: " << frames_buffer_.size()
+                << ", pose scheduled: " << scheduled.size() << "/" << person_boxes.size() << "\n";
             for (size_t i = 0; i < online_targets_.targets.size(); ++i) {
                 std::cout << "  target " << online_targets_.targets[i].track_id
                     << ": label=" << labels_[i] << ", prob=" << probs_[i]
@@ -381,6 +506,7 @@ ActionInferenceResult FalldetectionPipeline::inference(const cv::Mat& frame) {
     }
 
     result.humans = humans_;
+    result.confidences = confidences_;
     result.online_targets = online_targets_;
     result.labels = labels_;
     result.probs = probs_;
@@ -396,11 +522,162 @@ void FalldetectionPipeline::reset() {
     text_duration_ = 0;
     frames_buffer_.clear();
     humans_.clear();
+    confidences_.clear();
     scaled_humans_.clear();
     online_targets_.targets.clear();
     labels_.clear();
     probs_.clear();
-    bytetrack_ = std::make_unique<BYTETracker>(bytetrack_params{ 0.1f, 30, 0.95f });
+    has_timestamp_ = false;
+    bytetrack_ = std::make_unique<BYTETracker>(track_params_);
+}
+
+// ؽŶȹһ֡ؼ:  keypoint_threshold Ĺؽһοŵλ,
+// Źؽڸ last_keypoints. ظ֡ǷΪЧ֡ (Źؽ min_valid_joints).
+bool FalldetectionPipeline::gate_keypoints(TrackHistory& history, std::vector<cv::Point2f>& keypoints, const std::vector<float>& maxvals) {
+    if (history.last_keypoints.size() != keypoints.size()) {
+        history.last_keypoints = keypoints;
+    }
+
+    int confident = 0;
+    for (size_t j = 0; j < keypoints.size(); ++j) {
+        if (maxvals[j] >= args_.keypoint_threshold) {
+            history.last_keypoints[j] = keypoints[j];
+            confident++;
+        }
+        else {
+            keypoints[j] = history.last_keypoints[j];
+        }
+    }
+    return confident >= args_.min_valid_joints;
+}
+
+// ֡ʰһ֡ŽĿĴ, ʹʼո seg / frame_rate :
+// രĩ֡ k ֡֡, м䶪 k - 1 ֡ǰ֡Բֵ,
+// ֡滻ĩ֡. ʱڵ֡ѹ,
+// մڲӸ֡¿ʼ
+void FalldetectionPipeline::push_frame(TrackHistory& history, const std::vector<cv::Point2f>& scaled_keypoints, bool valid, double timestamp) {
+    if (history.frames.empty()) {
+        append_frame(history, scaled_keypoints, valid);
+        history.window_time = timestamp;
+        return;
+    }
+
+    long steps = std::lround((timestamp - history.window_time) * args_.frame_rate);
+    if (steps <= 0) {
+        history.valid_count += valid - history.valid.back();
+        history.frames.back() = scaled_keypoints;
+        history.valid.back() = valid;
+        return;
+    }
+    if (steps > args_.seg) {
+        history.frames.clear();
+        history.valid.clear();
+        history.valid_count = 0;
+        append_frame(history, scaled_keypoints, valid);
+        history.window_time = timestamp;
+        return;
+    }
+    // ĩ֡ʱ䰴ƽ,  timestamp 
+    history.window_time += steps / static_cast<double>(args_.frame_rate);
+
+    const std::vector<cv::Point2f> prev = history.frames.back();
+    bool prev_valid = history.valid.back() != 0;
+    std::vector<cv::Point2f> filled(scaled_keypoints.size());
+    for (long k = 1; k < steps; ++k) {
+        float w = static_cast<float>(k) / steps;
+        for (size_t j = 0; j < scaled_keypoints.size(); ++j) {
+            filled[j] = j < prev.size() ? prev[j] + w * (scaled_keypoints[j] - prev[j]) : scaled_keypoints[j];
+        }
+        append_frame(history, filled, valid && prev_valid);
+    }
+    append_frame(history, scaled_keypoints, valid);
+}
+
+// ׷һ֡ĿĴ, ִڳȲ seg άЧ֡
+void FalldetectionPipeline::append_frame(TrackHistory& history, const std::vector<cv::Point2f>& scaled_keypoints, bool valid) {
+    history.frames.push_back(scaled_keypoints);
+    history.valid.push_back(valid);
+    history.valid_count += valid;
+    if (history.frames.size() > static_cast<size_t>(args_.seg)) {
+        history.valid_count -= history.valid.front();
+        history.frames.erase(history.frames.begin());
+        history.valid.erase(history.valid.begin());
+    }
+}
+
+// ȼѡ̬֡ƵĿ,  boxes ±. Ԥȡ pose_budget 
+// pose_budget_ms / Ŀʱ нС, ȼΪ:
+//   1. Ŀ (δ̬)
+//   2. ˤʼ: ߱ͻ
+//   3. Ŀ갴 "ϴιƵ֡ x " ,  () ;δƵ, 
+std::vector<size_t> FalldetectionPipeline::schedule_pose(const std::vector<DetectBox>& boxes, double timestamp) {
+    const float aspect_change = 0.15f; // ߱Ա仯ֵΪͻ
+    const float drop_speed = 0.05f;    // ÿ֡ƳߵĸñΪ
+
+    int budget = static_cast<int>(boxes.size());
+    if (args_.pose_budget > 0) {
+        budget = std::min(budget, args_.pose_budget);
+    }
+    if (args_.pose_budget_ms > 0 && pose_ms_per_person_ > 0) {
+        budget = std::min(budget, std::max(1, static_cast<int>(args_.pose_budget_ms / pose_ms_per_person_)));
+    }
+
+    struct Candidate {
+        int tier;
+        float score;
+        size_t idx;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(boxes.size());
+    for (size_t idx = 0; idx < boxes.size(); ++idx) {
+        TrackHistory& history = frames_buffer_[online_targets_.targets[idx].track_id];
+        const DetectBox& box = boxes[idx];
+        cv::Rect2f rect(box.x, box.y, box.width, box.height);
+
+        Candidate c{ 2, 0.0f, idx };
+        if (history.pose_frame < 0) {
+            c.tier = 0;
+            c.score = box.height;
+        }
+        else {
+            bool onset = false;
+            if (history.has_prev_box) {
+                const cv::Rect2f& prev = history.prev_box;
+                float ratio = rect.width / std::max(rect.height, 1e-3f);
+                float prev_ratio = prev.width / std::max(prev.height, 1e-3f);
+                float drop = (rect.y + rect.height / 2) - (prev.y + prev.height / 2);
+                //  prev_box ֡, ֡Ŀʧֵ֮Ŵ
+                float elapsed_frames = static_cast<float>((timestamp - history.prev_box_time) * args_.frame_rate);
+                onset = std::fabs(ratio - prev_ratio) > aspect_change * prev_ratio ||
+                    drop > drop_speed * rect.height * elapsed_frames;
+            }
+            c.tier = onset ? 1 : 2;
+            c.score = onset ? box.height : (counter_ - history.pose_frame) * box.height;
+        }
+        candidates.push_back(c);
+
+        history.prev_box = rect;
+        history.prev_box_time = timestamp;
+        history.has_prev_box = true;
+    }
+
+    std::vector<size_t> scheduled;
+    scheduled.reserve(budget);
+    if (budget >= static_cast<int>(boxes.size())) {
+        for (const Candidate& c : candidates) {
+            scheduled.push_back(c.idx);
+        }
+        return scheduled;
+    }
+
+    std::partial_sort(candidates.begin(), candidates.begin() + budget, candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+            return a.tier != b.tier ? a.tier < b.tier : a.score > b.score;
+        });
+    for (int k = 0; k < budget; ++k) {
+        scheduled.push_back(candidates[k].idx);
+    }
+    return scheduled;
 }
 
 cv::Mat FalldetectionPipeline::visualize(cv::Mat frame, const std::vector<std::vector<cv::Point2f>>& keypoints,
@@ -421,7 +698,7 @@ cv::Mat FalldetectionPipeline::visualize(cv::Mat frame, const std::vector<std::v
         cv::putText(frame, label_text, cv::Point(x1, y1 + 20),
             cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
 
-        if (vis_skeleton && i < keypoints.size()) {
+        if (vis_skeleton && i < keypoints.size() && !keypoints[i].empty()) {
             hrnet_pose_->drawPose(keypoints[i], frame);
         }
     }
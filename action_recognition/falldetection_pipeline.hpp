@@ -8,7 +8,7 @@
 #include <memory>
 #include "bmnn_utils.h"
 #include "bm_wrapper.hpp"
-#include "yolov5.hpp"
+#include "detector.hpp"
 #include "hrnet_pose.hpp"
 #include "bytetrack.h"
 #include "one_euro_filter.hpp"
@@ -25,7 +25,7 @@
 
 // ǰ
 class BMNNHandle;
-class YoloV5;
+class Detector;
 class BYTETracker;
 class HRNetPose;
 class ActionRecognition;
@@ -53,6 +53,7 @@ struct TrackInfo {
 struct EXPORT_API ActionInferenceResult {
 	cv::Mat visualized_frame; // ӻ֡
 	std::vector<std::vector<cv::Point2f>> humans; // ˵Ĺؼ
+	std::vector<std::vector<float>> confidences; // ؼŶ (̬ģ maxvals)
 	TrackInfo online_targets; // Ϣ
 	std::vector<std::string> labels; // ǩ
 	std::vector<float> probs; // 
@@ -68,9 +69,13 @@ public:
 	// Ƶ
 	void video_inference();// Ժ
 
-	// ֡ͼ
+	// ֡ͼ, ֡ frame_rate 
 	ActionInferenceResult inference(const cv::Mat& frame);
 
+	// ֡ͼ, timestamp Ϊɼʱ (). Ԥ⡢Ŀڡؼ˲
+	// ʶ𴰿ڶʵʱƽ, ֡֡ʶʱȻȷ
+	ActionInferenceResult inference(const cv::Mat& frame, double timestamp);
+
 	// ״̬
 	void reset();
 
@@ -80,6 +85,7 @@ private:
 		std::string device;
 		std::string estimator_bmodel_path;
 		std::string detector_bmodel_path;
+		std::string detector_type; // yolov5 / yolov8
 		std::string classifier_bmodel_path;
 		std::vector<std::string> class_names;
 		int seg;
@@ -87,6 +93,12 @@ private:
 		int num_classes;
 		int channels;
 		float detector_prob_threshold;
+		float keypoint_threshold;   // ؽŶȵڸֵΪ
+		int min_valid_joints;       // Źؽڸֵ֡ΪЧ֡
+		int min_valid_frames;       // Ч֡ڸֵͷ
+		int pose_budget;            // ÿ̬֡ƵĿ, 0 ʾ
+		float pose_budget_ms;       // ÿ̬֡ƵʱԤ (ms), 0 ʾ
+		float frame_rate;           // ֡: ٲͶʶ𴰿ڰ֡
 		bool disable_filter;
 		bool skeleton_visible;
 		bool enable_log;
@@ -96,8 +108,37 @@ private:
 		bool visualized_frame;
 	};
 
+	// ĿĹǼʷ
+	struct TrackHistory {
+		std::vector<std::vector<cv::Point2f>> frames; // һؼ㴰, 
+		std::vector<char> valid;                      // ÿ֡ǷΪЧ֡
+		int valid_count = 0;
+		std::vector<cv::Point2f> last_keypoints;      // ؽһοŵλ (ԭͼ)
+		double window_time = 0.0;                     // ĩ֡Ӧʱ ()
+
+		// һ̬ƵĽ, δȵ֡˶ؼ
+		std::vector<cv::Point2f> pose_keypoints;
+		std::vector<float> pose_maxvals;
+		cv::Rect2f pose_box;
+		bool pose_valid = false;
+		int pose_frame = -1;                          // һ̬Ƶ֡, -1 ʾδ
+		cv::Rect2f prev_box;                          // һ֡Ŀ, жˤʼ
+		double prev_box_time = 0.0;                   // prev_box Ĳɼʱ ()
+		bool has_prev_box = false;
+
+		// ĿԼĹؼƽ˲ (ԭͼ / һ), Ŀ״γʱ,
+		// ʷһɾ. ˲ȡĿһ˲֡Ĳɼʱ
+		std::unique_ptr<OneEuroFilter> filter;
+		std::unique_ptr<OneEuroFilter> scaled_filter;
+		double filter_time = 0.0;                     // һ˲Ĳɼʱ ()
+	};
+
 	void parse_config(const std::string& config_path);
 	void init_models();
+	bool gate_keypoints(TrackHistory& history, std::vector<cv::Point2f>& keypoints, const std::vector<float>& maxvals);
+	void push_frame(TrackHistory& history, const std::vector<cv::Point2f>& scaled_keypoints, bool valid, double timestamp);
+	void append_frame(TrackHistory& history, const std::vector<cv::Point2f>& scaled_keypoints, bool valid);
+	std::vector<size_t> schedule_pose(const std::vector<DetectBox>& boxes, double timestamp);
 	cv::Mat visualize(cv::Mat frame, const std::vector<std::vector<cv::Point2f>>& keypoints,
 		const TrackInfo& boxes, const std::vector<std::string>& labels,
 		const std::vector<float>& probs, bool vis_skeleton);
@@ -106,19 +147,22 @@ private:
 	Args args_;
 	int dev_id_;
 	std::shared_ptr<BMNNHandle> handle_;
-	std::unique_ptr<YoloV5> yolov5_;
+	std::unique_ptr<Detector> detector_;
 	std::unique_ptr<BYTETracker> bytetrack_;
+	bytetrack_params track_params_;
 	std::unique_ptr<HRNetPose> hrnet_pose_;
 	std::unique_ptr<ActionRecognition> classifier_;
-	std::unique_ptr<OneEuroFilter> filter_;
-	std::unique_ptr<OneEuroFilter> scaled_filter_;
 	std::shared_ptr<TimeStamp> time_stamp_;
 	// ״̬
 	int counter_;
 	int text_duration_;
-	std::map<int, std::vector<std::vector<cv::Point2f>>> frames_buffer_;
+	float pose_ms_per_person_; // Ŀ̬ƺʱĻƽ, ڰʱԤ㻻Ŀ
+	double last_timestamp_;    // һ֡Ĳɼʱ ()
+	bool has_timestamp_;
+	std::map<int, TrackHistory> frames_buffer_;
 	// ״̬
 	std::vector<std::vector<cv::Point2f>> humans_;
+	std::vector<std::vector<float>> confidences_;
 	std::vector<std::vector<cv::Point2f>> scaled_humans_;
 	TrackInfo online_targets_;
 	std::vector<std::string> labels_;
@@ -23,6 +23,11 @@ OneEuroFilter::OneEuroFilter(float te)
 }
 
 std::vector<cv::Point2f> OneEuroFilter::predict(const std::vector<cv::Point2f>& x, float te) {
+	// te is the real interval since the previous sample, the smoothing factors follow it
+	if (te > 0 && te != te_) {
+		te_ = te;
+		dalpha_ = alpha(dcutoff_);
+	}
 	std::vector<cv::Point2f> result = x;
 	if (x_prev_.empty()) {
 		x_prev_ = x;
@@ -8,6 +8,8 @@
 //===----------------------------------------------------------------------===//
 #include "bytetrack.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 BYTETracker::BYTETracker(const bytetrack_params& params) {
@@ -17,8 +19,14 @@ BYTETracker::BYTETracker(const bytetrack_params& params) {
 	this->track_buffer = params.track_buffer;
 	this->min_box_area = params.min_box_area;
 	this->frame_id = 0;
-	this->max_time_lost = int(this->frame_rate / 30.0 * this->track_buffer);
-	this->kalman_filter = std::make_shared<KalmanFilter>();
+	this->timestamp = 0;
+	// track_buffer frames at 30 fps, plus half a frame of slack for capture jitter
+	int max_frames_lost = int(this->frame_rate / 30.0 * this->track_buffer);
+	this->max_time_lost = (max_frames_lost + 0.5) / this->frame_rate;
+	this->sparse_association = params.sparse_association;
+	this->motion_gating = params.motion_gating;
+	this->mark_generation = 0;
+	this->track_id_count = 0;
 	std::cout << "Init ByteTrack!" << std::endl;
 }
 
@@ -28,36 +36,45 @@ BYTETracker::~BYTETracker() {}
 
 void BYTETracker::update(STracks& output_stracks,
 	const std::vector<YoloV5Box>& objects) {
+	update(output_stracks, objects, (this->frame_id + 1) / (double)this->frame_rate);
+}
+
+void BYTETracker::update(STracks& output_stracks,
+	const std::vector<YoloV5Box>& objects, double timestamp) {
 	////////////////// Step 1: Get detections //////////////////
 	this->frame_id++;
-	STracks activated_stracks;
-	STracks refind_stracks;
-	STracks detections;
-	STracks detections_low;
-	STracks detections_cp;
-	STracks tracked_stracks_swap;
-	STracks resa, resb;
-	STracks temp_tracked_stracks;
-	STracks temp_lost_stracks;
-	STracks temp_removed_stracks;
-	STracks unconfirmed;
-	STracks strack_pool;
-	STracks r_tracked_stracks;
+	// the motion model advances one unit per nominal frame period, a timestamp that
+	// does not move forward predicts no motion
+	float dt = 1.f;
+	if (this->frame_id > 1) {
+		dt = (float)std::max(0.0, (timestamp - this->timestamp) * this->frame_rate);
+	}
+	this->timestamp = timestamp;
+	activated_stracks.clear();
+	refind_stracks.clear();
+	detections.clear();
+	detections_low.clear();
+	detections_cp.clear();
+	tracked_stracks_swap.clear();
+	resa.clear();
+	resb.clear();
+	temp_tracked_stracks.clear();
+	temp_lost_stracks.clear();
+	temp_removed_stracks.clear();
+	unconfirmed.clear();
+	strack_pool.clear();
+	r_tracked_stracks.clear();
 
 	if (objects.size() > 0) {
 		for (int i = 0; i < objects.size(); i++) {
-			std::vector<float> tlbr_;
-			tlbr_.resize(4);
-			tlbr_[0] = objects[i].x;
-			tlbr_[1] = objects[i].y;
-			tlbr_[2] = objects[i].x + objects[i].width;
-			tlbr_[3] = objects[i].y + objects[i].height;
+			STrack::Box tlbr_ = { { objects[i].x, objects[i].y,
+				objects[i].x + objects[i].width, objects[i].y + objects[i].height } };
 
 			float score = objects[i].score;
 			int class_id = objects[i].class_id;
 
-			std::shared_ptr<STrack> strack = std::make_shared<STrack>(
-				STrack::tlbr_to_tlwh(tlbr_), score, class_id);
+			int strack = pool.acquire();
+			pool[strack].init(STrack::tlbr_to_tlwh(tlbr_), score, class_id, timestamp);
 			if (score >= track_thresh) {
 				detections.push_back(strack);
 			}
@@ -68,33 +85,29 @@ void BYTETracker::update(STracks& output_stracks,
 	}
 	// Add newly detected tracklets to tracked_stracks
 	for (int i = 0; i < this->tracked_stracks.size(); i++) {
-		if (!this->tracked_stracks[i]->is_activated)
+		if (!pool[this->tracked_stracks[i]].is_activated)
 			unconfirmed.push_back(this->tracked_stracks[i]);
 		else
 			temp_tracked_stracks.push_back(this->tracked_stracks[i]);
 	}
 	////////////////// Step 2: First association, with IoU //////////////////
 	joint_stracks(temp_tracked_stracks, this->lost_stracks, strack_pool);
-	STrack::multi_predict(strack_pool, this->kalman_filter);
-
-	std::vector<std::vector<float>> dists;
-	int dist_size = strack_pool.size(), dist_size_size = detections.size();
-	iou_distance(strack_pool, detections, dists);
+	STrack::multi_predict(pool, strack_pool, this->kalman_filter, dt);
 
-	std::vector<std::vector<int>> matches;
-	std::vector<int> u_track, u_detection;
-	linear_assignment(dists, dist_size, dist_size_size, match_thresh, matches,
-		u_track, u_detection);
+	matches.clear();
+	u_track.clear();
+	u_detection.clear();
+	associate(strack_pool, detections, match_thresh, matches, u_track, u_detection);
 	for (int i = 0; i < matches.size(); i++) {
-		std::shared_ptr<STrack> track = strack_pool[matches[i][0]];
-		std::shared_ptr<STrack> det = detections[matches[i][1]];
-		if (track->state == TrackState::Tracked) {
-			track->update(this->kalman_filter, det, this->frame_id);
-			activated_stracks.push_back(track);
+		STrack& track = pool[strack_pool[matches[i].first]];
+		const STrack& det = pool[detections[matches[i].second]];
+		if (track.state == TrackState::Tracked) {
+			track.update(this->kalman_filter, det, this->frame_id);
+			activated_stracks.push_back(strack_pool[matches[i].first]);
 		}
 		else {
-			track->re_activate(this->kalman_filter, det, this->frame_id, false);
-			refind_stracks.push_back(track);
+			track.re_activate(this->kalman_filter, det, this->frame_id);
+			refind_stracks.push_back(strack_pool[matches[i].first]);
 		}
 	}
 	////////////////// Step 3: Second association, using low score dets
@@ -102,97 +115,81 @@ void BYTETracker::update(STracks& output_stracks,
 	for (int i = 0; i < u_detection.size(); i++) {
 		detections_cp.push_back(detections[u_detection[i]]);
 	}
-	detections.clear();
-	detections.assign(detections_low.begin(), detections_low.end());
+	detections.swap(detections_low);
 
 	for (int i = 0; i < u_track.size(); i++) {
-		if (strack_pool[u_track[i]]->state == TrackState::Tracked) {
+		if (pool[strack_pool[u_track[i]]].state == TrackState::Tracked) {
 			r_tracked_stracks.push_back(strack_pool[u_track[i]]);
 		}
 	}
 
-	dists.clear();
-	iou_distance(r_tracked_stracks, detections, dists);
-	dist_size = r_tracked_stracks.size();
-	dist_size_size = detections.size();
-
 	matches.clear();
 	u_track.clear();
 	u_detection.clear();
-	linear_assignment(dists, dist_size, dist_size_size, 0.5, matches, u_track,
-		u_detection);
+	associate(r_tracked_stracks, detections, 0.5, matches, u_track, u_detection);
 
 	for (int i = 0; i < matches.size(); i++) {
-		std::shared_ptr<STrack> track = r_tracked_stracks[matches[i][0]];
-		std::shared_ptr<STrack> det = detections[matches[i][1]];
-		if (track->state == TrackState::Tracked) {
-			track->update(this->kalman_filter, det, this->frame_id);
-			activated_stracks.push_back(track);
+		STrack& track = pool[r_tracked_stracks[matches[i].first]];
+		const STrack& det = pool[detections[matches[i].second]];
+		if (track.state == TrackState::Tracked) {
+			track.update(this->kalman_filter, det, this->frame_id);
+			activated_stracks.push_back(r_tracked_stracks[matches[i].first]);
 		}
 		else {
-			track->re_activate(this->kalman_filter, det, this->frame_id, false);
-			refind_stracks.push_back(track);
+			track.re_activate(this->kalman_filter, det, this->frame_id);
+			refind_stracks.push_back(r_tracked_stracks[matches[i].first]);
 		}
 	}
 
 	for (int i = 0; i < u_track.size(); i++) {
-		std::shared_ptr<STrack> track = r_tracked_stracks[u_track[i]];
-		if (track->state != TrackState::Lost) {
-			track->mark_lost();
-			temp_lost_stracks.push_back(track);
+		STrack& track = pool[r_tracked_stracks[u_track[i]]];
+		if (track.state != TrackState::Lost) {
+			track.mark_lost();
+			temp_lost_stracks.push_back(r_tracked_stracks[u_track[i]]);
 		}
 	}
 
 	// Deal with unconfirmed tracks, usually tracks with only one beginning frame
-	detections.clear();
-	detections.assign(detections_cp.begin(), detections_cp.end());
-
-	dists.clear();
-	iou_distance(unconfirmed, detections, dists);
-	dist_size = unconfirmed.size();
-	dist_size_size = detections.size();
+	detections.swap(detections_cp);
 
 	matches.clear();
-	std::vector<int> u_unconfirmed;
+	u_unconfirmed.clear();
 	u_detection.clear();
-	linear_assignment(dists, dist_size, dist_size_size, 0.7, matches,
-		u_unconfirmed, u_detection);
+	associate(unconfirmed, detections, 0.7, matches, u_unconfirmed, u_detection);
 
 	for (int i = 0; i < matches.size(); i++) {
-		unconfirmed[matches[i][0]]->update(
-			this->kalman_filter, detections[matches[i][1]], this->frame_id);
-		activated_stracks.push_back(unconfirmed[matches[i][0]]);
+		pool[unconfirmed[matches[i].first]].update(
+			this->kalman_filter, pool[detections[matches[i].second]], this->frame_id);
+		activated_stracks.push_back(unconfirmed[matches[i].first]);
 	}
 
 	for (int i = 0; i < u_unconfirmed.size(); i++) {
-		std::shared_ptr<STrack> track = unconfirmed[u_unconfirmed[i]];
-		track->mark_removed();
+		int track = unconfirmed[u_unconfirmed[i]];
+		pool[track].mark_removed();
 		temp_removed_stracks.push_back(track);
 	}
 	////////////////// Step 4: Init new stracks //////////////////
 	for (int i = 0; i < u_detection.size(); i++) {
-		std::shared_ptr<STrack> track = detections[u_detection[i]];
-		if (track->score < this->track_thresh) continue;
-		track->activate(this->kalman_filter, this->frame_id);
+		int track = detections[u_detection[i]];
+		if (pool[track].score < this->track_thresh) continue;
+		pool[track].activate(this->kalman_filter, this->frame_id, this->next_id());
 		activated_stracks.push_back(track);
 	}
 	////////////////// Step 5: Update state //////////////////
+	// a track last seen "in the future" is as stale as one seen long ago, the clock stepped back
 	for (int i = 0; i < this->lost_stracks.size(); i++) {
-		if (this->frame_id - this->lost_stracks[i]->end_frame() >
-			this->max_time_lost) {
-			this->lost_stracks[i]->mark_removed();
+		if (std::fabs(timestamp - pool[this->lost_stracks[i]].timestamp) > this->max_time_lost) {
+			pool[this->lost_stracks[i]].mark_removed();
 			temp_removed_stracks.push_back(this->lost_stracks[i]);
 		}
 	}
 
 	for (int i = 0; i < this->tracked_stracks.size(); i++) {
-		if (this->tracked_stracks[i]->state == TrackState::Tracked) {
+		if (pool[this->tracked_stracks[i]].state == TrackState::Tracked) {
 			tracked_stracks_swap.push_back(this->tracked_stracks[i]);
 		}
 	}
-	this->tracked_stracks.clear();
-	this->tracked_stracks.assign(tracked_stracks_swap.begin(),
-		tracked_stracks_swap.end());
+	this->tracked_stracks.swap(tracked_stracks_swap);
 
 	joint_stracks(this->tracked_stracks, activated_stracks,
 		this->tracked_stracks);
@@ -206,106 +203,193 @@ void BYTETracker::update(STracks& output_stracks,
 	sub_stracks(this->lost_stracks, this->removed_stracks);
 	for (int i = 0; i < temp_removed_stracks.size(); i++) {
 		this->removed_stracks.push_back(temp_removed_stracks[i]);
+		this->removed_times.push_back(timestamp);
 	}
+	age_out_removed();
 	remove_duplicate_stracks(resa, resb, this->tracked_stracks,
 		this->lost_stracks);
 
-	this->tracked_stracks.clear();
-	this->tracked_stracks.assign(resa.begin(), resa.end());
-	this->lost_stracks.clear();
-	this->lost_stracks.assign(resb.begin(), resb.end());
+	this->tracked_stracks.swap(resa);
+	this->lost_stracks.swap(resb);
+	release_unreferenced();
+
 	for (int i = 0; i < this->tracked_stracks.size(); i++) {
-		if (this->tracked_stracks[i]->is_activated &&
-			this->tracked_stracks[i]->tlwh[2] * this->tracked_stracks[i]->tlwh[3] >
-			this->min_box_area)
-			output_stracks.push_back(this->tracked_stracks[i]);
+		const STrack& track = pool[this->tracked_stracks[i]];
+		if (track.is_activated && track.tlwh[2] * track.tlwh[3] > this->min_box_area)
+			output_stracks.push_back(&track);
+	}
+}
+
+int BYTETracker::next_id() { return ++this->track_id_count; }
+
+// Removed tracks are only needed to take them off the lost list, keep them for
+// max_time_lost after removal. Capture timestamps may step back (a camera clock
+// reset, a reconnect), so the whole list is scanned and a track removed more than
+// max_time_lost away from now in either direction goes.
+void BYTETracker::age_out_removed() {
+	int kept = 0;
+	for (int i = 0; i < this->removed_times.size(); i++) {
+		if (std::fabs(this->timestamp - this->removed_times[i]) > this->max_time_lost) continue;
+		this->removed_stracks[kept] = this->removed_stracks[i];
+		this->removed_times[kept] = this->removed_times[i];
+		kept++;
+	}
+	this->removed_stracks.resize(kept);
+	this->removed_times.resize(kept);
+}
+
+// Give back every pooled track that is no longer on the tracked, lost or removed
+// list, which covers the detections of this frame that did not start a track and
+// tracks dropped as duplicates.
+void BYTETracker::release_unreferenced() {
+	referenced.assign(pool.capacity(), 0);
+	for (int i = 0; i < this->tracked_stracks.size(); i++) referenced[this->tracked_stracks[i]] = 1;
+	for (int i = 0; i < this->lost_stracks.size(); i++) referenced[this->lost_stracks[i]] = 1;
+	for (int i = 0; i < this->removed_stracks.size(); i++) referenced[this->removed_stracks[i]] = 1;
+	for (int h = 0; h < pool.capacity(); h++) {
+		if (pool.is_allocated(h) && !referenced[h]) pool.release(h);
 	}
 }
 
-void BYTETracker::joint_stracks(STracks& tlista, STracks& tlistb,
-	STracks& results) {
-	std::map<int, int> exists;
+// Starts an empty set of pool handles, O(1) unless the stamp wraps around.
+void BYTETracker::begin_marks() {
+	if (marks.size() < pool.capacity()) marks.resize(pool.capacity(), 0);
+	if (++mark_generation == 0) {
+		std::fill(marks.begin(), marks.end(), 0);
+		mark_generation = 1;
+	}
+}
+
+// Appends the tracks of tlista then tlistb that are not in results yet, keeping
+// their order. results may be the same list as tlista.
+void BYTETracker::joint_stracks(Handles& tlista, Handles& tlistb,
+	Handles& results) {
+	begin_marks();
 	for (int i = 0; i < results.size(); i++)
-		exists.insert(std::pair<int, int>(results[i]->track_id, 1));
+		marks[results[i]] = mark_generation;
 
 	for (int i = 0; i < tlista.size(); i++) {
-		int tid = tlista[i]->track_id;
-		if (!exists[tid] || exists.count(tid) == 0) {
-			exists[tid] = 1;
-			results.push_back(tlista[i]);
+		int h = tlista[i];
+		if (marks[h] != mark_generation) {
+			marks[h] = mark_generation;
+			results.push_back(h);
 		}
 	}
 	for (int i = 0; i < tlistb.size(); i++) {
-		int tid = tlistb[i]->track_id;
-		if (!exists[tid] || exists.count(tid) == 0) {
-			exists[tid] = 1;
-			results.push_back(tlistb[i]);
+		int h = tlistb[i];
+		if (marks[h] != mark_generation) {
+			marks[h] = mark_generation;
+			results.push_back(h);
 		}
 	}
 }
 
-void BYTETracker::sub_stracks(STracks& tlista, STracks& tlistb) {
-	std::map<int, std::shared_ptr<STrack>> stracks;
-	for (int i = 0; i < tlista.size(); i++)
-		stracks.insert(std::pair<int, std::shared_ptr<STrack>>(tlista[i]->track_id,
-			tlista[i]));
-	for (int i = 0; i < tlistb.size(); i++) {
-		int tid = tlistb[i]->track_id;
-		if (stracks.count(tid) != 0) stracks.erase(tid);
+// Removes from tlista the tracks that are in tlistb and leaves the rest sorted by
+// track id, the order the id keyed map gave the lost list before.
+void BYTETracker::sub_stracks(Handles& tlista, Handles& tlistb) {
+	begin_marks();
+	for (int i = 0; i < tlistb.size(); i++)
+		marks[tlistb[i]] = mark_generation;
+
+	int kept = 0;
+	for (int i = 0; i < tlista.size(); i++) {
+		if (marks[tlista[i]] != mark_generation) tlista[kept++] = tlista[i];
 	}
-	tlista.clear();
-	for (std::map<int, std::shared_ptr<STrack>>::iterator it = stracks.begin();
-		it != stracks.end(); ++it)
-		tlista.push_back(it->second);
+	tlista.resize(kept);
+	std::sort(tlista.begin(), tlista.end(), [this](int a, int b) {
+		return pool[a].track_id < pool[b].track_id;
+	});
 }
 
-void BYTETracker::remove_duplicate_stracks(STracks& resa, STracks& resb,
-	STracks& stracksa,
-	STracks& stracksb) {
-	std::vector<std::vector<float>> pdist;
-	iou_distance(stracksa, stracksb, pdist);
-	std::vector<std::pair<int, int>> pairs;
-	for (int i = 0; i < pdist.size(); i++) {
-		for (int j = 0; j < pdist[i].size(); j++) {
-			if (pdist[i][j] < 0.15) {
-				pairs.push_back(std::pair<int, int>(i, j));
+void BYTETracker::remove_duplicate_stracks(Handles& resa, Handles& resb,
+	Handles& stracksa, Handles& stracksb) {
+	pairs.clear();
+	if (sparse_association) {
+		sparse_iou_distance(stracksa, stracksb, 0.15f, false);
+		for (int i = 0; i < stracksa.size(); i++) {
+			for (int k = sparse_row_ptr[i]; k < sparse_row_ptr[i + 1]; k++) {
+				pairs.push_back(std::pair<int, int>(i, sparse_cols[k]));
+			}
+		}
+	}
+	else {
+		iou_distance(stracksa, stracksb, dists);
+		int n_cols = stracksb.size();
+		for (int i = 0; i < stracksa.size(); i++) {
+			for (int j = 0; j < n_cols; j++) {
+				if (dists[i * n_cols + j] < 0.15) {
+					pairs.push_back(std::pair<int, int>(i, j));
+				}
 			}
 		}
 	}
 
-	std::vector<int> dupa, dupb;
+	// dupa[i] / dupb[j] flag the positions that lose a duplicate pair
+	dupa.assign(stracksa.size(), 0);
+	dupb.assign(stracksb.size(), 0);
 	for (int i = 0; i < pairs.size(); i++) {
-		int timep = stracksa[pairs[i].first]->frame_id -
-			stracksa[pairs[i].first]->start_frame;
-		int timeq = stracksb[pairs[i].second]->frame_id -
-			stracksb[pairs[i].second]->start_frame;
+		const STrack& p = pool[stracksa[pairs[i].first]];
+		const STrack& q = pool[stracksb[pairs[i].second]];
+		int timep = p.frame_id - p.start_frame;
+		int timeq = q.frame_id - q.start_frame;
 		if (timep > timeq)
-			dupb.push_back(pairs[i].second);
+			dupb[pairs[i].second] = 1;
 		else
-			dupa.push_back(pairs[i].first);
+			dupa[pairs[i].first] = 1;
 	}
 
 	for (int i = 0; i < stracksa.size(); i++) {
-		std::vector<int>::iterator iter = find(dupa.begin(), dupa.end(), i);
-		if (iter == dupa.end()) {
-			resa.push_back(stracksa[i]);
-		}
+		if (!dupa[i]) resa.push_back(stracksa[i]);
 	}
 
 	for (int i = 0; i < stracksb.size(); i++) {
-		std::vector<int>::iterator iter = find(dupb.begin(), dupb.end(), i);
-		if (iter == dupb.end()) {
-			resb.push_back(stracksb[i]);
+		if (!dupb[i]) resb.push_back(stracksb[i]);
+	}
+}
+
+void BYTETracker::associate(const Handles& atracks, const Handles& btracks,
+	float thresh, std::vector<std::pair<int, int>>& matches,
+	std::vector<int>& unmatched_a, std::vector<int>& unmatched_b) {
+	int n_rows = atracks.size();
+	int n_cols = btracks.size();
+	if (!sparse_association) {
+		iou_distance(atracks, btracks, dists);
+		linear_assignment(dists, n_rows, n_cols, thresh, matches, unmatched_a,
+			unmatched_b);
+		return;
+	}
+
+	sparse_iou_distance(atracks, btracks, thresh, motion_gating);
+	assign_rowsol.resize(n_rows);
+	assign_colsol.resize(n_cols);
+	if (lap_solver.solve_sparse(sparse_row_ptr.data(), sparse_cols.data(),
+		sparse_costs.data(), n_rows, n_cols, thresh, assign_rowsol.data(),
+		assign_colsol.data()) != 0) {
+		std::cout << "linear assignment failed, leaving all unmatched" << std::endl;
+		std::fill(assign_rowsol.begin(), assign_rowsol.end(), -1);
+		std::fill(assign_colsol.begin(), assign_colsol.end(), -1);
+	}
+	for (int i = 0; i < n_rows; i++) {
+		if (assign_rowsol[i] >= 0) {
+			matches.push_back(std::pair<int, int>(i, assign_rowsol[i]));
+		}
+		else {
+			unmatched_a.push_back(i);
+		}
+	}
+	for (int i = 0; i < n_cols; i++) {
+		if (assign_colsol[i] < 0) {
+			unmatched_b.push_back(i);
 		}
 	}
 }
 
 void BYTETracker::linear_assignment(
-	std::vector<std::vector<float>>& cost_matrix, int cost_matrix_size,
+	const std::vector<float>& cost_matrix, int cost_matrix_size,
 	int cost_matrix_size_size, float thresh,
-	std::vector<std::vector<int>>& matches, std::vector<int>& unmatched_a,
+	std::vector<std::pair<int, int>>& matches, std::vector<int>& unmatched_a,
 	std::vector<int>& unmatched_b) {
-	if (cost_matrix.size() == 0) {
+	if (cost_matrix_size * cost_matrix_size_size == 0) {
 		for (int i = 0; i < cost_matrix_size; i++) {
 			unmatched_a.push_back(i);
 		}
@@ -314,205 +398,209 @@ void BYTETracker::linear_assignment(
 		}
 		return;
 	}
-	std::vector<int> rowsol;
-	std::vector<int> colsol;
-	lapjv(cost_matrix, rowsol, colsol, true, thresh);
-	for (int i = 0; i < rowsol.size(); i++) {
-		if (rowsol[i] >= 0) {
-			std::vector<int> match;
-			match.push_back(i);
-			match.push_back(rowsol[i]);
-			matches.push_back(match);
+	int n_rows = cost_matrix_size;
+	int n_cols = cost_matrix_size_size;
+	assign_rowsol.resize(n_rows);
+	assign_colsol.resize(n_cols);
+	if (lap_solver.solve(cost_matrix.data(), n_rows, n_cols, thresh,
+		assign_rowsol.data(), assign_colsol.data()) != 0) {
+		std::cout << "linear assignment failed, leaving all unmatched" << std::endl;
+		std::fill(assign_rowsol.begin(), assign_rowsol.end(), -1);
+		std::fill(assign_colsol.begin(), assign_colsol.end(), -1);
+	}
+
+	for (int i = 0; i < n_rows; i++) {
+		if (assign_rowsol[i] >= 0) {
+			matches.push_back(std::pair<int, int>(i, assign_rowsol[i]));
 		}
 		else {
 			unmatched_a.push_back(i);
 		}
 	}
-	for (int i = 0; i < colsol.size(); i++) {
-		if (colsol[i] < 0) {
+	for (int i = 0; i < n_cols; i++) {
+		if (assign_colsol[i] < 0) {
 			unmatched_b.push_back(i);
 		}
 	}
 }
 
-void BYTETracker::ious(std::vector<std::vector<float>>& atlbrs,
-	std::vector<std::vector<float>>& btlbrs,
-	std::vector<std::vector<float>>& results) {
-	if (atlbrs.size() * btlbrs.size() == 0) return;
-
-	results.resize(atlbrs.size());
-	for (int i = 0; i < results.size(); i++) {
-		results[i].resize(btlbrs.size());
-	}
-
-	// bbox_ious
-	for (int k = 0; k < btlbrs.size(); k++) {
-		std::vector<float> ious_tmp;
-		float box_area =
-			(btlbrs[k][2] - btlbrs[k][0] + 1) * (btlbrs[k][3] - btlbrs[k][1] + 1);
-		for (int n = 0; n < atlbrs.size(); n++) {
-			float iw = std::min(atlbrs[n][2], btlbrs[k][2]) -
-				std::max(atlbrs[n][0], btlbrs[k][0]) + 1;
-			if (iw > 0) {
-				float ih = std::min(atlbrs[n][3], btlbrs[k][3]) -
-					std::max(atlbrs[n][1], btlbrs[k][1]) + 1;
-				if (ih > 0) {
-					float ua = (atlbrs[n][2] - atlbrs[n][0] + 1) *
-						(atlbrs[n][3] - atlbrs[n][1] + 1) +
-						box_area - iw * ih;
-					results[n][k] = iw * ih / ua;
-				}
-				else {
-					results[n][k] = 0.0;
-				}
-			}
-			else {
-				results[n][k] = 0.0;
-			}
-		}
+void BYTETracker::BoxArray::assign(const STrackPool& pool, const Handles& tracks) {
+	int n = tracks.size();
+	x1.resize(n);
+	y1.resize(n);
+	x2.resize(n);
+	y2.resize(n);
+	area.resize(n);
+	for (int i = 0; i < n; i++) {
+		const STrack::Box& tlbr = pool[tracks[i]].tlbr;
+		x1[i] = tlbr[0];
+		y1[i] = tlbr[1];
+		x2[i] = tlbr[2];
+		y2[i] = tlbr[3];
+		area[i] = (tlbr[2] - tlbr[0] + 1) * (tlbr[3] - tlbr[1] + 1);
 	}
 }
 
-void BYTETracker::iou_distance(const STracks& atracks, const STracks& btracks,
-	std::vector<std::vector<float>>& cost_matrix) {
-	if (atracks.size() * btracks.size() == 0) return;
-
-	std::vector<std::vector<float>> atlbrs, btlbrs;
-	for (int i = 0; i < atracks.size(); i++) {
-		atlbrs.push_back(atracks[i]->tlbr);
-	}
-	for (int i = 0; i < btracks.size(); i++) {
-		btlbrs.push_back(btracks[i]->tlbr);
-	}
-
-	std::vector<std::vector<float>> _ious;
-	ious(atlbrs, btlbrs, _ious);
-	for (int i = 0; i < _ious.size(); i++) {
-		std::vector<float> _iou;
-		for (int j = 0; j < _ious[i].size(); j++) {
-			_iou.push_back(1 - _ious[i][j]);
-		}
-		cost_matrix.push_back(_iou);
+// cost[j] = 1 - IoU(box i of a, box j of b) for every j. Written without branches
+// so that it vectorizes: a pair that does not overlap gets a zero intersection.
+void BYTETracker::iou_cost_row(const BoxArray& a, int i, const BoxArray& b,
+	float* cost) {
+	const float ax1 = a.x1[i], ay1 = a.y1[i], ax2 = a.x2[i], ay2 = a.y2[i];
+	const float a_area = a.area[i];
+	const float* bx1 = b.x1.data();
+	const float* by1 = b.y1.data();
+	const float* bx2 = b.x2.data();
+	const float* by2 = b.y2.data();
+	const float* b_area = b.area.data();
+	int n = b.x1.size();
+	for (int j = 0; j < n; j++) {
+		float iw = std::max(std::min(ax2, bx2[j]) - std::max(ax1, bx1[j]) + 1, 0.f);
+		float ih = std::max(std::min(ay2, by2[j]) - std::max(ay1, by1[j]) + 1, 0.f);
+		float inter = iw * ih;
+		cost[j] = 1 - inter / (a_area + b_area[j] - inter);
 	}
 }
 
-void BYTETracker::lapjv(const std::vector<std::vector<float>>& cost,
-	std::vector<int>& rowsol, std::vector<int>& colsol,
-	bool extend_cost, float cost_limit, bool return_cost) {
-	std::vector<std::vector<float>> cost_c;
-	cost_c.assign(cost.begin(), cost.end());
-
-	std::vector<std::vector<float>> cost_c_extended;
+void BYTETracker::iou_distance(const Handles& atracks, const Handles& btracks,
+	std::vector<float>& cost_matrix) {
+	int n_rows = atracks.size();
+	int n_cols = btracks.size();
+	cost_matrix.resize(n_rows * n_cols);
+	if (n_rows * n_cols == 0) return;
 
-	int n_rows = cost.size();
-	int n_cols = cost[0].size();
-	rowsol.resize(n_rows);
-	colsol.resize(n_cols);
-
-	int n = 0;
-	if (n_rows == n_cols) {
-		n = n_rows;
-	}
-	else {
-		if (!extend_cost) {
-			std::cout << "set extend_cost=True" << std::endl;
-			system("pause");
-			exit(0);
-		}
+	boxes_a.assign(pool, atracks);
+	boxes_b.assign(pool, btracks);
+	for (int i = 0; i < n_rows; i++) {
+		iou_cost_row(boxes_a, i, boxes_b, cost_matrix.data() + i * n_cols);
 	}
-	if (extend_cost || cost_limit < LONG_MAX) {
-		n = n_rows + n_cols;
-		cost_c_extended.resize(n);
-
-		for (int i = 0; i < cost_c_extended.size(); i++)
-			cost_c_extended[i].resize(n);
+}
 
-		if (cost_limit < LONG_MAX) {
-			for (int i = 0; i < cost_c_extended.size(); i++) {
-				for (int j = 0; j < cost_c_extended[i].size(); j++) {
-					cost_c_extended[i][j] = cost_limit / 2.0;
-				}
-			}
-		}
-		else {
-			float cost_max = -1;
-			for (int i = 0; i < cost_c.size(); i++) {
-				for (int j = 0; j < cost_c[i].size(); j++) {
-					if (cost_c[i][j] > cost_max) cost_max = cost_c[i][j];
-				}
-			}
-			for (int i = 0; i < cost_c_extended.size(); i++) {
-				for (int j = 0; j < cost_c_extended[i].size(); j++) {
-					cost_c_extended[i][j] = cost_max + 1;
+void BYTETracker::build_grid(const BoxArray& b) {
+	int n = b.x1.size();
+	float x_max = b.x2[0], y_max = b.y2[0];
+	float side_sum = 0;
+	grid_x0 = b.x1[0];
+	grid_y0 = b.y1[0];
+	for (int j = 0; j < n; j++) {
+		grid_x0 = std::min(grid_x0, b.x1[j]);
+		grid_y0 = std::min(grid_y0, b.y1[j]);
+		x_max = std::max(x_max, b.x2[j]);
+		y_max = std::max(y_max, b.y2[j]);
+		side_sum += (b.x2[j] - b.x1[j]) + (b.y2[j] - b.y1[j]);
+	}
+	// about one box per cell, with at most 256 cells per side
+	const int max_side = 256;
+	grid_cell = std::max(side_sum / (2 * n), 1.f);
+	grid_cell = std::max(grid_cell, (x_max - grid_x0) / (max_side - 1));
+	grid_cell = std::max(grid_cell, (y_max - grid_y0) / (max_side - 1));
+	grid_w = std::min(int((x_max - grid_x0) / grid_cell) + 1, max_side);
+	grid_h = std::min(int((y_max - grid_y0) / grid_cell) + 1, max_side);
+
+	// counting sort of the boxes into every cell they cover
+	grid_start.assign(grid_w * grid_h + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		for (int j = 0; j < n; j++) {
+			int cx0, cx1, cy0, cy1;
+			grid_range(b.x1[j], b.x2[j], grid_x0, grid_w, cx0, cx1);
+			grid_range(b.y1[j], b.y2[j], grid_y0, grid_h, cy0, cy1);
+			for (int cy = cy0; cy <= cy1; cy++) {
+				for (int cx = cx0; cx <= cx1; cx++) {
+					if (pass == 0)
+						grid_start[cy * grid_w + cx + 1]++;
+					else
+						grid_items[grid_start[cy * grid_w + cx]++] = j;
 				}
 			}
 		}
-		for (int i = n_rows; i < cost_c_extended.size(); i++) {
-			for (int j = n_cols; j < cost_c_extended[i].size(); j++) {
-				cost_c_extended[i][j] = 0;
+		if (pass == 0) {
+			for (int c = 0; c < grid_w * grid_h; c++) {
+				grid_start[c + 1] += grid_start[c];
 			}
+			grid_items.resize(grid_start[grid_w * grid_h]);
 		}
-		for (int i = 0; i < n_rows; i++) {
-			for (int j = 0; j < n_cols; j++) {
-				cost_c_extended[i][j] = cost_c[i][j];
+		else {
+			// the fill pass advanced every start to the next cell's start
+			for (int c = grid_w * grid_h; c > 0; c--) {
+				grid_start[c] = grid_start[c - 1];
 			}
-		}
-
-		cost_c.clear();
-		cost_c.assign(cost_c_extended.begin(), cost_c_extended.end());
-	}
-	double** cost_ptr;
-	cost_ptr = new double* [sizeof(double*) * n];
-	for (int i = 0; i < n; i++) cost_ptr[i] = new double[sizeof(double) * n];
-
-	for (int i = 0; i < n; i++) {
-		for (int j = 0; j < n; j++) {
-			cost_ptr[i][j] = cost_c[i][j];
+			grid_start[0] = 0;
 		}
 	}
+}
 
-	int* x_c = new int[sizeof(int) * n];
-	int* y_c = new int[sizeof(int) * n];
-
-	int ret = lapjv_internal(n, cost_ptr, x_c, y_c);
-	if (ret != 0) {
-		std::cout << "Calculate Wrong!" << std::endl;
-		system("pause");
-		exit(0);
-	}
+void BYTETracker::grid_range(float lo, float hi, float origin, int side,
+	int& first, int& last) const {
+	first = std::min(std::max(int(std::floor((lo - origin) / grid_cell)), 0), side - 1);
+	last = std::min(std::max(int(std::floor((hi - origin) / grid_cell)), 0), side - 1);
+}
 
-	double opt = 0.0;
-	if (n != n_rows) {
-		for (int i = 0; i < n; i++) {
-			if (x_c[i] >= n_cols) x_c[i] = -1;
-			if (y_c[i] >= n_rows) y_c[i] = -1;
-		}
-		for (int i = 0; i < n_rows; i++) {
-			rowsol[i] = x_c[i];
-		}
-		for (int i = 0; i < n_cols; i++) {
-			colsol[i] = y_c[i];
+void BYTETracker::sparse_iou_distance(const Handles& atracks,
+	const Handles& btracks, float max_cost, bool gate) {
+	int n_rows = atracks.size();
+	int n_cols = btracks.size();
+	sparse_row_ptr.assign(n_rows + 1, 0);
+	sparse_cols.clear();
+	sparse_costs.clear();
+	if (n_rows * n_cols == 0) return;
+
+	boxes_a.assign(pool, atracks);
+	boxes_b.assign(pool, btracks);
+	build_grid(boxes_b);
+	grid_stamp.assign(n_cols, -1);
+
+	KalmanFilter::Mean mean;
+	KalmanFilter::Covariance covariance;
+	for (int i = 0; i < n_rows; i++) {
+		int row_begin = sparse_cols.size();
+		const float ax1 = boxes_a.x1[i], ay1 = boxes_a.y1[i];
+		const float ax2 = boxes_a.x2[i], ay2 = boxes_a.y2[i];
+		// boxes within one pixel still overlap under the +1 area convention
+		int cx0, cx1, cy0, cy1;
+		grid_range(ax1 - 1, ax2 + 1, grid_x0, grid_w, cx0, cx1);
+		grid_range(ay1 - 1, ay2 + 1, grid_y0, grid_h, cy0, cy1);
+		for (int cy = cy0; cy <= cy1; cy++) {
+			for (int cx = cx0; cx <= cx1; cx++) {
+				int c = cy * grid_w + cx;
+				for (int k = grid_start[c]; k < grid_start[c + 1]; k++) {
+					int j = grid_items[k];
+					if (grid_stamp[j] == i) continue;
+					grid_stamp[j] = i;
+
+					// same arithmetic as iou_cost_row so both modes see identical costs
+					float iw = std::max(std::min(ax2, boxes_b.x2[j]) - std::max(ax1, boxes_b.x1[j]) + 1, 0.f);
+					float ih = std::max(std::min(ay2, boxes_b.y2[j]) - std::max(ay1, boxes_b.y1[j]) + 1, 0.f);
+					float inter = iw * ih;
+					float cost = 1 - inter / (boxes_a.area[i] + boxes_b.area[j] - inter);
+					if (cost < max_cost) {
+						sparse_cols.push_back(j);
+						sparse_costs.push_back(cost);
+					}
+				}
+			}
 		}
 
-		if (return_cost) {
-			for (int i = 0; i < rowsol.size(); i++) {
-				if (rowsol[i] != -1) {
-					// cout << i << "\t" << rowsol[i] << "\t" << cost_ptr[i][rowsol[i]] <<
-					// endl;
-					opt += cost_ptr[i][rowsol[i]];
+		if (gate && pool[atracks[i]].get_kalman_state(mean, covariance)) {
+			int row_end = sparse_cols.size();
+			gate_measurements.resize(row_end - row_begin);
+			for (int k = row_begin; k < row_end; k++) {
+				int j = sparse_cols[k];
+				float w = boxes_b.x2[j] - boxes_b.x1[j];
+				float h = boxes_b.y2[j] - boxes_b.y1[j];
+				KalmanFilter::Measurement z = { boxes_b.x1[j] + w / 2, boxes_b.y1[j] + h / 2, w / h, h };
+				gate_measurements[k - row_begin] = z;
+			}
+			kalman_filter.gating_distance(mean, covariance, gate_measurements, gate_distances);
+			int kept = row_begin;
+			for (int k = row_begin; k < row_end; k++) {
+				if (gate_distances[k - row_begin] <= KalmanFilter::kGatingThreshold) {
+					sparse_cols[kept] = sparse_cols[k];
+					sparse_costs[kept] = sparse_costs[k];
+					kept++;
 				}
 			}
+			sparse_cols.resize(kept);
+			sparse_costs.resize(kept);
 		}
+		sparse_row_ptr[i + 1] = sparse_cols.size();
 	}
-	else if (return_cost) {
-		for (int i = 0; i < rowsol.size(); i++) {
-			opt += cost_ptr[i][rowsol[i]];
-		}
-	}
-	for (int i = 0; i < n; i++) {
-		delete[] cost_ptr[i];
-	}
-	delete[] cost_ptr;
-	delete[] x_c;
-	delete[] y_c;
 }
@@ -24,6 +24,9 @@ struct bytetrack_params {
 	int frame_rate;
 	int track_buffer;
 	int min_box_area;
+	// association:
+	bool sparse_association = false;  // grid pruned sparse costs, false keeps the dense reference path
+	bool motion_gating = false;       // sparse only, also drop pairs outside the Kalman gate
 };
 
 class BYTETracker {
@@ -34,33 +37,71 @@ public:
 	TimeStamp* m_ts;
 	void enableProfile(TimeStamp* ts);
 
+	// output_stracks receives pointers into the tracker's pool, valid until the
+	// next call. timestamp is the capture time of the frame in seconds: motion is
+	// predicted over the real interval since the previous frame and lost tracks
+	// expire after a time, so dropped frames and jittery sources are handled.
+	void update(STracks& output_stracks, const std::vector<YoloV5Box>& objects,
+		double timestamp);
+	// frames assumed to be exactly 1 / frame_rate apart
 	void update(STracks& output_stracks, const std::vector<YoloV5Box>& objects);
 
 private:
-	void joint_stracks(STracks& tlista, STracks& tlistb, STracks& results);
+	// tests/ runs the set operations and the association modes against reference versions
+	friend struct BYTETrackerTestAccess;
 
-	void sub_stracks(STracks& tlista, STracks& tlistb);
+	// handles into pool
+	using Handles = std::vector<int>;
 
-	void remove_duplicate_stracks(STracks& resa, STracks& resb, STracks& stracksa,
-		STracks& stracksb);
+	// set operations over pool handles, each track is in a list at most once
+	void begin_marks();
 
-	void linear_assignment(std::vector<std::vector<float>>& cost_matrix,
+	void joint_stracks(Handles& tlista, Handles& tlistb, Handles& results);
+
+	void sub_stracks(Handles& tlista, Handles& tlistb);
+
+	void remove_duplicate_stracks(Handles& resa, Handles& resb, Handles& stracksa,
+		Handles& stracksb);
+
+	void release_unreferenced();
+
+	// ids are unique per tracker, each stream counts from 1
+	int next_id();
+
+	void age_out_removed();
+
+	// match atracks to btracks on 1 - IoU below thresh, dense or sparse
+	void associate(const Handles& atracks, const Handles& btracks, float thresh,
+		std::vector<std::pair<int, int>>& matches, std::vector<int>& unmatched_a,
+		std::vector<int>& unmatched_b);
+
+	// cost_matrix is row major cost_matrix_size x cost_matrix_size_size
+	void linear_assignment(const std::vector<float>& cost_matrix,
 		int cost_matrix_size, int cost_matrix_size_size,
-		float thresh, std::vector<std::vector<int>>& matches,
+		float thresh, std::vector<std::pair<int, int>>& matches,
 		std::vector<int>& unmatched_a,
 		std::vector<int>& unmatched_b);
 
-	void iou_distance(const STracks& atracks, const STracks& btracks,
-		std::vector<std::vector<float>>& cost_matrix);
+	// 1 - IoU of every pair, row major atracks.size() x btracks.size()
+	void iou_distance(const Handles& atracks, const Handles& btracks,
+		std::vector<float>& cost_matrix);
+
+	// box corners of one side of an association, one plane per coordinate so
+	// that the IoU kernel reads them as contiguous arrays
+	struct BoxArray {
+		std::vector<float> x1, y1, x2, y2, area;
+		void assign(const STrackPool& pool, const Handles& tracks);
+	};
 
-	void ious(std::vector<std::vector<float>>& atlbrs,
-		std::vector<std::vector<float>>& btlbrs,
-		std::vector<std::vector<float>>& results);
+	static void iou_cost_row(const BoxArray& a, int i, const BoxArray& b, float* cost);
 
-	void lapjv(const std::vector<std::vector<float>>& cost,
-		std::vector<int>& rowsol, std::vector<int>& colsol,
-		bool extend_cost = false, float cost_limit = LONG_MAX,
-		bool return_cost = true);
+	// pairs with 1 - IoU below max_cost into sparse_row_ptr/cols/costs
+	void sparse_iou_distance(const Handles& atracks, const Handles& btracks,
+		float max_cost, bool gate);
+
+	// uniform grid over the boxes of b, cell c lists grid_items[grid_start[c], grid_start[c + 1])
+	void build_grid(const BoxArray& b);
+	void grid_range(float lo, float hi, float origin, int side, int& first, int& last) const;
 
 private:
 	float track_thresh;
@@ -69,13 +110,61 @@ private:
 	int track_buffer;
 	int min_box_area;
 	int frame_id;
-	int max_time_lost;
-
-	STracks tracked_stracks;
-	STracks lost_stracks;
-	STracks removed_stracks;
-
-	std::shared_ptr<KalmanFilter> kalman_filter;
+	double timestamp;      // capture time of the current frame, seconds
+	double max_time_lost;  // seconds
+	bool sparse_association;
+	bool motion_gating;
+
+	// declared before pool, whose tracks give their Kalman slots back on destruction
+	KalmanFilter kalman_filter;
+	STrackPool pool;
+
+	Handles tracked_stracks;
+	Handles lost_stracks;
+	Handles removed_stracks;
+	std::vector<double> removed_times;  // timestamp at which removed_stracks[i] was removed
+	int track_id_count;
+
+	// per frame lists, members so that their capacity is reused
+	Handles activated_stracks;
+	Handles refind_stracks;
+	Handles detections;
+	Handles detections_low;
+	Handles detections_cp;
+	Handles tracked_stracks_swap;
+	Handles resa, resb;
+	Handles temp_tracked_stracks;
+	Handles temp_lost_stracks;
+	Handles temp_removed_stracks;
+	Handles unconfirmed;
+	Handles strack_pool;
+	Handles r_tracked_stracks;
+	std::vector<std::pair<int, int>> matches;
+	std::vector<std::pair<int, int>> pairs;
+	std::vector<char> dupa, dupb;
+	// marks[h] == mark_generation while h is in the set being built
+	std::vector<unsigned int> marks;
+	unsigned int mark_generation;
+	std::vector<int> u_track, u_detection, u_unconfirmed;
+	std::vector<char> referenced;
+
+	// association scratch reused across frames
+	BoxArray boxes_a;
+	BoxArray boxes_b;
+	std::vector<float> dists;
+	std::vector<int> sparse_row_ptr;
+	std::vector<int> sparse_cols;
+	std::vector<float> sparse_costs;
+	float grid_x0, grid_y0, grid_cell;
+	int grid_w, grid_h;
+	std::vector<int> grid_start;
+	std::vector<int> grid_items;
+	std::vector<int> grid_stamp;
+	std::vector<KalmanFilter::Measurement> gate_measurements;
+	std::vector<float> gate_distances;
+	LapSolver lap_solver;
+	std::vector<int> assign_rowsol;
+	std::vector<int> assign_colsol;
 };
 
 #endif  // BYTETRACK_H
\ No newline at end of file
@@ -68,6 +68,14 @@ void bytetrack_yaml_parse(const std::string& config_path,
 			std::istringstream iss(value);
 			iss >> params.min_box_area;
 		}
+		else if (key == "SPARSE_ASSOCIATION") {
+			std::istringstream iss(value);
+			iss >> params.sparse_association;
+		}
+		else if (key == "MOTION_GATING") {
+			std::istringstream iss(value);
+			iss >> params.motion_gating;
+		}
 	}
 }
 
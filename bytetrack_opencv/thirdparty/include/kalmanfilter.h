@@ -9,28 +9,365 @@
 
 #ifndef KALMANFILTER_H
 #define KALMANFILTER_H
-#include <opencv2/opencv.hpp>
-#include <iostream>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Kalman states of all tracks of one tracker, stored as a structure of arrays:
+ * component e of slot i lives at data[e * capacity + i]. Components 0-7 are the
+ * mean, 8-43 the upper triangle of the symmetric covariance packed row by row.
+ * Slots are handed out by acquire() and recycled by release().
+ */
+class KalmanStates {
+public:
+	static const int kMeanSize = 8;
+	static const int kCovSize = 36;
+	static const int kComponents = kMeanSize + kCovSize;
+
+	// index of (i, j) in the packed covariance
+	static constexpr int packed(int i, int j) {
+		return i <= j ? i * 8 - i * (i - 1) / 2 + (j - i) : packed(j, i);
+	}
+
+	int capacity() const { return m_capacity; }
+
+	int acquire() {
+		if (m_free.empty()) {
+			grow(m_capacity ? m_capacity * 2 : 64);
+		}
+		int slot = m_free.back();
+		m_free.pop_back();
+		return slot;
+	}
+
+	void release(int slot) {
+		assert(slot >= 0 && slot < m_capacity);
+		m_predict[slot] = 0.f;
+		m_free.push_back(slot);
+	}
+
+	float& at(int component, int slot) { return m_data[component * m_capacity + slot]; }
+	float at(int component, int slot) const { return m_data[component * m_capacity + slot]; }
+
+	template <typename Mean, typename Covariance>
+	void load(int slot, Mean& mean, Covariance& covariance) const {
+		for (int i = 0; i < 8; i++) {
+			mean[i] = at(i, slot);
+			for (int j = i; j < 8; j++) {
+				covariance[i * 8 + j] = covariance[j * 8 + i] = at(kMeanSize + packed(i, j), slot);
+			}
+		}
+	}
+
+	// the covariance is symmetrized on the way in
+	template <typename Mean, typename Covariance>
+	void store(int slot, const Mean& mean, const Covariance& covariance) {
+		for (int i = 0; i < 8; i++) {
+			at(i, slot) = mean[i];
+			for (int j = i; j < 8; j++) {
+				at(kMeanSize + packed(i, j), slot) = 0.5f * (covariance[i * 8 + j] + covariance[j * 8 + i]);
+			}
+		}
+	}
+
+	// slots flagged here take part in the next batched predict, the flags are
+	// cleared by it
+	void mark_predict(int slot) {
+		m_predict[slot] = 1.f;
+		m_predict_end = std::max(m_predict_end, slot + 1);
+	}
+
+private:
+	friend class KalmanFilter;
+
+	void grow(int capacity) {
+		std::vector<float> data(static_cast<size_t>(kComponents) * capacity, 0.f);
+		for (int e = 0; e < kComponents; e++) {
+			for (int i = 0; i < m_capacity; i++) {
+				data[e * capacity + i] = m_data[e * m_capacity + i];
+			}
+		}
+		m_data.swap(data);
+		m_predict.resize(capacity, 0.f);
+		for (int i = capacity - 1; i >= m_capacity; i--) {
+			m_free.push_back(i);
+		}
+		m_capacity = capacity;
+	}
+
+	int m_capacity = 0;
+	std::vector<float> m_data;
+	std::vector<float> m_predict;  // 1 or 0 per slot
+	int m_predict_end = 0;          // past the last flagged slot
+	std::vector<int> m_free;
+};
+
+/*
+ * Constant velocity Kalman filter on the state (x, y, a, h, vx, vy, va, vh), where
+ * (x, y) is the box center, a the aspect ratio and h the height.
+ * The transition is F = [I dt*I; 0 I], dt in nominal frame periods (velocities are
+ * per frame and the noise weights were tuned at one unit per frame), and the
+ * measurement H = [I 0] selects the first four states, so both are applied as
+ * block arithmetic on fixed size arrays instead of general matrix products. Mean
+ * and covariance are updated in place and nothing is allocated. Tracks keep their state in the filter's KalmanStates so that the
+ * per frame prediction runs over all of them at once.
+ */
 class KalmanFilter {
 public:
-	static const double chi2inv95[10];
-	KalmanFilter();
-	~KalmanFilter();
-	std::pair<cv::Mat, cv::Mat> initiate(const cv::Mat& measurement);
-	std::pair<cv::Mat, cv::Mat> predict(const cv::Mat& mean,
-		const cv::Mat& covariance);
-	std::pair<cv::Mat, cv::Mat> update(const cv::Mat& mean,
-		const cv::Mat& covariance,
-		const cv::Mat& measurement);
-	cv::Mat gating_distance(const cv::Mat& mean, const cv::Mat& covariance,
-		const std::vector<cv::Mat>& measurements,
-		bool only_position = false);
+	using Mean = std::array<float, 8>;
+	using Covariance = std::array<float, 64>;  // row major 8x8
+	using Measurement = std::array<float, 4>;  // x, y, a, h
+
+	// 0.95 quantile of the chi-square distribution with 4 degrees of freedom, the
+	// gate for gating_distance()
+	static constexpr float kGatingThreshold = 9.4877f;
+
+	KalmanFilter() : _std_weight_position(1.f / 20), _std_weight_velocity(1.f / 160) {}
+
+	// states of the tracks filtered by this instance
+	KalmanStates& states() { return _states; }
+
+	void initiate(const Measurement& measurement, Mean& mean, Covariance& covariance) const {
+		float h = measurement[3];
+		float std_dev[8] = {
+			2 * _std_weight_position * h, 2 * _std_weight_position * h, 1e-2f, 2 * _std_weight_position * h,
+			10 * _std_weight_velocity * h, 10 * _std_weight_velocity * h, 1e-5f, 10 * _std_weight_velocity * h };
+
+		covariance.fill(0.f);
+		for (int i = 0; i < 4; i++) {
+			mean[i] = measurement[i];
+			mean[i + 4] = 0.f;
+		}
+		for (int i = 0; i < 8; i++) {
+			covariance[i * 8 + i] = std_dev[i] * std_dev[i];
+		}
+	}
+
+	// x = F x, P = F P F^T + Q, Q grows linearly with dt
+	void predict(Mean& mean, Covariance& covariance, float dt = 1.f) const {
+		float std_pos = _std_weight_position * mean[3] * _std_weight_position * mean[3];
+		float std_vel = _std_weight_velocity * mean[3] * _std_weight_velocity * mean[3];
+		const float q[8] = { std_pos, std_pos, 1e-4f, std_pos, std_vel, std_vel, 1e-10f, std_vel };
+
+		for (int i = 0; i < 4; i++) {
+			mean[i] += dt * mean[i + 4];
+		}
+
+		float* p = covariance.data();
+		// F P: position rows gain dt times the velocity rows
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 8; j++) {
+				p[i * 8 + j] += dt * p[(i + 4) * 8 + j];
+			}
+		}
+		// (F P) F^T: position columns gain dt times the velocity columns
+		for (int i = 0; i < 8; i++) {
+			for (int j = 0; j < 4; j++) {
+				p[i * 8 + j] += dt * p[i * 8 + j + 4];
+			}
+		}
+		for (int i = 0; i < 8; i++) {
+			p[i * 8 + i] += q[i] * dt;
+		}
+	}
+
+	// Same prediction for every slot flagged with mark_predict(), in one pass over
+	// the structure of arrays: each formula is a loop over slots on contiguous
+	// component rows, unflagged slots keep their value. Clears the flags.
+	void predict(KalmanStates& states, float dt = 1.f) const {
+		const int capacity = states.m_capacity;
+		const int n = states.m_predict_end;
+		const float* on = states.m_predict.data();
+		float* x[KalmanStates::kComponents];
+		for (int e = 0; e < KalmanStates::kComponents; e++) {
+			x[e] = states.m_data.data() + e * capacity;
+		}
+		float** p = x + KalmanStates::kMeanSize;
+
+		// P = [A B; B^T D] becomes [A + dt (B + B^T) + dt^2 D, B + dt D; ., D], A
+		// first as it reads the old B
+		const float dt2 = dt * dt;
+		for (int i = 0; i < 4; i++) {
+			for (int j = i; j < 4; j++) {
+				accumulate(p[KalmanStates::packed(i, j)], p[KalmanStates::packed(j, i + 4)],
+					p[KalmanStates::packed(i, j + 4)], p[KalmanStates::packed(i + 4, j + 4)], dt, dt2, on, n);
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			for (int j = 4; j < 8; j++) {
+				accumulate(p[KalmanStates::packed(i, j)], p[KalmanStates::packed(i + 4, j)], dt, on, n);
+			}
+		}
+
+		// Q is scaled by the height before it moves
+		const float weights[8] = {
+			_std_weight_position, _std_weight_position, 0.f, _std_weight_position,
+			_std_weight_velocity, _std_weight_velocity, 0.f, _std_weight_velocity };
+		const float floors[8] = { 0.f, 0.f, 1e-4f, 0.f, 0.f, 0.f, 1e-10f, 0.f };
+		for (int i = 0; i < 8; i++) {
+			float* d = p[KalmanStates::packed(i, i)];
+			const float* h = x[3];
+			const float w = weights[i];
+			const float q_floor = floors[i];
+			for (int l = 0; l < n; l++) {
+				d[l] += on[l] * ((w * h[l] * w * h[l] + q_floor) * dt);
+			}
+		}
+
+		for (int i = 0; i < 4; i++) {
+			accumulate(x[i], x[i + 4], dt, on, n);
+		}
+		std::fill(states.m_predict.begin(), states.m_predict.begin() + n, 0.f);
+		states.m_predict_end = 0;
+	}
+
+	// K = P H^T (H P H^T + R)^-1, x += K (z - H x), P -= K H P
+	void update(Mean& mean, Covariance& covariance, const Measurement& measurement) const {
+		float std_pos = _std_weight_position * mean[3] * _std_weight_position * mean[3];
+		const float r[4] = { std_pos, std_pos, 1e-2f, std_pos };
+
+		// H P is the first four rows of P, the innovation covariance its top-left block
+		const float* p = covariance.data();
+		double s[16];
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				s[i * 4 + j] = p[i * 8 + j];
+			}
+			s[i * 4 + i] += r[i];
+		}
+		double l[16];
+		cholesky4(s, l);
+
+		// K^T = S^-1 H P, one 4x4 Cholesky solve per state column
+		double kt[4 * 8];
+		for (int c = 0; c < 8; c++) {
+			double b[4] = { p[0 * 8 + c], p[1 * 8 + c], p[2 * 8 + c], p[3 * 8 + c] };
+			solve4(l, b);
+			for (int i = 0; i < 4; i++) {
+				kt[i * 8 + c] = b[i];
+			}
+		}
+
+		double innovation[4];
+		for (int i = 0; i < 4; i++) {
+			innovation[i] = measurement[i] - mean[i];
+		}
+
+		double hp[4 * 8];
+		for (int i = 0; i < 32; i++) {
+			hp[i] = p[(i / 8) * 8 + i % 8];
+		}
+
+		for (int row = 0; row < 8; row++) {
+			double dx = 0;
+			for (int k = 0; k < 4; k++) {
+				dx += kt[k * 8 + row] * innovation[k];
+			}
+			mean[row] = static_cast<float>(mean[row] + dx);
+
+			for (int c = 0; c < 8; c++) {
+				double khp = 0;
+				for (int k = 0; k < 4; k++) {
+					khp += kt[k * 8 + row] * hp[k * 8 + c];
+				}
+				covariance[row * 8 + c] = static_cast<float>(covariance[row * 8 + c] - khp);
+			}
+		}
+	}
+
+	// Squared Mahalanobis distance between the projected state and every measurement
+	void gating_distance(const Mean& mean, const Covariance& covariance,
+		const std::vector<Measurement>& measurements, std::vector<float>& distances) const {
+		const float std_dev[4] = { _std_weight_position * mean[3], _std_weight_position * mean[3], 1e-1f, _std_weight_position * mean[3] };
+
+		double s[16];
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				s[i * 4 + j] = covariance[i * 8 + j];
+			}
+			s[i * 4 + i] += std_dev[i] * std_dev[i];
+		}
+		double l[16];
+		cholesky4(s, l);
+
+		distances.resize(measurements.size());
+		for (size_t m = 0; m < measurements.size(); m++) {
+			// forward substitution only, |L^-1 d|^2
+			double z[4];
+			double dist = 0;
+			for (int i = 0; i < 4; i++) {
+				double v = measurements[m][i] - mean[i];
+				for (int k = 0; k < i; k++) {
+					v -= l[i * 4 + k] * z[k];
+				}
+				z[i] = v / l[i * 4 + i];
+				dist += z[i] * z[i];
+			}
+			distances[m] = static_cast<float>(dist);
+		}
+	}
 
 private:
-	std::unique_ptr<cv::KalmanFilter> opencv_kf;
+	// out += s b on flagged slots, on is 1 or 0 so that the loop has no branch
+	static void accumulate(float* out, const float* b, float s, const float* on, int n) {
+		for (int l = 0; l < n; l++) {
+			out[l] += on[l] * (s * b[l]);
+		}
+	}
+
+	// out = (out + s b) + (s c + s2 d) on flagged slots
+	static void accumulate(float* out, const float* b, const float* c, const float* d,
+		float s, float s2, const float* on, int n) {
+		for (int l = 0; l < n; l++) {
+			out[l] = (out[l] + on[l] * (s * b[l])) + on[l] * (s * c[l] + s2 * d[l]);
+		}
+	}
+
+	// s = l l^T with l lower triangular
+	static void cholesky4(const double* s, double* l) {
+		for (int i = 0; i < 16; i++) {
+			l[i] = 0;
+		}
+		for (int j = 0; j < 4; j++) {
+			double d = s[j * 4 + j];
+			for (int k = 0; k < j; k++) {
+				d -= l[j * 4 + k] * l[j * 4 + k];
+			}
+			l[j * 4 + j] = std::sqrt(d);
+			for (int i = j + 1; i < 4; i++) {
+				double v = s[i * 4 + j];
+				for (int k = 0; k < j; k++) {
+					v -= l[i * 4 + k] * l[j * 4 + k];
+				}
+				l[i * 4 + j] = v / l[j * 4 + j];
+			}
+		}
+	}
+
+	// solve l l^T x = b in place
+	static void solve4(const double* l, double* b) {
+		for (int i = 0; i < 4; i++) {
+			for (int k = 0; k < i; k++) {
+				b[i] -= l[i * 4 + k] * b[k];
+			}
+			b[i] /= l[i * 4 + i];
+		}
+		for (int i = 3; i >= 0; i--) {
+			for (int k = i + 1; k < 4; k++) {
+				b[i] -= l[k * 4 + i] * b[k];
+			}
+			b[i] /= l[i * 4 + i];
+		}
+	}
+
 	float _std_weight_position;
 	float _std_weight_velocity;
+	KalmanStates _states;
 };
 
 #endif  // KALMANFILTER_H
@@ -9,72 +9,50 @@
 #ifndef LAPJV_H
 #define LAPJV_H
 
-#define LARGE 1000000
+#include <vector>
 
-#if !defined TRUE
-#define TRUE 1
-#endif
-#if !defined FALSE
-#define FALSE 0
-#endif
+/*
+ * Rectangular linear assignment with a cost limit, solved by Jonker-Volgenant
+ * shortest augmenting paths.
+ * Leaving a row or a column unmatched costs cost_limit / 2, so a pair is only
+ * worth matching when its cost is below cost_limit; pairs at or above the limit
+ * are never matched. This is the problem the tracker used to solve by padding
+ * the cost to a square (rows + cols) matrix. Here every row has an implicit
+ * private "unmatched" column instead and nothing is padded.
+ * All buffers belong to the solver and are reused across calls.
+ */
+class LapSolver {
+public:
+	// cost is row major n_rows x n_cols. rowsol[i] receives the column matched to
+	// row i and colsol[j] the row matched to column j, -1 when unmatched.
+	// Returns 0 on success, -1 on invalid arguments.
+	int solve(const float* cost, int n_rows, int n_cols, float cost_limit,
+		int* rowsol, int* colsol);
 
-#define NEW(x, t, n)                            \
-  if ((x = (t*)malloc(sizeof(t) * (n))) == 0) { \
-    return -1;                                  \
-  }
-#define FREE(x) \
-  if (x != 0) { \
-    free(x);    \
-    x = 0;      \
-  }
-#define SWAP_INDICES(a, b) \
-  {                        \
-    int_t _temp_index = a; \
-    a = b;                 \
-    b = _temp_index;       \
-  }
+	// Same problem with only some pairs stored, in CSR form: the pairs of row i
+	// are cols[k], costs[k] for k in [row_ptr[i], row_ptr[i + 1]). Pairs that
+	// are not stored are never matched.
+	int solve_sparse(const int* row_ptr, const int* cols, const float* costs,
+		int n_rows, int n_cols, float cost_limit, int* rowsol, int* colsol);
 
-#if 0
-#include <assert.h>
-#define ASSERT(cond) assert(cond)
-#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
-#define PRINT_COST_ARRAY(a, n)         \
-  while (1) {                          \
-    printf(#a " = [");                 \
-    if ((n) > 0) {                     \
-      printf("%f", (a)[0]);            \
-      for (uint_t j = 1; j < n; j++) { \
-        printf(", %f", (a)[j]);        \
-      }                                \
-    }                                  \
-    printf("]\n");                     \
-    break;                             \
-  }
-#define PRINT_INDEX_ARRAY(a, n)        \
-  while (1) {                          \
-    printf(#a " = [");                 \
-    if ((n) > 0) {                     \
-      printf("%d", (a)[0]);            \
-      for (uint_t j = 1; j < n; j++) { \
-        printf(", %d", (a)[j]);        \
-      }                                \
-    }                                  \
-    printf("]\n");                     \
-    break;                             \
-  }
-#else
-#define ASSERT(cond)
-#define PRINTF(fmt, ...)
-#define PRINT_COST_ARRAY(a, n)
-#define PRINT_INDEX_ARRAY(a, n)
-#endif
+private:
+	void reset(int n_rows, int n_cols);
+	int augment(const float* cost, int n_cols, float cost_limit, int cur_row);
+	int augment_sparse(const int* row_ptr, const int* cols, const float* costs,
+		int n_cols, float cost_limit, int cur_row);
+	void finish(int n_cols, int cur_row, double min_val, int sink);
+	void write_solution(int n_rows, int n_cols, int* rowsol, int* colsol) const;
 
-typedef signed int int_t;
-typedef unsigned int uint_t;
-typedef double cost_t;
-typedef char boolean;
-typedef enum fp_t { FP_1 = 1, FP_2 = 2, FP_DYNAMIC = 3 } fp_t;
+	std::vector<double> u;           // row duals
+	std::vector<double> v;           // column duals, private columns after the real ones
+	std::vector<double> path_cost;   // shortest path cost to each column
+	std::vector<int> path;           // row preceding each column on the path
+	std::vector<int> col4row;        // n_cols + i when row i is unmatched
+	std::vector<int> row4col;
+	std::vector<int> remaining;      // real columns not yet scanned, sparse: reached ones only
+	std::vector<char> col_scanned;   // sparse search only
+	std::vector<int> scanned_rows;
+	std::vector<int> scanned_cols;
+};
 
-extern int_t lapjv_internal(const uint_t n, cost_t* cost[], int_t* x, int_t* y);
-
-#endif  // LAPJV_H
\ No newline at end of file
+#endif  // LAPJV_H
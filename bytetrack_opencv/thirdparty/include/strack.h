@@ -10,52 +10,116 @@
 #ifndef STRACK_H
 #define STRACK_H
 
+#include <array>
+#include <memory>
+#include <vector>
 #include "kalmanfilter.h"
 
 enum TrackState { New = 0, Tracked, Lost, Removed };
 
+class STrackPool;
+
 class STrack {
 public:
-	STrack(std::vector<float> tlwh_, float score, int class_id);
+	using Box = std::array<float, 4>;
+
+	STrack();
 	~STrack();
+	STrack(const STrack&) = delete;
+	STrack& operator=(const STrack&) = delete;
+
+	// start over as a new detection captured at timestamp (seconds), the object is
+	// reused by STrackPool
+	void init(const Box& tlwh_, float score, int class_id, double timestamp);
 
-	std::vector<float> static tlbr_to_tlwh(std::vector<float>& tlbr);
-	void static multi_predict(std::vector<std::shared_ptr<STrack>>& stracks,
-		std::shared_ptr<KalmanFilter> kalman_filter);
+	static Box tlbr_to_tlwh(const Box& tlbr);
+	// dt in nominal frame periods since the previous prediction
+	static void multi_predict(STrackPool& pool, const std::vector<int>& handles,
+		KalmanFilter& kalman_filter, float dt);
 	void static_tlwh();
 	void static_tlbr();
-	std::vector<float> tlwh_to_xyah(std::vector<float> tlwh_tmp);
-	std::vector<float> to_xyah();
+	static KalmanFilter::Measurement tlwh_to_xyah(const Box& tlwh_tmp);
+	KalmanFilter::Measurement to_xyah() const;
 	void mark_lost();
 	void mark_removed();
-	int next_id();
 	int end_frame();
 
-	void activate(std::shared_ptr<KalmanFilter> kalman_filter, int frame_id);
-	void re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
-		std::shared_ptr<STrack> new_track, int frame_id,
-		bool new_id = false);
-	void update(std::shared_ptr<KalmanFilter> kalman_filter,
-		std::shared_ptr<STrack> new_track, int frame_id);
+	// track ids are issued by the owning tracker
+	void activate(KalmanFilter& kalman_filter, int frame_id, int track_id);
+	// new_id > 0 replaces the track id
+	void re_activate(KalmanFilter& kalman_filter, const STrack& new_track,
+		int frame_id, int new_id = 0);
+	void update(KalmanFilter& kalman_filter, const STrack& new_track, int frame_id);
+	// copy of the Kalman state, false if the track was never activated
+	bool get_kalman_state(KalmanFilter::Mean& mean, KalmanFilter::Covariance& covariance) const;
+	void release_state();
 
 public:
 	bool is_activated;
 	int track_id;
 	int state;
 
-	std::vector<float> _tlwh;
-	std::vector<float> tlwh;
-	std::vector<float> tlbr;
+	Box _tlwh;
+	Box tlwh;
+	Box tlbr;
 	int frame_id;
 	int tracklet_len;
 	int start_frame;
+	double timestamp;  // capture time of the last detection, seconds
 
-	cv::Mat mean;
-	cv::Mat covariance;
 	float score;
 	int class_id;
+
+private:
+	// the Kalman state lives in slot state_slot of the filter's KalmanStates,
+	// acquired on activation and released on removal
+	KalmanFilter* owner_filter;
+	int state_slot;
+};
+
+/*
+ * Slab of STracks addressed by integer handles. Tracks are allocated in fixed
+ * size chunks, so handles and pointers stay valid while the pool grows, and
+ * released handles are handed out again before the pool grows.
+ */
+class STrackPool {
+public:
+	int acquire() {
+		if (free_handles.empty()) {
+			int base = (int)chunks.size() * kChunkSize;
+			chunks.emplace_back(new STrack[kChunkSize]);
+			allocated.resize(base + kChunkSize, 0);
+			for (int h = base + kChunkSize - 1; h >= base; h--) {
+				free_handles.push_back(h);
+			}
+		}
+		int h = free_handles.back();
+		free_handles.pop_back();
+		allocated[h] = 1;
+		return h;
+	}
+
+	void release(int h) {
+		(*this)[h].release_state();
+		allocated[h] = 0;
+		free_handles.push_back(h);
+	}
+
+	STrack& operator[](int h) { return chunks[h / kChunkSize][h % kChunkSize]; }
+	const STrack& operator[](int h) const { return chunks[h / kChunkSize][h % kChunkSize]; }
+
+	int capacity() const { return (int)allocated.size(); }
+	bool is_allocated(int h) const { return allocated[h] != 0; }
+
+private:
+	static const int kChunkSize = 64;
+
+	std::vector<std::unique_ptr<STrack[]>> chunks;
+	std::vector<char> allocated;
+	std::vector<int> free_handles;
 };
 
-using STracks = std::vector<std::shared_ptr<STrack>>;
+// output of BYTETracker::update, pointing into the tracker's pool
+using STracks = std::vector<const STrack*>;
 
-#endif  // STRACK_H
\ No newline at end of file
+#endif  // STRACK_H
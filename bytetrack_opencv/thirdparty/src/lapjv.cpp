@@ -8,324 +8,250 @@
 //===----------------------------------------------------------------------===//
 #include "lapjv.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
 
-/** Column-reduction and reduction transfer for a dense cost matrix.
+/*
+ * Rows are added one at a time. For each new row a Dijkstra search over reduced
+ * costs finds the cheapest alternating path to a free column, then the duals are
+ * updated and the path is flipped. A real pair (i, j) costs cost - cost_limit and
+ * the private column of row i costs 0, which gives the same optimum as charging
+ * cost_limit / 2 for every unmatched row and column. Private columns are always
+ * free and only reachable from their own row, so they are never stored in the
+ * cost matrix, only in the duals and in the path arrays.
  */
-int_t _ccrrt_dense(const uint_t n, cost_t* cost[], int_t* free_rows, int_t* x,
-	int_t* y, cost_t* v) {
-	int_t n_free_rows;
-	boolean* unique;
+int LapSolver::augment(const float* cost, int n_cols, float cost_limit, int cur_row) {
+	const double inf = std::numeric_limits<double>::infinity();
 
-	for (uint_t i = 0; i < n; i++) {
-		x[i] = -1;
-		v[i] = LARGE;
-		y[i] = 0;
+	for (int j = 0; j < n_cols; j++) {
+		remaining[j] = j;
+		path_cost[j] = inf;
 	}
-	for (uint_t i = 0; i < n; i++) {
-		for (uint_t j = 0; j < n; j++) {
-			const cost_t c = cost[i][j];
-			if (c < v[j]) {
-				v[j] = c;
-				y[j] = i;
-			}
-			PRINTF("i=%d, j=%d, c[i,j]=%f, v[j]=%f y[j]=%d\n", i, j, c, v[j], y[j]);
+	int n_remaining = n_cols;
+	scanned_rows.clear();
+	scanned_cols.clear();
+
+	double min_val = 0;
+	double best_private = inf;
+	int best_private_col = -1;
+	int i = cur_row;
+	int sink = -1;
+	while (sink == -1) {
+		scanned_rows.push_back(i);
+
+		int pc = n_cols + i;
+		path[pc] = i;
+		path_cost[pc] = min_val - u[i] - v[pc];
+		if (path_cost[pc] < best_private) {
+			best_private = path_cost[pc];
+			best_private_col = pc;
 		}
-	}
-	PRINT_COST_ARRAY(v, n);
-	PRINT_INDEX_ARRAY(y, n);
-	NEW(unique, boolean, n);
-	memset(unique, TRUE, n);
-	{
-		int_t j = n;
-		do {
-			j--;
-			const int_t i = y[j];
-			if (x[i] < 0) {
-				x[i] = j;
+
+		const float* row = cost + (std::size_t)i * n_cols;
+		double lowest = inf;
+		int index_lowest = -1;
+		for (int k = 0; k < n_remaining; k++) {
+			int j = remaining[k];
+			if (row[j] < cost_limit) {
+				double r = min_val + ((double)row[j] - cost_limit) - u[i] - v[j];
+				if (r < path_cost[j]) {
+					path[j] = i;
+					path_cost[j] = r;
+				}
 			}
-			else {
-				unique[i] = FALSE;
-				y[j] = -1;
+			if (path_cost[j] < lowest || (path_cost[j] == lowest && row4col[j] == -1)) {
+				lowest = path_cost[j];
+				index_lowest = k;
 			}
-		} while (j > 0);
-	}
-	n_free_rows = 0;
-	for (uint_t i = 0; i < n; i++) {
-		if (x[i] < 0) {
-			free_rows[n_free_rows++] = i;
 		}
-		else if (unique[i]) {
-			const int_t j = x[i];
-			cost_t min = LARGE;
-			for (uint_t j2 = 0; j2 < n; j2++) {
-				if (j2 == (uint_t)j) {
-					continue;
-				}
-				const cost_t c = cost[i][j2] - v[j2];
-				if (c < min) {
-					min = c;
-				}
-			}
-			PRINTF("v[%d] = %f - %f\n", j, v[j], min);
-			v[j] -= min;
+
+		if (best_private <= lowest) {
+			min_val = best_private;
+			sink = best_private_col;
+			scanned_cols.push_back(sink);
+			break;
+		}
+
+		min_val = lowest;
+		int j = remaining[index_lowest];
+		scanned_cols.push_back(j);
+		remaining[index_lowest] = remaining[--n_remaining];
+		if (row4col[j] == -1) {
+			sink = j;
+		}
+		else {
+			i = row4col[j];
 		}
 	}
-	FREE(unique);
-	return n_free_rows;
+	if (sink < 0) return -1;
+
+	finish(n_cols, cur_row, min_val, sink);
+	return 0;
 }
 
-/** Augmenting row reduction for a dense cost matrix.
- */
-int_t _carr_dense(const uint_t n, cost_t* cost[], const uint_t n_free_rows,
-	int_t* free_rows, int_t* x, int_t* y, cost_t* v) {
-	uint_t current = 0;
-	int_t new_free_rows = 0;
-	uint_t rr_cnt = 0;
-	PRINT_INDEX_ARRAY(x, n);
-	PRINT_INDEX_ARRAY(y, n);
-	PRINT_COST_ARRAY(v, n);
-	PRINT_INDEX_ARRAY(free_rows, n_free_rows);
-	while (current < n_free_rows) {
-		int_t i0;
-		int_t j1, j2;
-		cost_t v1, v2, v1_new;
-		boolean v1_lowers;
+// Same search on a CSR cost, visiting only the stored pairs of the scanned rows.
+// path_cost of real columns stays infinite between calls, so only the columns
+// reached by this search are tracked and reset, which keeps the work proportional
+// to the neighbourhood of cur_row instead of the number of columns.
+int LapSolver::augment_sparse(const int* row_ptr, const int* cols, const float* costs,
+	int n_cols, float cost_limit, int cur_row) {
+	const double inf = std::numeric_limits<double>::infinity();
 
-		rr_cnt++;
-		PRINTF("current = %d rr_cnt = %d\n", current, rr_cnt);
-		const int_t free_i = free_rows[current++];
-		j1 = 0;
-		v1 = cost[free_i][0] - v[0];
-		j2 = -1;
-		v2 = LARGE;
-		for (uint_t j = 1; j < n; j++) {
-			PRINTF("%d = %f %d = %f\n", j1, v1, j2, v2);
-			const cost_t c = cost[free_i][j] - v[j];
-			if (c < v2) {
-				if (c >= v1) {
-					v2 = c;
-					j2 = j;
-				}
-				else {
-					v2 = v1;
-					v1 = c;
-					j2 = j1;
-					j1 = j;
-				}
-			}
-		}
-		i0 = y[j1];
-		v1_new = v[j1] - (v2 - v1);
-		v1_lowers = v1_new < v[j1];
-		PRINTF("%d %d 1=%d,%f 2=%d,%f v1'=%f(%d,%g) \n", free_i, i0, j1, v1, j2, v2,
-			v1_new, v1_lowers, v[j1] - v1_new);
-		if (rr_cnt < current * n) {
-			if (v1_lowers) {
-				v[j1] = v1_new;
-			}
-			else if (i0 >= 0 && j2 >= 0) {
-				j1 = j2;
-				i0 = y[j2];
-			}
-			if (i0 >= 0) {
-				if (v1_lowers) {
-					free_rows[--current] = i0;
-				}
-				else {
-					free_rows[new_free_rows++] = i0;
-				}
-			}
+	remaining.clear();
+	scanned_rows.clear();
+	scanned_cols.clear();
+
+	double min_val = 0;
+	double best_private = inf;
+	int best_private_col = -1;
+	int i = cur_row;
+	int sink = -1;
+	while (sink == -1) {
+		scanned_rows.push_back(i);
+
+		int pc = n_cols + i;
+		path[pc] = i;
+		path_cost[pc] = min_val - u[i] - v[pc];
+		if (path_cost[pc] < best_private) {
+			best_private = path_cost[pc];
+			best_private_col = pc;
 		}
-		else {
-			PRINTF("rr_cnt=%d >= %d (current=%d * n=%d)\n", rr_cnt, current * n,
-				current, n);
-			if (i0 >= 0) {
-				free_rows[new_free_rows++] = i0;
+
+		for (int e = row_ptr[i]; e < row_ptr[i + 1]; e++) {
+			int j = cols[e];
+			if (col_scanned[j] || !(costs[e] < cost_limit)) continue;
+			double r = min_val + ((double)costs[e] - cost_limit) - u[i] - v[j];
+			if (r < path_cost[j]) {
+				if (path_cost[j] == inf) remaining.push_back(j);
+				path[j] = i;
+				path_cost[j] = r;
 			}
 		}
-		x[free_i] = j1;
-		y[j1] = free_i;
-	}
-	return new_free_rows;
-}
 
-/** Find columns with minimum d[j] and put them on the SCAN list.
- */
-uint_t _find_dense(const uint_t n, uint_t lo, cost_t* d, int_t* cols,
-	int_t* y) {
-	uint_t hi = lo + 1;
-	cost_t mind = d[cols[lo]];
-	for (uint_t k = hi; k < n; k++) {
-		int_t j = cols[k];
-		if (d[j] <= mind) {
-			if (d[j] < mind) {
-				hi = lo;
-				mind = d[j];
+		double lowest = inf;
+		int index_lowest = -1;
+		for (int k = 0; k < (int)remaining.size(); k++) {
+			int j = remaining[k];
+			if (path_cost[j] < lowest || (path_cost[j] == lowest && row4col[j] == -1)) {
+				lowest = path_cost[j];
+				index_lowest = k;
 			}
-			cols[k] = cols[hi];
-			cols[hi++] = j;
 		}
-	}
-	return hi;
-}
 
-// Scan all columns in TODO starting from arbitrary column in SCAN
-// and try to decrease d of the TODO columns using the SCAN column.
-int_t _scan_dense(const uint_t n, cost_t* cost[], uint_t* plo, uint_t* phi,
-	cost_t* d, int_t* cols, int_t* pred, int_t* y, cost_t* v) {
-	uint_t lo = *plo;
-	uint_t hi = *phi;
-	cost_t h, cred_ij;
+		if (best_private <= lowest) {
+			min_val = best_private;
+			sink = best_private_col;
+			scanned_cols.push_back(sink);
+			break;
+		}
 
-	while (lo != hi) {
-		int_t j = cols[lo++];
-		const int_t i = y[j];
-		const cost_t mind = d[j];
-		h = cost[i][j] - v[j] - mind;
-		PRINTF("i=%d j=%d h=%f\n", i, j, h);
-		// For all columns in TODO
-		for (uint_t k = hi; k < n; k++) {
-			j = cols[k];
-			cred_ij = cost[i][j] - v[j] - h;
-			if (cred_ij < d[j]) {
-				d[j] = cred_ij;
-				pred[j] = i;
-				if (cred_ij == mind) {
-					if (y[j] < 0) {
-						return j;
-					}
-					cols[k] = cols[hi];
-					cols[hi++] = j;
-				}
-			}
+		min_val = lowest;
+		int j = remaining[index_lowest];
+		scanned_cols.push_back(j);
+		col_scanned[j] = 1;
+		remaining[index_lowest] = remaining.back();
+		remaining.pop_back();
+		if (row4col[j] == -1) {
+			sink = j;
+		}
+		else {
+			i = row4col[j];
 		}
 	}
-	*plo = lo;
-	*phi = hi;
-	return -1;
-}
-
-/** Single iteration of modified Dijkstra shortest path algorithm as explained
- * in the JV paper.
- *
- * This is a dense matrix version.
- *
- * \return The closest free column index.
- */
-int_t find_path_dense(const uint_t n, cost_t* cost[], const int_t start_i,
-	int_t* y, cost_t* v, int_t* pred) {
-	uint_t lo = 0, hi = 0;
-	int_t final_j = -1;
-	uint_t n_ready = 0;
-	int_t* cols;
-	cost_t* d;
+	if (sink < 0) return -1;
 
-	NEW(cols, int_t, n);
-	NEW(d, cost_t, n);
+	finish(n_cols, cur_row, min_val, sink);
 
-	for (uint_t i = 0; i < n; i++) {
-		cols[i] = i;
-		pred[i] = start_i;
-		d[i] = cost[start_i][i] - v[i];
+	for (std::size_t k = 0; k < remaining.size(); k++) {
+		path_cost[remaining[k]] = inf;
 	}
-	PRINT_COST_ARRAY(d, n);
-	while (final_j == -1) {
-		// No columns left on the SCAN list.
-		if (lo == hi) {
-			PRINTF("%d..%d -> find\n", lo, hi);
-			n_ready = lo;
-			hi = _find_dense(n, lo, d, cols, y);
-			PRINTF("check %d..%d\n", lo, hi);
-			PRINT_INDEX_ARRAY(cols, n);
-			for (uint_t k = lo; k < hi; k++) {
-				const int_t j = cols[k];
-				if (y[j] < 0) {
-					final_j = j;
-				}
-			}
-		}
-		if (final_j == -1) {
-			PRINTF("%d..%d -> scan\n", lo, hi);
-			final_j = _scan_dense(n, cost, &lo, &hi, d, cols, pred, y, v);
-			PRINT_COST_ARRAY(d, n);
-			PRINT_INDEX_ARRAY(cols, n);
-			PRINT_INDEX_ARRAY(pred, n);
+	for (std::size_t k = 0; k < scanned_cols.size(); k++) {
+		int j = scanned_cols[k];
+		if (j < n_cols) {
+			path_cost[j] = inf;
+			col_scanned[j] = 0;
 		}
 	}
+	return 0;
+}
 
-	PRINTF("found final_j=%d\n", final_j);
-	PRINT_INDEX_ARRAY(cols, n);
-	{
-		const cost_t mind = d[cols[lo]];
-		for (uint_t k = 0; k < n_ready; k++) {
-			const int_t j = cols[k];
-			v[j] += d[j] - mind;
+// dual update and path flip once the search reached sink
+void LapSolver::finish(int n_cols, int cur_row, double min_val, int sink) {
+	u[cur_row] += min_val;
+	for (std::size_t k = 0; k < scanned_rows.size(); k++) {
+		int r = scanned_rows[k];
+		if (r != cur_row) {
+			u[r] += min_val - path_cost[col4row[r]];
 		}
 	}
+	for (std::size_t k = 0; k < scanned_cols.size(); k++) {
+		int j = scanned_cols[k];
+		v[j] -= min_val - path_cost[j];
+	}
 
-	FREE(cols);
-	FREE(d);
-
-	return final_j;
+	int j = sink;
+	while (true) {
+		int r = path[j];
+		if (j < n_cols) row4col[j] = r;
+		std::swap(col4row[r], j);
+		if (r == cur_row) break;
+	}
 }
 
-/** Augment for a dense cost matrix.
- */
-int_t _ca_dense(const uint_t n, cost_t* cost[], const uint_t n_free_rows,
-	int_t* free_rows, int_t* x, int_t* y, cost_t* v) {
-	int_t* pred;
+void LapSolver::reset(int n_rows, int n_cols) {
+	int total = n_cols + n_rows;
+	u.assign(n_rows, 0.0);
+	v.assign(total, 0.0);
+	path_cost.resize(total);
+	path.resize(total);
+	col4row.assign(n_rows, -1);
+	row4col.assign(n_cols, -1);
+}
 
-	NEW(pred, int_t, n);
+void LapSolver::write_solution(int n_rows, int n_cols, int* rowsol, int* colsol) const {
+	for (int i = 0; i < n_rows; i++) {
+		rowsol[i] = col4row[i] < n_cols ? col4row[i] : -1;
+	}
+	for (int j = 0; j < n_cols; j++) {
+		colsol[j] = row4col[j];
+	}
+}
 
-	for (int_t* pfree_i = free_rows; pfree_i < free_rows + n_free_rows;
-		pfree_i++) {
-		int_t i = -1, j;
-		uint_t k = 0;
+int LapSolver::solve(const float* cost, int n_rows, int n_cols, float cost_limit,
+	int* rowsol, int* colsol) {
+	if (n_rows < 0 || n_cols < 0 || cost_limit != cost_limit) return -1;
+	if ((n_rows > 0 && !rowsol) || (n_cols > 0 && !colsol)) return -1;
+	if (n_rows > 0 && n_cols > 0 && !cost) return -1;
 
-		PRINTF("looking at free_i=%d\n", *pfree_i);
-		j = find_path_dense(n, cost, *pfree_i, y, v, pred);
-		ASSERT(j >= 0);
-		ASSERT(j < n);
-		while (i != *pfree_i) {
-			PRINTF("augment %d\n", j);
-			PRINT_INDEX_ARRAY(pred, n);
-			i = pred[j];
-			PRINTF("y[%d]=%d -> %d\n", j, y[j], i);
-			y[j] = i;
-			PRINT_INDEX_ARRAY(x, n);
-			SWAP_INDICES(j, x[i]);
-			k++;
-			if (k >= n) {
-				ASSERT(FALSE);
-			}
-		}
+	reset(n_rows, n_cols);
+	remaining.resize(n_cols);
+	for (int i = 0; i < n_rows; i++) {
+		if (augment(cost, n_cols, cost_limit, i) != 0) return -1;
 	}
-	FREE(pred);
+	write_solution(n_rows, n_cols, rowsol, colsol);
 	return 0;
 }
 
-/** Solve dense sparse LAP.
- */
-int lapjv_internal(const uint_t n, cost_t* cost[], int_t* x, int_t* y) {
-	int ret;
-	int_t* free_rows;
-	cost_t* v;
-
-	NEW(free_rows, int_t, n);
-	NEW(v, cost_t, n);
-	ret = _ccrrt_dense(n, cost, free_rows, x, y, v);
-	int i = 0;
-	while (ret > 0 && i < 2) {
-		ret = _carr_dense(n, cost, ret, free_rows, x, y, v);
-		i++;
+int LapSolver::solve_sparse(const int* row_ptr, const int* cols, const float* costs,
+	int n_rows, int n_cols, float cost_limit, int* rowsol, int* colsol) {
+	if (n_rows < 0 || n_cols < 0 || cost_limit != cost_limit) return -1;
+	if ((n_rows > 0 && !rowsol) || (n_cols > 0 && !colsol)) return -1;
+	if (n_rows > 0 && !row_ptr) return -1;
+	for (int i = 0; i < n_rows; i++) {
+		if (row_ptr[i + 1] < row_ptr[i]) return -1;
 	}
-	if (ret > 0) {
-		ret = _ca_dense(n, cost, ret, free_rows, x, y, v);
+	for (int e = 0; n_rows > 0 && e < row_ptr[n_rows]; e++) {
+		if (cols[e] < 0 || cols[e] >= n_cols) return -1;
 	}
-	FREE(v);
-	FREE(free_rows);
-	return ret;
-}
\ No newline at end of file
+
+	reset(n_rows, n_cols);
+	std::fill(path_cost.begin(), path_cost.begin() + n_cols, std::numeric_limits<double>::infinity());
+	col_scanned.assign(n_cols, 0);
+	for (int i = 0; i < n_rows; i++) {
+		if (augment_sparse(row_ptr, cols, costs, n_cols, cost_limit, i) != 0) return -1;
+	}
+	write_solution(n_rows, n_cols, rowsol, colsol);
+	return 0;
+}
@@ -8,8 +8,14 @@
 //===----------------------------------------------------------------------===//
 #include "strack.h"
 
-STrack::STrack(std::vector<float> tlwh_, float score, int class_id) {
+STrack::STrack() : owner_filter(nullptr), state_slot(-1) {
+	init(Box{ { 0, 0, 0, 0 } }, 0.f, 0, 0.0);
+}
+
+void STrack::init(const Box& tlwh_, float score, int class_id, double timestamp) {
+	release_state();
 	this->frame_id = 0;
+	this->timestamp = timestamp;
 	this->tracklet_len = 0;
 	this->score = score;
 	this->class_id = class_id;
@@ -18,34 +24,32 @@ STrack::STrack(std::vector<float> tlwh_, float score, int class_id) {
 	this->track_id = 0;
 	this->state = TrackState::New;
 
-	_tlwh.resize(4);
-	_tlwh.assign(tlwh_.begin(), tlwh_.end());
-	tlwh.resize(4);
-	tlbr.resize(4);
+	_tlwh = tlwh_;
 	static_tlwh();
 	static_tlbr();
 }
 
-STrack::~STrack() {}
+STrack::~STrack() { release_state(); }
 
-void STrack::activate(std::shared_ptr<KalmanFilter> kalman_filter,
-	int frame_id) {
-	this->track_id = this->next_id();
-
-	std::vector<float> _tlwh_tmp(4);
-	_tlwh_tmp[0] = this->_tlwh[0];
-	_tlwh_tmp[1] = this->_tlwh[1];
-	_tlwh_tmp[2] = this->_tlwh[2];
-	_tlwh_tmp[3] = this->_tlwh[3];
-	std::vector<float> xyah = tlwh_to_xyah(_tlwh_tmp);
-	cv::Mat xyah_box(1, 4, CV_32F);
-	xyah_box.at<float>(0) = xyah[0];
-	xyah_box.at<float>(1) = xyah[1];
-	xyah_box.at<float>(2) = xyah[2];
-	xyah_box.at<float>(3) = xyah[3];
-	auto mc = kalman_filter->initiate(xyah_box);
-	this->mean = mc.first.clone();
-	this->covariance = mc.second.clone();
+void STrack::release_state() {
+	if (state_slot >= 0) {
+		owner_filter->states().release(state_slot);
+		state_slot = -1;
+	}
+	owner_filter = nullptr;
+}
+
+void STrack::activate(KalmanFilter& kalman_filter, int frame_id, int track_id) {
+	this->track_id = track_id;
+
+	KalmanFilter::Measurement xyah_box = tlwh_to_xyah(this->_tlwh);
+	KalmanFilter::Mean mean;
+	KalmanFilter::Covariance covariance;
+	kalman_filter.initiate(xyah_box, mean, covariance);
+	release_state();
+	this->owner_filter = &kalman_filter;
+	this->state_slot = kalman_filter.states().acquire();
+	kalman_filter.states().store(this->state_slot, mean, covariance);
 
 	static_tlwh();
 	static_tlbr();
@@ -60,18 +64,14 @@ void STrack::activate(std::shared_ptr<KalmanFilter> kalman_filter,
 	this->start_frame = frame_id;
 }
 
-void STrack::re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
-	std::shared_ptr<STrack> new_track, int frame_id,
-	bool new_id) {
-	std::vector<float> xyah = tlwh_to_xyah(new_track->tlwh);
-	cv::Mat xyah_box(1, 4, CV_32F);
-	xyah_box.at<float>(0) = xyah[0];
-	xyah_box.at<float>(1) = xyah[1];
-	xyah_box.at<float>(2) = xyah[2];
-	xyah_box.at<float>(3) = xyah[3];
-	auto mc = kalman_filter->update(this->mean, this->covariance, xyah_box);
-	this->mean = mc.first.clone();
-	this->covariance = mc.second.clone();
+void STrack::re_activate(KalmanFilter& kalman_filter, const STrack& new_track,
+	int frame_id, int new_id) {
+	KalmanFilter::Measurement xyah_box = tlwh_to_xyah(new_track.tlwh);
+	KalmanFilter::Mean mean;
+	KalmanFilter::Covariance covariance;
+	kalman_filter.states().load(this->state_slot, mean, covariance);
+	kalman_filter.update(mean, covariance, xyah_box);
+	kalman_filter.states().store(this->state_slot, mean, covariance);
 
 	static_tlwh();
 	static_tlbr();
@@ -80,32 +80,36 @@ void STrack::re_activate(std::shared_ptr<KalmanFilter> kalman_filter,
 	this->state = TrackState::Tracked;
 	this->is_activated = true;
 	this->frame_id = frame_id;
-	this->score = new_track->score;
-	if (new_id) this->track_id = next_id();
+	this->timestamp = new_track.timestamp;
+	this->score = new_track.score;
+	if (new_id > 0) this->track_id = new_id;
 }
 
-void STrack::update(std::shared_ptr<KalmanFilter> kalman_filter,
-	std::shared_ptr<STrack> new_track, int frame_id) {
+void STrack::update(KalmanFilter& kalman_filter, const STrack& new_track,
+	int frame_id) {
 	this->frame_id = frame_id;
+	this->timestamp = new_track.timestamp;
 	this->tracklet_len++;
 
-	std::vector<float> xyah = tlwh_to_xyah(new_track->tlwh);
-	cv::Mat xyah_box(1, 4, CV_32F);
-	xyah_box.at<float>(0) = xyah[0];
-	xyah_box.at<float>(1) = xyah[1];
-	xyah_box.at<float>(2) = xyah[2];
-	xyah_box.at<float>(3) = xyah[3];
-
-	auto mc = kalman_filter->update(this->mean, this->covariance, xyah_box);
-	this->mean = mc.first.clone();
-	this->covariance = mc.second.clone();
+	KalmanFilter::Measurement xyah_box = tlwh_to_xyah(new_track.tlwh);
+	KalmanFilter::Mean mean;
+	KalmanFilter::Covariance covariance;
+	kalman_filter.states().load(this->state_slot, mean, covariance);
+	kalman_filter.update(mean, covariance, xyah_box);
+	kalman_filter.states().store(this->state_slot, mean, covariance);
 
 	static_tlwh();
 	static_tlbr();
 
 	this->state = TrackState::Tracked;
 	this->is_activated = true;
-	this->score = new_track->score;
+	this->score = new_track.score;
+}
+
+bool STrack::get_kalman_state(KalmanFilter::Mean& mean, KalmanFilter::Covariance& covariance) const {
+	if (state_slot < 0) return false;
+	owner_filter->states().load(state_slot, mean, covariance);
+	return true;
 }
 
 void STrack::static_tlwh() {
@@ -117,10 +121,11 @@ void STrack::static_tlwh() {
 		return;
 	}
 
-	tlwh[0] = mean.at<float>(0);
-	tlwh[1] = mean.at<float>(1);
-	tlwh[2] = mean.at<float>(2);
-	tlwh[3] = mean.at<float>(3);
+	const KalmanStates& states = owner_filter->states();
+	tlwh[0] = states.at(0, state_slot);
+	tlwh[1] = states.at(1, state_slot);
+	tlwh[2] = states.at(2, state_slot);
+	tlwh[3] = states.at(3, state_slot);
 
 	tlwh[2] *= tlwh[3];
 	tlwh[0] -= tlwh[2] / 2;
@@ -128,48 +133,52 @@ void STrack::static_tlwh() {
 }
 
 void STrack::static_tlbr() {
-	tlbr.clear();
-	tlbr.assign(tlwh.begin(), tlwh.end());
+	tlbr = tlwh;
 	tlbr[2] += tlbr[0];
 	tlbr[3] += tlbr[1];
 }
 
-std::vector<float> STrack::tlwh_to_xyah(std::vector<float> tlwh_tmp) {
-	std::vector<float> tlwh_output = tlwh_tmp;
+KalmanFilter::Measurement STrack::tlwh_to_xyah(const Box& tlwh_tmp) {
+	KalmanFilter::Measurement tlwh_output = tlwh_tmp;
 	tlwh_output[0] += tlwh_output[2] / 2;
 	tlwh_output[1] += tlwh_output[3] / 2;
 	tlwh_output[2] /= tlwh_output[3];
 	return tlwh_output;
 }
 
-std::vector<float> STrack::to_xyah() { return tlwh_to_xyah(tlwh); }
+KalmanFilter::Measurement STrack::to_xyah() const { return tlwh_to_xyah(tlwh); }
 
-std::vector<float> STrack::tlbr_to_tlwh(std::vector<float>& tlbr) {
-	tlbr[2] -= tlbr[0];
-	tlbr[3] -= tlbr[1];
-	return tlbr;
+STrack::Box STrack::tlbr_to_tlwh(const Box& tlbr) {
+	Box tlwh_output = tlbr;
+	tlwh_output[2] -= tlwh_output[0];
+	tlwh_output[3] -= tlwh_output[1];
+	return tlwh_output;
 }
 
 void STrack::mark_lost() { state = TrackState::Lost; }
 
+// The Kalman slot is kept: a lost track removed in this frame is still on the
+// lost list in the next one. It is given back with the pool handle.
 void STrack::mark_removed() { state = TrackState::Removed; }
 
-int STrack::next_id() {
-	static int _count = 0;
-	_count++;
-	return _count;
-}
-
 int STrack::end_frame() { return this->frame_id; }
 
-void STrack::multi_predict(std::vector<std::shared_ptr<STrack>>& stracks,
-	std::shared_ptr<KalmanFilter> kalman_filter) {
-	for (int i = 0; i < stracks.size(); i++) {
-		if (stracks[i]->state != TrackState::Tracked) {
-			stracks[i]->mean.at<float>(7) = 0;
+void STrack::multi_predict(STrackPool& pool, const std::vector<int>& handles,
+	KalmanFilter& kalman_filter, float dt) {
+	KalmanStates& states = kalman_filter.states();
+	for (int i = 0; i < handles.size(); i++) {
+		const STrack& track = pool[handles[i]];
+		if (track.state != TrackState::Tracked) {
+			states.at(7, track.state_slot) = 0;
 		}
-		auto mc = kalman_filter->predict(stracks[i]->mean, stracks[i]->covariance);
-		stracks[i]->mean = mc.first.clone();
-		stracks[i]->covariance = mc.second.clone();
+		states.mark_predict(track.state_slot);
+	}
+	kalman_filter.predict(states, dt);
+
+	// associate on the predicted boxes
+	for (int i = 0; i < handles.size(); i++) {
+		STrack& track = pool[handles[i]];
+		track.static_tlwh();
+		track.static_tlbr();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#include "tracker_service.h"
+
+TrackerService::TrackerService(const bytetrack_params& params, int num_streams,
+	int num_threads, Callback on_tracks)
+	: on_tracks(on_tracks) {
+	for (int i = 0; i < num_streams; i++) {
+		this->streams.emplace_back(new Stream(params, i));
+	}
+	// created last and destroyed first, so queued drains run while streams exist
+	this->pool.reset(new WorkStealingPool(num_threads));
+}
+
+TrackerService::~TrackerService() { this->pool.reset(); }
+
+int TrackerService::submit(int stream_id, const std::vector<YoloV5Box>& objects,
+	double timestamp) {
+	if (stream_id < 0 || stream_id >= this->streams.size()) return -1;
+	Stream& stream = *this->streams[stream_id];
+	{
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		stream.pending.emplace_back();
+		Frame& frame = stream.pending.back();
+		if (!stream.spare.empty()) {
+			frame.objects.swap(stream.spare.back());
+			stream.spare.pop_back();
+		}
+		frame.objects.assign(objects.begin(), objects.end());
+		frame.timestamp = timestamp;
+	}
+	if (!stream.scheduled.exchange(true)) {
+		Stream* s = &stream;
+		this->pool->submit([this, s] { drain(*s); });
+	}
+	return 0;
+}
+
+void TrackerService::drain(Stream& stream) {
+	for (int n = 0; n < kMaxFramesPerTask; n++) {
+		{
+			std::lock_guard<std::mutex> lock(stream.mutex);
+			if (stream.pending.empty()) break;
+			stream.current.objects.swap(stream.pending.front().objects);
+			stream.current.timestamp = stream.pending.front().timestamp;
+			stream.pending.pop_front();
+		}
+
+		stream.output.clear();
+		stream.tracker.update(stream.output, stream.current.objects, stream.current.timestamp);
+		if (this->on_tracks) this->on_tracks(stream.id, stream.current.timestamp, stream.output);
+
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		stream.spare.emplace_back();
+		stream.spare.back().swap(stream.current.objects);
+	}
+
+	// Hand the stream back. A frame queued after the last check above saw
+	// scheduled == true and did not schedule, so look again once it is cleared.
+	bool more;
+	{
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		more = !stream.pending.empty();
+	}
+	if (more) {
+		Stream* s = &stream;
+		this->pool->submit([this, s] { drain(*s); });
+		return;
+	}
+	stream.scheduled.store(false);
+	{
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		more = !stream.pending.empty();
+	}
+	if (more && !stream.scheduled.exchange(true)) {
+		Stream* s = &stream;
+		this->pool->submit([this, s] { drain(*s); });
+	}
+}
+
+void TrackerService::wait_idle() { this->pool->wait_idle(); }
@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRACKER_SERVICE_H
+#define TRACKER_SERVICE_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "bytetrack.h"
+#include "work_stealing_pool.hpp"
+
+/*
+ * Tracker state for many streams, updated on a shared work stealing pool as
+ * detection batches arrive. Each stream is updated by at most one worker at a
+ * time and in submission order: submit() queues the frame on its stream and,
+ * if the stream is idle, schedules one task that drains the stream's queue.
+ * Streams share no lock, only the pool.
+ */
+class TrackerService {
+public:
+	// Called on a pool worker after every update, tracks are valid until the callback
+	// returns. Calls for one stream are in submission order and never overlap.
+	using Callback = std::function<void(int stream_id, double timestamp, const STracks& tracks)>;
+
+	TrackerService(const bytetrack_params& params, int num_streams, int num_threads,
+		Callback on_tracks);
+	~TrackerService();
+
+	int num_streams() const { return (int)this->streams.size(); }
+
+	// Queue one frame of detections of stream_id, captured at timestamp (seconds).
+	// Frames of one stream must be submitted from one thread at a time.
+	// Returns 0 on success, -1 on an invalid stream id.
+	int submit(int stream_id, const std::vector<YoloV5Box>& objects, double timestamp);
+
+	// Wait until every submitted frame has been tracked.
+	void wait_idle();
+
+private:
+	struct Frame {
+		std::vector<YoloV5Box> objects;
+		double timestamp;
+	};
+
+	struct Stream {
+		Stream(const bytetrack_params& params, int id) : tracker(params), id(id) {}
+
+		BYTETracker tracker;
+		int id;
+		// pending frames, spare keeps the buffers of tracked ones for reuse
+		std::mutex mutex;
+		std::deque<Frame> pending;
+		std::vector<std::vector<YoloV5Box>> spare;
+		// true while a drain task of this stream is queued or running
+		std::atomic<bool> scheduled{ false };
+		// owned by the drain task
+		Frame current;
+		STracks output;
+	};
+
+	void drain(Stream& stream);
+
+	// frames tracked per task before the stream goes back in the queue, so that a
+	// busy stream does not hold a worker
+	static const int kMaxFramesPerTask = 8;
+
+	std::vector<std::unique_ptr<Stream>> streams;
+	Callback on_tracks;
+	std::unique_ptr<WorkStealingPool> pool;
+};
+
+#endif  // TRACKER_SERVICE_H
@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef BM_IMAGE_POOL_HPP
+#define BM_IMAGE_POOL_HPP
+
+#include <map>
+#include <tuple>
+#include <cassert>
+#include "bmlib_runtime.h"
+#include "bmcv_api_ext.h"
+
+/*
+ * Staging images reused across frames, one per (width, height, format, data type).
+ * Every image is created with 64 aligned strides so that it can be fed to vpp
+ * directly. Images are owned by the pool and destroyed with it.
+ */
+class BMImagePool {
+	using Key = std::tuple<int, int, int, int>;
+
+	bm_handle_t m_handle;
+	std::map<Key, bm_image> m_images;
+
+public:
+	explicit BMImagePool(bm_handle_t handle) : m_handle(handle) {}
+
+	~BMImagePool() {
+		for (auto& it : m_images) {
+			bm_image_destroy(it.second);
+		}
+	}
+
+	BMImagePool(const BMImagePool&) = delete;
+	BMImagePool& operator=(const BMImagePool&) = delete;
+
+	// Return a staging image with the geometry of `like`, created on first use.
+	bm_image get(const bm_image& like) {
+		Key key(like.width, like.height, like.image_format, like.data_type);
+		auto it = m_images.find(key);
+		if (it != m_images.end()) {
+			return it->second;
+		}
+
+		int stride[4] = { 0 };
+		bm_image_get_stride(like, stride);
+		int plane_num = bm_image_get_plane_num(like);
+		for (int p = 0; p < plane_num; p++) {
+			stride[p] = FFALIGN(stride[p], 64);
+		}
+
+		bm_image image;
+		bm_status_t ret = bm_image_create(m_handle, like.height, like.width, like.image_format, like.data_type, &image, stride);
+		assert(BM_SUCCESS == ret);
+		ret = bm_image_alloc_dev_mem(image, BMCV_IMAGE_FOR_IN);
+		assert(BM_SUCCESS == ret);
+		m_images[key] = image;
+		return image;
+	}
+
+	// Whether every plane of image already has a 64 aligned stride.
+	static bool is_stride_aligned(const bm_image& image) {
+		int stride[4] = { 0 };
+		bm_image_get_stride(image, stride);
+		int plane_num = bm_image_get_plane_num(image);
+		for (int p = 0; p < plane_num; p++) {
+			if (stride[p] & (64 - 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif
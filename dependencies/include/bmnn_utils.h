@@ -46,6 +46,7 @@ class BMNNTensor {
 
 	std::string m_name;
 	float* m_cpu_data;
+	int8_t* m_cpu_int8_data;
 	float m_scale;
 	bm_tensor_t* m_tensor;
 
@@ -54,10 +55,20 @@ class BMNNTensor {
 public:
 	BMNNTensor(bm_handle_t handle, const char* name, float scale,
 		bm_tensor_t* tensor, bool can_mmap) :m_handle(handle), m_name(name),
-		m_cpu_data(nullptr), m_scale(scale), m_tensor(tensor), can_mmap(can_mmap) {
+		m_cpu_data(nullptr), m_cpu_int8_data(nullptr), m_scale(scale), m_tensor(tensor), can_mmap(can_mmap) {
 	}
 
 	virtual ~BMNNTensor() {
+		if (m_cpu_int8_data != NULL) {
+			if (can_mmap) {
+				int tensor_size = bm_mem_get_device_size(m_tensor->device_mem);
+				bm_status_t ret = bm_mem_unmap_device_mem(m_handle, m_cpu_int8_data, tensor_size);
+				assert(BM_SUCCESS == ret);
+			}
+			else {
+				delete[] m_cpu_int8_data;
+			}
+		}
 		if (m_cpu_data == NULL) return;
 		if (can_mmap && BM_FLOAT32 == m_tensor->dtype) {
 			int tensor_size = bm_mem_get_device_size(m_tensor->device_mem);
@@ -184,6 +195,29 @@ public:
 		return m_cpu_data;
 	}
 
+	// Return the raw quantized values of an int8 tensor without converting them to float.
+	// Multiply by get_scale() to dequantize.
+	const int8_t* get_cpu_int8_data() {
+		assert(BM_INT8 == m_tensor->dtype);
+		if (m_cpu_int8_data) return m_cpu_int8_data;
+		bm_status_t ret;
+		if (can_mmap) {
+			unsigned long long  addr;
+			ret = bm_mem_mmap_device_mem(m_handle, &m_tensor->device_mem, &addr);
+			assert(BM_SUCCESS == ret);
+			ret = bm_mem_invalidate_device_mem(m_handle, &m_tensor->device_mem);
+			assert(BM_SUCCESS == ret);
+			m_cpu_int8_data = (int8_t*)addr;
+		}
+		else {
+			int tensor_size = bmrt_tensor_bytesize(m_tensor);
+			m_cpu_int8_data = new int8_t[tensor_size];
+			ret = bm_memcpy_d2s_partial(m_handle, m_cpu_int8_data, m_tensor->device_mem, tensor_size);
+			assert(BM_SUCCESS == ret);
+		}
+		return m_cpu_int8_data;
+	}
+
 	const bm_shape_t* get_shape() {
 		return &m_tensor->shape;
 	}
@@ -308,6 +342,35 @@ public:
 		return m_max_batch;
 	}
 
+	// Switch io tensors to the smallest stage whose batch can hold real_batch,
+	// and return the batch of that stage. Inputs larger than the biggest stage
+	// fall back to it, callers are expected to split such batches.
+	int select_stage(int real_batch) {
+		int stage_idx = -1;
+		for (int s = 0; s < m_netinfo->stage_num; s++) {
+			int batch = m_netinfo->stages[s].input_shapes[0].dims[0];
+			if (batch < real_batch) continue;
+			if (stage_idx < 0 || batch < m_netinfo->stages[stage_idx].input_shapes[0].dims[0]) {
+				stage_idx = s;
+			}
+		}
+		if (stage_idx < 0) {
+			for (int s = 0; s < m_netinfo->stage_num; s++) {
+				if (m_netinfo->stages[s].input_shapes[0].dims[0] == m_max_batch) {
+					stage_idx = s;
+					break;
+				}
+			}
+		}
+		for (int i = 0; i < m_netinfo->input_num; ++i) {
+			m_inputTensors[i].shape = m_netinfo->stages[stage_idx].input_shapes[i];
+		}
+		for (int i = 0; i < m_netinfo->output_num; ++i) {
+			m_outputTensors[i].shape = m_netinfo->stages[stage_idx].output_shapes[i];
+		}
+		return m_netinfo->stages[stage_idx].input_shapes[0].dims[0];
+	}
+
 	std::shared_ptr<BMNNTensor> inputTensor(int index, int stage_idx = -1) {
 		assert(index < m_netinfo->input_num);
 		if (stage_idx >= 0) {
@@ -0,0 +1,241 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef DECODE_BUFFER_POOL_HPP
+#define DECODE_BUFFER_POOL_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "bmlib_runtime.h"
+#include "bmcv_api_ext.h"
+
+#ifndef USEING_MEM_HEAP2
+#define USEING_MEM_HEAP2 4
+#define USEING_MEM_HEAP1 2
+#endif
+
+/*
+ * Device memory of one decoder, reused from frame to frame.
+ * - Output images are kept for the current (width, height, format) and come
+ *   back through release() once the consumer is done with them. Images of an
+ *   older resolution are destroyed when they come back.
+ * - Staging buffers that host decoded planes are uploaded through, one per
+ *   plane, grow to the largest plane seen.
+ * - The descriptors wrapping the decoder's planes are created once per
+ *   geometry and re-attached every frame.
+ * acquire() and the staging and descriptor calls belong to the decode thread,
+ * release() may be called from any thread.
+ */
+class DecodeBufferPool {
+	using Key = std::tuple<int, int, int>;
+	using DescriptorKey = std::tuple<int, int, int, int, int, int>;
+
+	struct Descriptor {
+		bm_image image;
+		DescriptorKey key;
+		bool created = false;
+	};
+
+	bm_handle_t m_handle;
+	std::mutex m_mutex;
+	Key m_key{ -1, -1, -1 };
+	std::vector<bm_image> m_free;
+	int m_heap_mask = USEING_MEM_HEAP2;
+
+	bm_device_mem_t m_staging[3];
+	int m_staging_size[3] = { 0, 0, 0 };
+	Descriptor m_input;
+	Descriptor m_compressed;
+	std::atomic<int> m_device_allocations{ 0 };
+
+	bm_image descriptor(Descriptor& d, int height, int width, bm_image_format_ext format, int* stride) {
+		DescriptorKey key(width, height, format, stride ? stride[0] : 0, stride ? stride[1] : 0,
+			stride ? stride[2] : 0);
+		if (d.created && d.key == key) {
+			if (bm_image_is_attached(d.image)) {
+				bm_image_detach(d.image);
+			}
+			return d.image;
+		}
+		destroy_descriptor(d);
+		bm_image_create(m_handle, height, width, format, DATA_TYPE_EXT_1N_BYTE, &d.image, stride);
+		d.key = key;
+		d.created = true;
+		return d.image;
+	}
+
+	void destroy_descriptor(Descriptor& d) {
+		if (!d.created) return;
+		if (bm_image_is_attached(d.image)) {
+			bm_image_detach(d.image);
+		}
+		bm_image_destroy(d.image);
+		d.created = false;
+	}
+
+public:
+	explicit DecodeBufferPool(bm_handle_t handle) : m_handle(handle) {}
+
+	~DecodeBufferPool() {
+		for (auto& image : m_free) {
+			bm_image_destroy(image);
+		}
+		for (int p = 0; p < 3; p++) {
+			if (m_staging_size[p] > 0) {
+				bm_free_device(m_handle, m_staging[p]);
+			}
+		}
+		destroy_descriptor(m_input);
+		destroy_descriptor(m_compressed);
+	}
+
+	DecodeBufferPool(const DecodeBufferPool&) = delete;
+	DecodeBufferPool& operator=(const DecodeBufferPool&) = delete;
+
+	// An output image with device memory, from the free list when one of this
+	// geometry is there.
+	bm_status_t acquire(int height, int width, bm_image_format_ext format, int* stride, bm_image& image) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Key key(width, height, format);
+			if (key != m_key) {
+				for (auto& old : m_free) {
+					bm_image_destroy(old);
+				}
+				m_free.clear();
+				m_key = key;
+			}
+			if (!m_free.empty()) {
+				image = m_free.back();
+				m_free.pop_back();
+				return BM_SUCCESS;
+			}
+		}
+
+		bm_status_t ret = bm_image_create(m_handle, height, width, format, DATA_TYPE_EXT_1N_BYTE, &image, stride);
+		if (ret != BM_SUCCESS) {
+			return ret;
+		}
+		if (m_heap_mask == USEING_MEM_HEAP2 && bm_image_alloc_dev_mem_heap_mask(image, m_heap_mask) != BM_SUCCESS) {
+			m_heap_mask = USEING_MEM_HEAP1;
+		}
+		if (m_heap_mask == USEING_MEM_HEAP1 && bm_image_alloc_dev_mem_heap_mask(image, m_heap_mask) != BM_SUCCESS) {
+			bm_image_destroy(image);
+			return BM_ERR_NOMEM;
+		}
+		m_device_allocations++;
+		return BM_SUCCESS;
+	}
+
+	// Give back an image from acquire().
+	void release(bm_image& image) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (Key(image.width, image.height, image.image_format) == m_key) {
+				m_free.push_back(image);
+				return;
+			}
+		}
+		bm_image_destroy(image);
+	}
+
+	// Device buffer of at least size bytes to upload plane through, valid until
+	// the next call for the same plane.
+	bm_status_t staging(int plane, int size, bm_device_mem_t& mem) {
+		if (m_staging_size[plane] < size) {
+			if (m_staging_size[plane] > 0) {
+				bm_free_device(m_handle, m_staging[plane]);
+				m_staging_size[plane] = 0;
+			}
+			if (bm_malloc_device_byte(m_handle, &m_staging[plane], size) != BM_SUCCESS) {
+				return BM_ERR_NOMEM;
+			}
+			m_staging_size[plane] = size;
+			m_device_allocations++;
+		}
+		mem = m_staging[plane];
+		return BM_SUCCESS;
+	}
+
+	// Descriptor without memory for the decoded planes, ready for bm_image_attach.
+	bm_image input_image(int height, int width, bm_image_format_ext format, int* stride) {
+		return descriptor(m_input, height, width, format, stride);
+	}
+
+	// Same for the compressed frames of the hardware decoder.
+	bm_image compressed_image(int height, int width) {
+		return descriptor(m_compressed, height, width, FORMAT_COMPRESSED, NULL);
+	}
+
+	// Device allocations made so far, constant once the pool is warm.
+	int device_allocations() const { return m_device_allocations.load(); }
+};
+
+/*
+ * A decoded frame that hands its image back to the decoder's pool when it is
+ * reset or destroyed. Move only. The pool outlives the decoder as long as
+ * frames of it are held.
+ */
+class DecodedFrame {
+	std::shared_ptr<DecodeBufferPool> m_pool;
+	bm_image m_image;
+	bool m_valid = false;
+
+public:
+	DecodedFrame() {}
+	DecodedFrame(std::shared_ptr<DecodeBufferPool> pool, const bm_image& image)
+		: m_pool(std::move(pool)), m_image(image), m_valid(true) {}
+
+	~DecodedFrame() { reset(); }
+
+	DecodedFrame(const DecodedFrame&) = delete;
+	DecodedFrame& operator=(const DecodedFrame&) = delete;
+
+	DecodedFrame(DecodedFrame&& other) noexcept : m_pool(std::move(other.m_pool)), m_image(other.m_image), m_valid(other.m_valid) {
+		other.m_valid = false;
+	}
+
+	DecodedFrame& operator=(DecodedFrame&& other) noexcept {
+		if (this != &other) {
+			reset();
+			m_pool = std::move(other.m_pool);
+			m_image = other.m_image;
+			m_valid = other.m_valid;
+			other.m_valid = false;
+		}
+		return *this;
+	}
+
+	bool empty() const { return !m_valid; }
+	bm_image& image() { return m_image; }
+	const bm_image& image() const { return m_image; }
+
+	void reset() {
+		if (!m_valid) return;
+		if (m_pool) {
+			m_pool->release(m_image);
+		}
+		else {
+			bm_image_destroy(m_image);
+		}
+		m_pool.reset();
+		m_valid = false;
+	}
+
+	// Take the image out of the pool's cycle, the caller destroys it.
+	bm_image release() {
+		m_pool.reset();
+		m_valid = false;
+		return m_image;
+	}
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <queue>
 #include <mutex>
+#include <atomic>
 #include <pthread.h>
 #include "bmruntime_interface.h"
 #include "bmcv_api_ext.h"
@@ -21,6 +22,8 @@
 #include <opencv2/core.hpp>
 #include "libyuv.h"
 #include "bm_wrapper.hpp"
+#include "frame_queue.hpp"
+#include "decode_buffer_pool.hpp"
 extern "C"
 {
 #include <libavformat/avformat.h>
@@ -88,8 +91,10 @@ int map_avformat_to_bmformat(int avformat);
 
 /**
  * @brief convert avformat to bm_image.
+ * With a pool, out and the upload buffers come from it and out goes back with pool->release(),
+ * without one every call allocates device memory and out is destroyed by the caller.
  */
-bm_status_t avframe_to_bm_image(bm_handle_t &handle, AVFrame *in, bm_image *out, bool is_jpeg, bool data_on_device_mem, int coded_width=-1, int coded_height=-1);
+bm_status_t avframe_to_bm_image(bm_handle_t &handle, AVFrame *in, bm_image *out, bool is_jpeg, bool data_on_device_mem, int coded_width=-1, int coded_height=-1, int stride_align=1, DecodeBufferPool *pool=NULL);
 
 /**
  * @brief picture decode. support jpg and png
@@ -98,13 +103,23 @@ bm_status_t picDec(bm_handle_t &handle, const char *path, bm_image &img);
 bm_status_t jpgDec(bm_handle_t& handle, uint8_t* bs_buffer, int numBytes, bm_image& img);
 bm_status_t miscDec(bm_handle_t& handle, uint8_t* bs_buffer, int numBytes, int type, bm_image& img);
 
+enum GrabStatus {
+    GRAB_READY = FRAME_QUEUE_READY,
+    GRAB_TIMEOUT = FRAME_QUEUE_TIMEOUT,
+    GRAB_EOS = FRAME_QUEUE_CLOSED,
+};
+
 /**
  * video decode class
  * support video file and rtsp stream.
  *
- * VideoDecFFM create a thread to decode, convert AVFrame to bm_image, push bm_image into the cache queue.
- * When the queue is full, for video file, the decode thread will sleep. For rtsp stream, the decode thread
- * will pop the front element of the queue.
+ * VideoDecFFM create a thread to decode, convert AVFrame to bm_image, push bm_image into a fixed size
+ * FrameQueue of QUEUE_MAX_SIZE frames. When the queue is full, for video file, the decode thread waits
+ * for the consumer (FRAME_QUEUE_BACKPRESSURE). For rtsp stream, the oldest frame is dropped
+ * (FRAME_QUEUE_DROP_OLDEST). setQueuePolicy() overrides the choice.
+ *
+ * Frames are converted into device memory of a per-decoder DecodeBufferPool. A frame grabbed as
+ * DecodedFrame goes back to the pool when it is released, so a steady stream allocates nothing.
  *
  */
 class VideoDecFFM {
@@ -113,15 +128,29 @@ public:
 
     ~VideoDecFFM();
 
+    // call before openDec
+    void setQueuePolicy(FrameQueuePolicy policy) { queue_policy = policy; }
     int openDec(bm_handle_t* dec_handle, const char* input);
+    /**
+     * @brief wait up to timeout_ms (forever when negative) for the next frame.
+     * @return GRAB_READY with the frame in frame. GRAB_TIMEOUT, or GRAB_EOS once the stream has
+     *         ended and every decoded frame was grabbed.
+     */
+    GrabStatus grab(DecodedFrame& frame, int timeout_ms);
+    // same, but the image leaves the pool and the caller destroys it
+    GrabStatus grab(bm_image& img, int timeout_ms);
+    // blocking grab, nullptr at end of stream. The image is valid until the next call
+    // and the caller destroys it.
     bm_image* grab();
 
     int get_width() const { return width; }
     int get_height() const { return height; }
+    FrameQueueStats get_queue_stats() const { return queue.stats(); }
+    int get_device_allocations() const { return buffer_pool ? buffer_pool->device_allocations() : 0; }
 
     void closeDec();
 private:
-    bool quit_flag = false;
+    std::atomic<bool> quit_flag{ false };
     int is_rtsp;
     int width;
     int height;
@@ -129,6 +158,8 @@ private:
     int coded_height;
     int pix_fmt;
     bool data_on_device_mem = true;
+    // decoded frames get 64 aligned strides so detectors can skip the staging copy
+    int output_stride_align = 64;
     int video_stream_idx;
     int refcount;
     int output_format = 101;
@@ -139,8 +170,10 @@ private:
     AVCodecContext* video_dec_ctx;
     AVCodecParameters* video_dec_par;
     bm_handle_t* handle;
-    std::mutex lock;
-    std::queue<bm_image*> queue;
+    int queue_policy = -1;  // -1: chosen by openDec from the input
+    FrameQueue<bm_image> queue{ QUEUE_MAX_SIZE };
+    std::shared_ptr<DecodeBufferPool> buffer_pool;
+    bm_image grabbed;
     std::thread pushThread;
 
     int openCodecContext(int* stream_idx, AVCodecContext** dec_ctx, AVFormatContext* fmt_ctx,
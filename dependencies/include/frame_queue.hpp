@@ -0,0 +1,233 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef FRAME_QUEUE_HPP
+#define FRAME_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum FrameQueueStatus { FRAME_QUEUE_READY = 0, FRAME_QUEUE_TIMEOUT, FRAME_QUEUE_CLOSED };
+
+// What the producer does when the queue is full.
+enum FrameQueuePolicy {
+	FRAME_QUEUE_DROP_OLDEST = 0,  // evict the oldest frame, for live sources
+	FRAME_QUEUE_BACKPRESSURE,     // wait for the consumer, for files
+};
+
+struct FrameQueueStats {
+	int capacity;
+	int depth;
+	uint64_t pushed;
+	uint64_t popped;
+	uint64_t dropped;
+};
+
+/*
+ * Fixed capacity frame queue between one decode thread and one consumer.
+ * Items are copied into slots allocated once, and slots are handed over
+ * without a lock through a per-slot sequence number: a slot at position pos
+ * is free when its sequence is pos and holds an item when it is pos + 1.
+ * Under FRAME_QUEUE_DROP_OLDEST the producer may also take the oldest item,
+ * so removal claims the position with a compare and swap.
+ * The mutex is only taken by a side that goes to sleep and by the side
+ * that wakes it.
+ */
+template <typename T>
+class FrameQueue {
+	struct Slot {
+		std::atomic<size_t> seq;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> m_slots;
+	const size_t m_capacity;
+	FrameQueuePolicy m_policy = FRAME_QUEUE_BACKPRESSURE;
+	std::atomic<size_t> m_head{ 0 };  // next position to fill, producer only
+	std::atomic<size_t> m_tail{ 0 };  // next position to take
+	std::atomic<bool> m_closed{ false };
+
+	std::mutex m_mutex;
+	std::condition_variable m_not_empty;
+	std::condition_variable m_not_full;
+	std::atomic<bool> m_consumer_waiting{ false };
+	std::atomic<bool> m_producer_waiting{ false };
+
+	std::atomic<uint64_t> m_pushed{ 0 };
+	std::atomic<uint64_t> m_popped{ 0 };
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	bool try_push(const T& value) {
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		Slot& slot = m_slots[pos % m_capacity];
+		if (slot.seq.load() != pos) {
+			return false;  // full, or the oldest item is still being copied out
+		}
+		slot.value = value;
+		slot.seq.store(pos + 1);
+		m_head.store(pos + 1);
+		return true;
+	}
+
+	bool take(T& value) {
+		size_t pos = m_tail.load();
+		while (true) {
+			Slot& slot = m_slots[pos % m_capacity];
+			std::ptrdiff_t diff = (std::ptrdiff_t)(slot.seq.load() - (pos + 1));
+			if (diff < 0) {
+				return false;  // empty
+			}
+			if (diff > 0) {
+				pos = m_tail.load();  // taken by the other side
+				continue;
+			}
+			if (m_tail.compare_exchange_weak(pos, pos + 1)) {
+				value = slot.value;
+				slot.seq.store(pos + m_capacity);
+				return true;
+			}
+		}
+	}
+
+	// the sleeper sets its flag and then checks the queue, the waker changes the
+	// queue and then checks the flag, so one of them sees the other
+	void wake(std::atomic<bool>& waiting, std::condition_variable& cv) {
+		if (waiting.load()) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			cv.notify_one();
+		}
+	}
+
+	bool has_item() const {
+		size_t pos = m_tail.load();
+		return m_slots[pos % m_capacity].seq.load() == pos + 1;
+	}
+
+	bool has_room() const {
+		size_t pos = m_head.load();
+		return m_slots[pos % m_capacity].seq.load() == pos;
+	}
+
+public:
+	// a capacity below 2 would make a full slot look like a free one
+	explicit FrameQueue(int capacity) : m_capacity(capacity < 2 ? 2 : capacity) {
+		m_slots.reset(new Slot[m_capacity]);
+		for (size_t i = 0; i < m_capacity; i++) {
+			m_slots[i].seq.store(i);
+		}
+	}
+
+	FrameQueue(const FrameQueue&) = delete;
+	FrameQueue& operator=(const FrameQueue&) = delete;
+
+	// Must be set before the producer starts.
+	void set_policy(FrameQueuePolicy policy) { m_policy = policy; }
+	FrameQueuePolicy policy() const { return m_policy; }
+
+	// Producer side. Returns 0 when value was queued, 1 when it was queued after
+	// the oldest item was dropped to make room (the caller releases evicted), and
+	// -1 when the queue is closed and value was not queued.
+	int push(const T& value, T& evicted) {
+		bool has_evicted = false;
+		while (!m_closed.load()) {
+			if (try_push(value)) {
+				m_pushed.fetch_add(1, std::memory_order_relaxed);
+				wake(m_consumer_waiting, m_not_empty);
+				return has_evicted ? 1 : 0;
+			}
+			if (m_policy == FRAME_QUEUE_DROP_OLDEST) {
+				if (!has_evicted && take(evicted)) {
+					has_evicted = true;
+					m_dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+				else {
+					// the consumer is still copying out the slot we need
+					std::this_thread::yield();
+				}
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_producer_waiting.store(true);
+			m_not_full.wait(lock, [&] { return m_closed.load() || has_room(); });
+			m_producer_waiting.store(false);
+		}
+		return has_evicted ? 1 : -1;
+	}
+
+	// Consumer side. Waits up to timeout_ms for an item, forever when timeout_ms
+	// is negative. Items queued before close() are still handed out, after that
+	// FRAME_QUEUE_CLOSED is returned.
+	FrameQueueStatus pop(T& value, int timeout_ms) {
+		while (true) {
+			if (take(value)) {
+				m_popped.fetch_add(1, std::memory_order_relaxed);
+				wake(m_producer_waiting, m_not_full);
+				return FRAME_QUEUE_READY;
+			}
+			if (m_closed.load() && !has_item()) {
+				return FRAME_QUEUE_CLOSED;
+			}
+			if (timeout_ms == 0) {
+				return FRAME_QUEUE_TIMEOUT;
+			}
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_consumer_waiting.store(true);
+			auto ready = [&] { return m_closed.load() || has_item(); };
+			bool woken = true;
+			if (timeout_ms < 0) {
+				m_not_empty.wait(lock, ready);
+			}
+			else {
+				woken = m_not_empty.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+			}
+			m_consumer_waiting.store(false);
+			if (!woken) {
+				return FRAME_QUEUE_TIMEOUT;
+			}
+			if (timeout_ms > 0) timeout_ms = 0;
+		}
+	}
+
+	// Consumer side, or either side once the producer has stopped.
+	bool try_pop(T& value) {
+		if (!take(value)) return false;
+		m_popped.fetch_add(1, std::memory_order_relaxed);
+		wake(m_producer_waiting, m_not_full);
+		return true;
+	}
+
+	// End of stream: wakes both sides, later pushes fail.
+	void close() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed.store(true);
+		m_not_empty.notify_all();
+		m_not_full.notify_all();
+	}
+
+	bool closed() const { return m_closed.load(); }
+
+	FrameQueueStats stats() const {
+		FrameQueueStats s;
+		size_t tail = m_tail.load();
+		size_t head = m_head.load();
+		s.capacity = (int)m_capacity;
+		s.depth = head > tail ? (int)(head - tail) : 0;
+		s.pushed = m_pushed.load(std::memory_order_relaxed);
+		s.popped = m_popped.load(std::memory_order_relaxed);
+		s.dropped = m_dropped.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif
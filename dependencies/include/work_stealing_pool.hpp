@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Pool for many small independent tasks submitted from any thread, such as
+ * per-stream tracker updates. Every worker owns a deque: tasks submitted from a
+ * worker go to its own deque, tasks from other threads are spread round robin.
+ * A worker takes the oldest task of its own deque and, when that is empty,
+ * steals the newest task of another worker, so a burst landing on one deque is
+ * shared out without a central queue. Each deque has its own lock, held only
+ * to push or pop one task.
+ */
+class WorkStealingPool {
+public:
+	using Task = std::function<void()>;
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+	std::atomic<unsigned> m_next_queue{ 0 };
+	std::atomic<int> m_queued{ 0 };   // tasks in the deques
+	std::atomic<int> m_pending{ 0 };  // queued or running
+
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_wake_cv;
+	std::condition_variable m_idle_cv;
+	bool m_quit = false;
+
+	// index of the calling thread's deque when it is a worker of this pool, else -1
+	int current_worker() const {
+		return t_owner() == this ? t_index() : -1;
+	}
+	static const WorkStealingPool*& t_owner() {
+		static thread_local const WorkStealingPool* owner = nullptr;
+		return owner;
+	}
+	static int& t_index() {
+		static thread_local int index = -1;
+		return index;
+	}
+
+	bool try_pop(int index, Task& task) {
+		int n = (int)m_queues.size();
+		for (int k = 0; k < n; k++) {
+			Queue& q = *m_queues[(index + k) % n];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (q.tasks.empty()) continue;
+			if (k == 0) {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			else {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+			m_queued--;
+			return true;
+		}
+		return false;
+	}
+
+	void worker_loop(int index) {
+		t_owner() = this;
+		t_index() = index;
+		Task task;
+		while (true) {
+			if (try_pop(index, task)) {
+				task();
+				task = nullptr;
+				if (--m_pending == 0) {
+					std::lock_guard<std::mutex> lock(m_sleep_mutex);
+					m_idle_cv.notify_all();
+				}
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleep_mutex);
+			m_wake_cv.wait(lock, [&] { return m_quit || m_queued > 0; });
+			if (m_quit && m_queued == 0) return;
+		}
+	}
+
+public:
+	explicit WorkStealingPool(int size) {
+		if (size < 1) size = 1;
+		for (int i = 0; i < size; i++) {
+			m_queues.emplace_back(new Queue());
+		}
+		for (int i = 0; i < size; i++) {
+			m_threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+		}
+	}
+
+	// runs the tasks still queued, then joins the workers
+	~WorkStealingPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			m_quit = true;
+		}
+		m_wake_cv.notify_all();
+		for (auto& t : m_threads) {
+			t.join();
+		}
+	}
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	int size() const { return (int)m_threads.size(); }
+
+	void submit(Task task) {
+		int index = current_worker();
+		if (index < 0) {
+			index = (int)(m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size());
+		}
+		m_pending++;
+		{
+			Queue& q = *m_queues[index];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.push_back(std::move(task));
+		}
+		{
+			// taken so that a worker between its check and its wait does not miss the wakeup
+			std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			m_queued++;
+		}
+		m_wake_cv.notify_one();
+	}
+
+	// Wait until every task submitted so far, and every task they submitted, has run.
+	// Must not be called from a worker.
+	void wait_idle() {
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		m_idle_cv.wait(lock, [&] { return m_pending == 0; });
+	}
+};
+
+#endif
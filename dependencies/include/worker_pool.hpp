@@ -0,0 +1,110 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed-size pool for fork-join loops such as per-image post processing.
+ * The calling thread takes part in every loop, so a pool of size n runs
+ * n - 1 helper threads, and a pool of size 1 runs everything inline.
+ * Worker ids passed to the loop body are in [0, size()), which lets the
+ * caller keep one scratch buffer per worker.
+ */
+class WorkerPool {
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+
+	std::function<void(int, int)> m_job;
+	int m_job_size = 0;
+	std::atomic<int> m_next{ 0 };
+	int m_generation = 0;
+	int m_running = 0;
+	bool m_quit = false;
+
+	void run_job(int worker_id) {
+		int idx;
+		while ((idx = m_next.fetch_add(1)) < m_job_size) {
+			m_job(idx, worker_id);
+		}
+	}
+
+	void worker_loop(int worker_id) {
+		int seen_generation = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start_cv.wait(lock, [&] { return m_quit || m_generation != seen_generation; });
+				if (m_quit) return;
+				seen_generation = m_generation;
+			}
+			run_job(worker_id);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_running == 0) m_done_cv.notify_one();
+			}
+		}
+	}
+
+public:
+	explicit WorkerPool(int size) {
+		for (int i = 1; i < size; i++) {
+			m_threads.emplace_back(&WorkerPool::worker_loop, this, i);
+		}
+	}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_start_cv.notify_all();
+		for (auto& t : m_threads) {
+			t.join();
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int size() const { return (int)m_threads.size() + 1; }
+
+	// Run func(index, worker_id) for every index in [0, n) and wait for all of them.
+	// Not reentrant: one loop at a time per pool.
+	void parallel_for(int n, const std::function<void(int, int)>& func) {
+		if (n <= 0) return;
+		if (n == 1 || m_threads.empty()) {
+			for (int i = 0; i < n; i++) func(i, 0);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = func;
+			m_job_size = n;
+			m_next = 0;
+			m_running = (int)m_threads.size();
+			m_generation++;
+		}
+		m_start_cv.notify_all();
+		run_job(0);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done_cv.wait(lock, [&] { return m_running == 0; });
+		m_job = nullptr;
+	}
+};
+
+#endif
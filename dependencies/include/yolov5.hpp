@@ -17,6 +17,8 @@
 #include "bmnn_utils.h"
 #include "utils.hpp"
 #include "bm_wrapper.hpp"
+#include "bm_image_pool.hpp"
+#include "worker_pool.hpp"
 // Define USE_OPENCV for enabling OPENCV related funtions in bm_wrapper.hpp
 #define USE_OPENCV 1
 #define DEBUG 0
@@ -34,6 +36,15 @@ class YoloV5 {
 	std::shared_ptr<BMNNNetwork> m_bmNetwork;
 	std::vector<bm_image> m_resized_imgs;
 	std::vector<bm_image> m_converto_imgs;
+	std::shared_ptr<BMImagePool> m_staging_pool;
+
+	// per-image post processing runs on a small pool, each worker owns its scratch
+	struct PostScratch {
+		std::vector<float> decoded_data;
+		YoloV5BoxVec boxes;
+	};
+	std::shared_ptr<WorkerPool> m_post_pool;
+	std::vector<PostScratch> m_post_scratch;
 
 	//configuration
 	float m_confThreshold = 0.5;
@@ -55,6 +66,11 @@ private:
 	int pre_process(const std::vector<bm_image>& images);
 	int post_process(const std::vector<bm_image>& images, std::vector<YoloV5BoxVec>& boxes);
 	int post_process_cpu_opt(const std::vector<bm_image>& images, std::vector<YoloV5BoxVec>& detected_boxes);
+	void post_process_image(const bm_image& frame, int batch_idx, std::vector<std::shared_ptr<BMNNTensor>>& outputTensors,
+		int min_idx, int total_box_num, int nout, PostScratch& scratch, YoloV5BoxVec& result);
+	template <typename T>
+	float* decode_anchor(const T* ptr, int area, int feat_w, int feat_h, int nout, int out_nout,
+		float scale, float conf_thresh, float anchor_w, float anchor_h, float* dst);
 	int argmax(float* data, int dsize);
 	static float get_aspect_scaled_ratio(int src_w, int src_h, int dst_w, int dst_h, bool* alignWidth);
 	static float sigmoid(float x);
@@ -380,12 +380,46 @@ bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out,
 	return BM_SUCCESS;
 }
 */
-bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out, bool is_jpeg, bool data_on_device_mem, int coded_width, int coded_height) {
+// output image with device memory, from pool when there is one
+static bm_status_t create_output_image(bm_handle_t& handle, int height, int width, bm_image_format_ext format,
+	int* stride, bm_image* out, DecodeBufferPool* pool) {
+	if (pool) {
+		if (pool->acquire(height, width, format, stride, *out) != BM_SUCCESS) {
+			printf("bmcv allocate mem failed!!!\n");
+			return BM_ERR_NOMEM;
+		}
+		return BM_SUCCESS;
+	}
+
+	static int mem_flags = USEING_MEM_HEAP2;
+	bm_image_create(handle, height, width, format, DATA_TYPE_EXT_1N_BYTE, out, stride);
+	if (mem_flags == USEING_MEM_HEAP2 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
+		mem_flags = USEING_MEM_HEAP1;
+	}
+	if (mem_flags == USEING_MEM_HEAP1 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
+		printf("bmcv allocate mem failed!!!\n");
+		bm_image_destroy(*out);
+		return BM_ERR_NOMEM;
+	}
+	return BM_SUCCESS;
+}
+
+// device copy of a host plane, in the pool's staging buffer when there is one
+static bm_status_t upload_plane(bm_handle_t& handle, const uint8_t* data, int size, int plane,
+	bm_device_mem_t* mem, DecodeBufferPool* pool) {
+	bm_status_t ret = pool ? pool->staging(plane, size, *mem) : bm_malloc_device_byte(handle, mem, size);
+	if (ret != BM_SUCCESS) {
+		printf("bmcv allocate mem failed!!!\n");
+		return BM_ERR_NOMEM;
+	}
+	return bm_memcpy_s2d_partial(handle, *mem, (void*)data, size);
+}
+
+bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out, bool is_jpeg, bool data_on_device_mem, int coded_width, int coded_height, int stride_align, DecodeBufferPool* pool) {
 	int plane = 0;
 	int data_four_denominator = -1;
 	int data_five_denominator = -1;
 	int data_six_denominator = -1;
-	static int mem_flags = USEING_MEM_HEAP2;
 
 	// 验证输入参数
 	if (!in || !out || in->width <= 0 || in->height <= 0) {
@@ -447,7 +481,12 @@ bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out,
 			return BM_ERR_PARAM;
 		}
 		bm_image cmp_bmimg;
-		bm_image_create(handle, coded_height, coded_width, FORMAT_COMPRESSED, DATA_TYPE_EXT_1N_BYTE, &cmp_bmimg);
+		if (pool) {
+			cmp_bmimg = pool->compressed_image(coded_height, coded_width);
+		}
+		else {
+			bm_image_create(handle, coded_height, coded_width, FORMAT_COMPRESSED, DATA_TYPE_EXT_1N_BYTE, &cmp_bmimg);
+		}
 
 		bm_device_mem_t input_addr[4];
 		int size = in->height * in->linesize[4];
@@ -459,18 +498,18 @@ bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out,
 		size = in->linesize[7];
 		input_addr[3] = bm_mem_from_device((unsigned long long)in->data[5], size);
 		bm_image_attach(cmp_bmimg, input_addr);
-		bm_image_create(handle, in->height, in->width, FORMAT_YUV420P, DATA_TYPE_EXT_1N_BYTE, out);
-		if (mem_flags == USEING_MEM_HEAP2 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
-			mem_flags = USEING_MEM_HEAP1;
-		}
-		if (mem_flags == USEING_MEM_HEAP1 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
-			printf("bmcv allocate mem failed!!!\n");
+		int out_stride[3] = { FFALIGN(in->width, stride_align), FFALIGN((in->width + 1) / 2, stride_align),
+			FFALIGN((in->width + 1) / 2, stride_align) };
+		if (create_output_image(handle, in->height, in->width, FORMAT_YUV420P, out_stride, out, pool) != BM_SUCCESS) {
+			if (!pool)
+				bm_image_destroy(cmp_bmimg);
 			return BM_ERR_NOMEM;
 		}
 
 		bmcv_rect_t crop_rect = { 0, 0, in->width, in->height };
 		bmcv_image_vpp_convert(handle, 1, cmp_bmimg, out, &crop_rect);
-		bm_image_destroy(cmp_bmimg);
+		if (!pool)
+			bm_image_destroy(cmp_bmimg);
 	}
 	else {
 		int stride[3] = { 0 };
@@ -525,82 +564,70 @@ bm_status_t avframe_to_bm_image(bm_handle_t& handle, AVFrame* in, bm_image* out,
 		bm_device_mem_t input_addr[3] = { 0 };
 		bm_format = (bm_image_format_ext)map_avformat_to_bmformat(in->format);
 		bm_image tmp;
-		bm_image_create(handle, in->height, in->width, bm_format, DATA_TYPE_EXT_1N_BYTE, &tmp, stride);
-		bm_image_create(handle, in->height, in->width, FORMAT_BGR_PACKED, DATA_TYPE_EXT_1N_BYTE, out);
-		if (mem_flags == USEING_MEM_HEAP2 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
-			mem_flags = USEING_MEM_HEAP1;
+		if (pool) {
+			tmp = pool->input_image(in->height, in->width, bm_format, stride);
 		}
-		if (mem_flags == USEING_MEM_HEAP1 && bm_image_alloc_dev_mem_heap_mask(*out, mem_flags) != BM_SUCCESS) {
-			printf("bmcv allocate mem failed!!!\n");
+		else {
+			bm_image_create(handle, in->height, in->width, bm_format, DATA_TYPE_EXT_1N_BYTE, &tmp, stride);
+		}
+		int out_stride[1] = { FFALIGN(in->width * 3, stride_align) };
+		if (create_output_image(handle, in->height, in->width, FORMAT_BGR_PACKED, out_stride, out, pool) != BM_SUCCESS) {
+			if (!pool)
+				bm_image_destroy(tmp);
 			return BM_ERR_NOMEM;
 		}
 
 		// 数据复制
-		int size = in->height * stride[0];
+		int plane_size[3] = { in->height * stride[0], 0, 0 };
 		if (data_four_denominator != -1) {
-			size = in->height * stride[0] * 3; // RGB/BGR
+			plane_size[0] = in->height * stride[0] * 3; // RGB/BGR
 		}
-		if (data_on_device_mem) {
-			input_addr[0] = bm_mem_from_device((unsigned long long)in->data[0], size);
+		if (data_five_denominator != -1) {
+			plane_size[1] = FF_ALIGN(in->height, 2) * stride[1] / data_five_denominator;
 		}
-		else {
-			bm_malloc_device_byte(handle, &input_addr[0], size);
-			bm_memcpy_s2d_partial(handle, input_addr[0], in->data[0], size);
+		if (data_six_denominator != -1) {
+			plane_size[2] = FF_ALIGN(in->height, 2) * stride[2] / data_six_denominator;
 		}
-
-		if (data_five_denominator != -1) {
-			size = FF_ALIGN(in->height, 2) * stride[1] / data_five_denominator;
+		int uploaded = 0;
+		bm_status_t ret = BM_SUCCESS;
+		for (int p = 0; p < 3 && plane_size[p] > 0; p++) {
 			if (data_on_device_mem) {
-				input_addr[1] = bm_mem_from_device((unsigned long long)in->data[1], size);
+				input_addr[p] = bm_mem_from_device((unsigned long long)in->data[p], plane_size[p]);
+				continue;
 			}
-			else {
-				bm_malloc_device_byte(handle, &input_addr[1], size);
-				bm_memcpy_s2d_partial(handle, input_addr[1], in->data[1], size);
+			ret = upload_plane(handle, in->data[p], plane_size[p], p, &input_addr[p], pool);
+			if (ret != BM_SUCCESS) {
+				break;
 			}
+			uploaded++;
 		}
 
-		if (data_six_denominator != -1) {
-			size = FF_ALIGN(in->height, 2) * stride[2] / data_six_denominator;
-			if (data_on_device_mem) {
-				input_addr[2] = bm_mem_from_device((unsigned long long)in->data[2], size);
+		if (ret == BM_SUCCESS) {
+			bm_image_attach(tmp, input_addr);
+			if (is_jpeg) {
+				csc_type_t csc_type = CSC_YPbPr2RGB_BT601;
+				bmcv_image_vpp_csc_matrix_convert(handle, 1, tmp, out, csc_type, NULL, BMCV_INTER_NEAREST, NULL);
 			}
 			else {
-				bm_malloc_device_byte(handle, &input_addr[2], size);
-				bm_memcpy_s2d_partial(handle, input_addr[2], in->data[2], size);
+				bmcv_rect_t crop_rect = { 0, 0, in->width, in->height };
+				bmcv_image_vpp_convert(handle, 1, tmp, out, &crop_rect);
 			}
 		}
 
-		// 调试信息
-		bm_image_format_info_t tmp_info;
-		bm_image_get_format_info(&tmp, &tmp_info);
-		printf("tmp bm_image: width=%d, height=%d, stride=%d, format=\n",
-			tmp_info.width, tmp_info.height, tmp_info.stride[0]);
-
-		bm_image_attach(tmp, input_addr);
-		if (is_jpeg) {
-			csc_type_t csc_type = CSC_YPbPr2RGB_BT601;
-			bmcv_image_vpp_csc_matrix_convert(handle, 1, tmp, out, csc_type, NULL, BMCV_INTER_NEAREST, NULL);
+		// 清理设备内存, staging 缓存归 pool 所有
+		if (!pool) {
+			bm_image_destroy(tmp);
+			for (int p = 0; p < uploaded; p++) {
+				bm_free_device(handle, input_addr[p]);
+			}
 		}
-		else {
-			bmcv_rect_t crop_rect = { 0, 0, in->width, in->height };
-			bmcv_image_vpp_convert(handle, 1, tmp, out, &crop_rect);
+		if (ret != BM_SUCCESS) {
+			if (pool)
+				pool->release(*out);
+			else
+				bm_image_destroy(*out);
+			return ret;
 		}
-		bm_image_destroy(tmp);
-
-		// 清理设备内存
-		if (!data_on_device_mem) {
-			bm_free_device(handle, input_addr[0]);
-			if (data_five_denominator != -1)
-				bm_free_device(handle, input_addr[1]);
-			if (data_six_denominator != -1)
-				bm_free_device(handle, input_addr[2]);
-		}
-
-		// 调试输出 bm_image
-		bm_image_format_info_t out_info;
-		bm_image_get_format_info(out, &out_info);
-		printf("out bm_image: width=%d, height=%d, stride=%d, format=\n",
-			out_info.width, out_info.height, out_info.stride[0]);
 	}
 	return BM_SUCCESS;
 }
@@ -658,6 +685,11 @@ int VideoDecFFM::openDec(bm_handle_t* dec_handle, const char* input) {
 	printf("Video: width=%d, height=%d, coded_width=%d, coded_height=%d, pix_fmt=%d\n",
 		width, height, coded_width, coded_height, pix_fmt);
 
+	if (queue_policy < 0) {
+		queue_policy = is_rtsp ? FRAME_QUEUE_DROP_OLDEST : FRAME_QUEUE_BACKPRESSURE;
+	}
+	queue.set_policy((FrameQueuePolicy)queue_policy);
+	buffer_pool = std::make_shared<DecodeBufferPool>(*handle);
 	pushThread = std::thread(&VideoDecFFM::vidPushImage, this);
 	return 0;
 }
@@ -665,15 +697,17 @@ int VideoDecFFM::openDec(bm_handle_t* dec_handle, const char* input) {
 void VideoDecFFM::closeDec() {
 	{
 		quit_flag = true;
+		// wakes the decode thread if it waits for room
+		queue.close();
 		if (pushThread.joinable()) {
 			pushThread.join();
 		}
-		while (!queue.empty()) {
-			bm_image* img = queue.front();
-			queue.pop();
-			bm_image_destroy(*img);
-			delete img;
+		bm_image img;
+		while (queue.try_pop(img)) {
+			buffer_pool->release(img);
 		}
+		// frames still held by the consumer keep the pool alive
+		buffer_pool.reset();
 		if (frame) {
 			av_frame_free(&frame);
 		}
@@ -834,53 +868,55 @@ AVFrame* VideoDecFFM::flushDecoder()
 }
 
 void* VideoDecFFM::vidPushImage() {
-	while (1) {
-		while (queue.size() == QUEUE_MAX_SIZE && !quit_flag) {
-			if (is_rtsp) {
-				std::lock_guard<std::mutex> my_lock_guard(lock);
-				bm_image* img = queue.front();
-				bm_image_destroy(*img);
-				delete img;
-				img = nullptr;
-				queue.pop();
-			}
-			else {
-				usleep(2000);
-			}
-		}
-
-		bm_image* img = new bm_image;
+	while (!quit_flag) {
 		AVFrame* avframe = grabFrame();
-		if (quit_flag)
-		{
-			delete img;
-			img = nullptr;
+		if (quit_flag || !avframe) {
 			break;
 		}
 		coded_width = video_dec_ctx->coded_width;
 		coded_height = video_dec_ctx->coded_height;
-		avframe_to_bm_image(*(this->handle), avframe, img, false, this->data_on_device_mem,
-			coded_width, coded_height);
+		bm_image img;
+		if (avframe_to_bm_image(*(this->handle), avframe, &img, false, this->data_on_device_mem,
+			coded_width, coded_height, output_stride_align, buffer_pool.get()) != BM_SUCCESS) {
+			continue;
+		}
 
-		std::lock_guard<std::mutex> my_lock_guard(lock);
-		queue.push(img);
+		bm_image evicted;
+		int ret = queue.push(img, evicted);
+		if (ret == 1) {
+			buffer_pool->release(evicted);
+		}
+		else if (ret < 0) {
+			buffer_pool->release(img);
+			break;
+		}
 	}
+	// end of stream: grab() returns GRAB_EOS once the queue is drained
+	queue.close();
 	return NULL;
 }
 
+GrabStatus VideoDecFFM::grab(DecodedFrame& frame, int timeout_ms) {
+	bm_image img;
+	GrabStatus status = grab(img, timeout_ms);
+	if (status == GRAB_READY) {
+		frame = DecodedFrame(buffer_pool, img);
+	}
+	return status;
+}
+
+GrabStatus VideoDecFFM::grab(bm_image& img, int timeout_ms) {
+	if (!pushThread.joinable()) {
+		return GRAB_EOS;
+	}
+	return (GrabStatus)queue.pop(img, timeout_ms);
+}
+
 bm_image* VideoDecFFM::grab() {
-	std::unique_lock<std::mutex> l(lock);
-	if (queue.empty()) {
+	if (grab(grabbed, -1) != GRAB_READY) {
 		return nullptr;
 	}
-	bm_image* img = queue.front();
-	queue.pop();
-	// 调试：检查 bm_image 格式
-	bm_image_format_info_t info;
-	bm_image_get_format_info(img, &info);
-	printf("grab bm_image: width=%d, height=%d, stride=%d, format=\n",
-		info.width, info.height, info.stride[0]);
-	return img;
+	return &grabbed;
 }
 
 bm_status_t picDec(bm_handle_t& handle, const char* path, bm_image& img) {
@@ -11,6 +11,7 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
 #define USE_ASPECT_RATIO 1
 #define DUMP_FILE 0
 #define USE_MULTICLASS_NMS 1
@@ -24,6 +25,7 @@ YoloV5::YoloV5(std::shared_ptr<BMNNContext> context, bool use_cpu_opt) {
 	m_bmContext = context;
 	this->use_cpu_opt = use_cpu_opt;
 	m_bmNetwork = std::make_shared<BMNNNetwork>(m_bmContext->bmrt(), m_bmContext->network_name(0));
+	m_staging_pool = std::make_shared<BMImagePool>(m_bmContext->handle());
 	m_ts = nullptr; // ʽʼ
 	std::cout << "YoloV5 ctor .." << std::endl;
 }
@@ -67,7 +69,12 @@ int YoloV5::Init(float confThresh, float nmsThresh, const std::string& coco_name
 	assert(output_num == 1 || output_num == 3);
 	min_dim = m_bmNetwork->outputTensor(0)->get_shape()->num_dims;
 
-	//4. initialize bmimages
+	//4. post process workers, one scratch buffer each
+	int post_workers = std::min({ max_batch, 4, (int)std::max(1u, std::thread::hardware_concurrency()) });
+	m_post_pool = std::make_shared<WorkerPool>(post_workers);
+	m_post_scratch.resize(m_post_pool->size());
+
+	//5. initialize bmimages
 	m_resized_imgs.resize(max_batch);
 	m_converto_imgs.resize(max_batch);
 	// some API only accept bm_image whose stride is aligned to 64
@@ -85,7 +92,7 @@ int YoloV5::Init(float confThresh, float nmsThresh, const std::string& coco_name
 	auto ret = bm_image_create_batch(m_bmContext->handle(), m_net_h, m_net_w, FORMAT_RGB_PLANAR, img_dtype, m_converto_imgs.data(), max_batch);
 	assert(BM_SUCCESS == ret);
 
-	// 5.converto
+	// 6.converto
 	float input_scale = tensor->get_scale();
 	input_scale = input_scale * 1.0 / 255.f;
 	converto_attr.alpha_0 = input_scale;
@@ -113,6 +120,16 @@ int YoloV5::batch_size() {
 
 int YoloV5::Detect(const std::vector<bm_image>& input_images, std::vector<YoloV5BoxVec>& boxes) {
 	int ret = 0;
+	// split batches that the largest stage cannot hold
+	if ((int)input_images.size() > max_batch) {
+		for (size_t start = 0; start < input_images.size(); start += max_batch) {
+			size_t end = std::min(start + max_batch, input_images.size());
+			std::vector<bm_image> chunk(input_images.begin() + start, input_images.begin() + end);
+			ret = Detect(chunk, boxes);
+			if (ret != 0) return ret;
+		}
+		return ret;
+	}
 	//3. preprocess
 	if (m_ts) m_ts->save("yolov5 preprocess", input_images.size());
 	ret = pre_process(input_images);
@@ -144,17 +161,11 @@ int YoloV5::pre_process(const std::vector<bm_image>& images) {
 	for (int i = 0; i < image_n; ++i) {
 		bm_image image1 = images[i];
 		bm_image image_aligned;
-		bool need_copy = image1.width & (64 - 1);
+		// images decoded with 64 aligned strides go to vpp directly, others are staged
+		// through a pooled aligned copy
+		bool need_copy = !BMImagePool::is_stride_aligned(image1);
 		if (need_copy) {
-			int stride1[3], stride2[3];
-			bm_image_get_stride(image1, stride1);
-			stride2[0] = FFALIGN(stride1[0], 64);
-			stride2[1] = FFALIGN(stride1[1], 64);
-			stride2[2] = FFALIGN(stride1[2], 64);
-			bm_image_create(m_bmContext->handle(), image1.height, image1.width,
-				image1.image_format, image1.data_type, &image_aligned, stride2);
-
-			bm_image_alloc_dev_mem(image_aligned, BMCV_IMAGE_FOR_IN);
+			image_aligned = m_staging_pool->get(image1);
 			bmcv_copy_to_atrr_t copyToAttr;
 			memset(&copyToAttr, 0, sizeof(copyToAttr));
 			copyToAttr.start_x = 0;
@@ -207,19 +218,17 @@ int YoloV5::pre_process(const std::vector<bm_image>& images) {
 		std::string fname = cv::format("resized_img_%d.jpg", i);
 		cv::imwrite(fname, resized_img);
 #endif
-		if (need_copy) bm_image_destroy(image_aligned);
 	}
 
 	//2. converto
 	ret = bmcv_image_convert_to(m_bmContext->handle(), image_n, converto_attr, m_resized_imgs.data(), m_converto_imgs.data());
 	CV_Assert(ret == 0);
 
-	//3. attach to tensor
-	if (image_n != max_batch) image_n = m_bmNetwork->get_nearest_batch(image_n);
+	//3. attach to tensor, run on the smallest stage that holds image_n
+	int stage_batch = m_bmNetwork->select_stage(image_n);
 	bm_device_mem_t input_dev_mem;
-	bm_image_get_contiguous_device_mem(image_n, m_converto_imgs.data(), &input_dev_mem);
+	bm_image_get_contiguous_device_mem(stage_batch, m_converto_imgs.data(), &input_dev_mem);
 	input_tensor->set_device_mem(&input_dev_mem);
-	input_tensor->set_shape_by_dim(0, image_n);  // set real batch number
 	return 0;
 }
 
@@ -441,194 +450,146 @@ int YoloV5::post_process(const std::vector<bm_image>& images, std::vector<YoloV5
 	return 0;
 }
 
-int YoloV5::post_process_cpu_opt(const std::vector<bm_image>& images, std::vector<YoloV5BoxVec>& detected_boxes)
-{
-	YoloV5BoxVec yolobox_vec;
-	std::vector<cv::Rect> bbox_vec;
-	std::vector<std::shared_ptr<BMNNTensor>> outputTensors(output_num);
-	for (int i = 0; i < output_num; i++) {
-		outputTensors[i] = m_bmNetwork->outputTensor(i);
-	}
-
-	for (int batch_idx = 0; batch_idx < images.size(); ++batch_idx)
-	{
-		yolobox_vec.clear();
-		auto& frame = images[batch_idx];
-		int frame_width = frame.width;
-		int frame_height = frame.height;
-
-		int tx1 = 0, ty1 = 0;
-#if USE_ASPECT_RATIO
-		bool is_align_width = false;
-		float ratio = get_aspect_scaled_ratio(frame.width, frame.height, m_net_w, m_net_h, &is_align_width);
-		if (is_align_width) {
-			ty1 = (int)((m_net_h - (int)(frame_height * ratio)) / 2);
+/*
+ * Decode one anchor of one head. T is float for float outputs (scale = 1) or int8_t for
+ * int8 outputs, in which case conf_thresh is already quantized and only the cells that
+ * pass it are dequantized.
+ */
+template <typename T>
+float* YoloV5::decode_anchor(const T* ptr, int area, int feat_w, int feat_h, int nout, int out_nout,
+	float scale, float conf_thresh, float anchor_w, float anchor_h, float* dst) {
+	for (int i = 0; i < area; i++, ptr += nout) {
+		if (ptr[4] <= conf_thresh) {
+			continue;
 		}
-		else {
-			tx1 = (int)((m_net_w - (int)(frame_width * ratio)) / 2);
+		dst[0] = (sigmoid(ptr[0] * scale) * 2 - 0.5 + i % feat_w) / feat_w * m_net_w;
+		dst[1] = (sigmoid(ptr[1] * scale) * 2 - 0.5 + i / feat_w) / feat_h * m_net_h;
+		dst[2] = pow((sigmoid(ptr[2] * scale) * 2), 2) * anchor_w;
+		dst[3] = pow((sigmoid(ptr[3] * scale) * 2), 2) * anchor_h;
+		dst[4] = sigmoid(ptr[4] * scale);
+#if USE_MULTICLASS_NMS
+		for (int d = 5; d < nout; d++)
+			dst[d] = ptr[d] * scale;
+#else
+		T best = ptr[5];
+		int best_idx = 5;
+		for (int d = 6; d < nout; d++) {
+			if (ptr[d] > best) {
+				best = ptr[d];
+				best_idx = d;
+			}
 		}
+		dst[5] = best * scale;
+		dst[6] = best_idx - 5;
 #endif
+		dst += out_nout;
+	}
+	return dst;
+}
 
-		int min_idx = 0;
-		int box_num = 0;
-		for (int i = 0; i < output_num; i++) {
-			auto output_shape = m_bmNetwork->outputTensor(i)->get_shape();
-			auto output_dims = output_shape->num_dims;
-			assert(output_dims == 3 || output_dims == 5);
-			if (output_dims == 5) {
-				box_num += output_shape->dims[1] * output_shape->dims[2] * output_shape->dims[3];
-			}
+void YoloV5::post_process_image(const bm_image& frame, int batch_idx, std::vector<std::shared_ptr<BMNNTensor>>& outputTensors,
+	int min_idx, int total_box_num, int nout, PostScratch& scratch, YoloV5BoxVec& result)
+{
+	YoloV5BoxVec& yolobox_vec = scratch.boxes;
+	std::vector<float>& decoded_data = scratch.decoded_data;
+	yolobox_vec.clear();
+	int frame_width = frame.width;
+	int frame_height = frame.height;
 
-			if (min_dim > output_dims) {
-				min_idx = i;
-				min_dim = output_dims;
-			}
-		}
+	int tx1 = 0, ty1 = 0;
+#if USE_ASPECT_RATIO
+	bool is_align_width = false;
+	float ratio = get_aspect_scaled_ratio(frame.width, frame.height, m_net_w, m_net_h, &is_align_width);
+	if (is_align_width) {
+		ty1 = (int)((m_net_h - (int)(frame_height * ratio)) / 2);
+	}
+	else {
+		tx1 = (int)((m_net_w - (int)(frame_width * ratio)) / 2);
+	}
+#endif
 
-		auto out_tensor = outputTensors[min_idx];
-		int nout = out_tensor->get_shape()->dims[min_dim - 1];
-		m_class_num = nout - 5;
 #if USE_MULTICLASS_NMS
-		int out_nout = nout;
+	int out_nout = nout;
 #else
-		int out_nout = 7;
+	int out_nout = 7;
 #endif
-		float transformed_m_confThreshold = -std::log(1 / m_confThreshold - 1);
-
-		float* output_data = nullptr;
-		std::vector<float> decoded_data;
-
-		if (min_dim == 3 && output_num != 1) {
-			std::cout << "--> WARNING: the current bmodel has redundant outputs" << std::endl;
-			std::cout << "             you can remove the redundant outputs to improve performance" << std::endl;
-			std::cout << std::endl;
+	float transformed_m_confThreshold = -std::log(1 / m_confThreshold - 1);
+
+	auto out_tensor = outputTensors[min_idx];
+	int box_num = total_box_num;
+	float* output_data = nullptr;
+
+	if (min_dim == 5) {
+		// std::cout<<"--> Note: Decoding Boxes"<<std::endl;
+		// std::cout<<"          you can put the process into model during trace"<<std::endl;
+		// std::cout<<"          which can reduce post process time, but forward time increases 1ms"<<std::endl;
+		// std::cout<<std::endl;
+		const std::vector<std::vector<std::vector<int>>> anchors{
+		  {{10, 13}, {16, 30}, {33, 23}},
+			{{30, 61}, {62, 45}, {59, 119}},
+			{{116, 90}, {156, 198}, {373, 326}} };
+		const int anchor_num = anchors[0].size();
+		assert(output_num == (int)anchors.size());
+		assert(box_num > 0);
+		if ((int)decoded_data.size() != box_num * out_nout) {
+			decoded_data.resize(box_num * out_nout);
 		}
-
-		if (min_dim == 5) {
-			LOG_TS(m_ts, "post 1: get output and decode");
-			// std::cout<<"--> Note: Decoding Boxes"<<std::endl;
-			// std::cout<<"          you can put the process into model during trace"<<std::endl;
-			// std::cout<<"          which can reduce post process time, but forward time increases 1ms"<<std::endl;
-			// std::cout<<std::endl;
-			const std::vector<std::vector<std::vector<int>>> anchors{
-			  {{10, 13}, {16, 30}, {33, 23}},
-				{{30, 61}, {62, 45}, {59, 119}},
-				{{116, 90}, {156, 198}, {373, 326}} };
-			const int anchor_num = anchors[0].size();
-			assert(output_num == (int)anchors.size());
-			assert(box_num > 0);
-			if ((int)decoded_data.size() != box_num * out_nout) {
-				decoded_data.resize(box_num * out_nout);
+		float* dst = decoded_data.data();
+		for (int tidx = 0; tidx < output_num; ++tidx) {
+			auto output_tensor = outputTensors[tidx];
+			int feat_c = output_tensor->get_shape()->dims[1];
+			int feat_h = output_tensor->get_shape()->dims[2];
+			int feat_w = output_tensor->get_shape()->dims[3];
+			int area = feat_h * feat_w;
+			assert(feat_c == anchor_num);
+			int feature_size = feat_h * feat_w * nout;
+			int batch_offset = batch_idx * feat_c * area * nout;
+			if (output_tensor->get_dtype() == BM_INT8) {
+				// compare raw logits against the quantized threshold, x * scale > t <=> x > floor(t / scale)
+				float scale = output_tensor->get_scale();
+				float quant_thresh = std::floor(transformed_m_confThreshold / scale);
+				const int8_t* tensor_data = output_tensor->get_cpu_int8_data() + batch_offset;
+				for (int anchor_idx = 0; anchor_idx < anchor_num; anchor_idx++) {
+					dst = decode_anchor(tensor_data + anchor_idx * feature_size, area, feat_w, feat_h, nout, out_nout,
+						scale, quant_thresh, anchors[tidx][anchor_idx][0], anchors[tidx][anchor_idx][1], dst);
+				}
 			}
-			float* dst = decoded_data.data();
-			for (int tidx = 0; tidx < output_num; ++tidx) {
-				auto output_tensor = outputTensors[tidx];
-				int feat_c = output_tensor->get_shape()->dims[1];
-				int feat_h = output_tensor->get_shape()->dims[2];
-				int feat_w = output_tensor->get_shape()->dims[3];
-				int area = feat_h * feat_w;
-				assert(feat_c == anchor_num);
-				int feature_size = feat_h * feat_w * nout;
-				float* tensor_data = (float*)output_tensor->get_cpu_data() + batch_idx * feat_c * area * nout;
-				for (int anchor_idx = 0; anchor_idx < anchor_num; anchor_idx++)
-				{
-					float* ptr = tensor_data + anchor_idx * feature_size;
-					for (int i = 0; i < area; i++) {
-						if (ptr[4] <= transformed_m_confThreshold) {
-							ptr += nout;
-							continue;
-						}
-						dst[0] = (sigmoid(ptr[0]) * 2 - 0.5 + i % feat_w) / feat_w * m_net_w;
-						dst[1] = (sigmoid(ptr[1]) * 2 - 0.5 + i / feat_w) / feat_h * m_net_h;
-						dst[2] = pow((sigmoid(ptr[2]) * 2), 2) * anchors[tidx][anchor_idx][0];
-						dst[3] = pow((sigmoid(ptr[3]) * 2), 2) * anchors[tidx][anchor_idx][1];
-						dst[4] = sigmoid(ptr[4]);
-#if USE_MULTICLASS_NMS
-						for (int d = 5; d < nout; d++)
-							dst[d] = ptr[d];
-#else
-						dst[5] = ptr[5];
-						dst[6] = 5;
-						for (int d = 6; d < nout; d++) {
-							if (ptr[d] > dst[5]) {
-								dst[5] = ptr[d];
-								dst[6] = d;
-							}
-						}
-						dst[6] -= 5;
-#endif
-						dst += out_nout;
-						ptr += nout;
-					}
+			else {
+				const float* tensor_data = output_tensor->get_cpu_data() + batch_offset;
+				for (int anchor_idx = 0; anchor_idx < anchor_num; anchor_idx++) {
+					dst = decode_anchor(tensor_data + anchor_idx * feature_size, area, feat_w, feat_h, nout, out_nout,
+						1.f, transformed_m_confThreshold, anchors[tidx][anchor_idx][0], anchors[tidx][anchor_idx][1], dst);
 				}
 			}
-			output_data = decoded_data.data();
-			box_num = (dst - output_data) / out_nout;
-			LOG_TS(m_ts, "post 1: get output and decode");
 		}
-		else {
-			LOG_TS(m_ts, "post 1: get output");
-			assert(box_num == 0 || box_num == out_tensor->get_shape()->dims[1]);
-			box_num = out_tensor->get_shape()->dims[1];
-			output_data = (float*)out_tensor->get_cpu_data() + batch_idx * box_num * nout;
-			LOG_TS(m_ts, "post 1: get output");
-		}
-
+		output_data = decoded_data.data();
+		box_num = (dst - output_data) / out_nout;
+	}
+	else {
+		assert(box_num == 0 || box_num == out_tensor->get_shape()->dims[1]);
+		box_num = out_tensor->get_shape()->dims[1];
+		output_data = (float*)out_tensor->get_cpu_data() + batch_idx * box_num * nout;
+	}
 
-		LOG_TS(m_ts, "post 2: filter boxes");
-		int max_wh = 7680;
-		bool agnostic = false;
-		for (int i = 0; i < box_num; i++) {
-			float* ptr = output_data + i * out_nout;
-			float score = ptr[4];
-			float box_transformed_m_confThreshold = -std::log(score / m_confThreshold - 1);
-			if (min_dim != 5)
-				box_transformed_m_confThreshold = m_confThreshold / score;
+	int max_wh = 7680;
+	bool agnostic = false;
+	for (int i = 0; i < box_num; i++) {
+		float* ptr = output_data + i * out_nout;
+		float score = ptr[4];
+		float box_transformed_m_confThreshold = -std::log(score / m_confThreshold - 1);
+		if (min_dim != 5)
+			box_transformed_m_confThreshold = m_confThreshold / score;
 #if USE_MULTICLASS_NMS
-			assert(min_dim == 5);
-			float centerX = ptr[0];
-			float centerY = ptr[1];
-			float width = ptr[2];
-			float height = ptr[3];
-			for (int j = 0; j < m_class_num; j++) {
-				float confidence = ptr[5 + j];
-				int class_id = j;
-				if (confidence > box_transformed_m_confThreshold)
-				{
-					YoloV5Box box;
-					if (!agnostic)
-						box.x = centerX - width / 2 + class_id * max_wh;
-					else
-						box.x = centerX - width / 2;
-					if (box.x < 0) box.x = 0;
-					if (!agnostic)
-						box.y = centerY - height / 2 + class_id * max_wh;
-					else
-						box.y = centerY - height / 2;
-					if (box.y < 0) box.y = 0;
-					box.width = width;
-					box.height = height;
-					box.class_id = class_id;
-					box.score = sigmoid(confidence) * score;
-					yolobox_vec.push_back(box);
-				}
-			}
-#else
-			int class_id = ptr[6];
-			float confidence = ptr[5];
-			if (min_dim != 5) {
-				ptr = output_data + i * nout;
-				score = ptr[4];
-				class_id = argmax(&ptr[5], m_class_num);
-				confidence = ptr[class_id + 5];
-			}
+		assert(min_dim == 5);
+		float centerX = ptr[0];
+		float centerY = ptr[1];
+		float width = ptr[2];
+		float height = ptr[3];
+		for (int j = 0; j < m_class_num; j++) {
+			float confidence = ptr[5 + j];
+			int class_id = j;
 			if (confidence > box_transformed_m_confThreshold)
 			{
-				float centerX = ptr[0];
-				float centerY = ptr[1];
-				float width = ptr[2];
-				float height = ptr[3];
-
 				YoloV5Box box;
 				if (!agnostic)
 					box.x = centerX - width / 2 + class_id * max_wh;
@@ -643,49 +604,139 @@ int YoloV5::post_process_cpu_opt(const std::vector<bm_image>& images, std::vecto
 				box.width = width;
 				box.height = height;
 				box.class_id = class_id;
-				if (min_dim == 5)
-					confidence = sigmoid(confidence);
-				box.score = confidence * score;
+				box.score = sigmoid(confidence) * score;
 				yolobox_vec.push_back(box);
 			}
+		}
+#else
+		int class_id = ptr[6];
+		float confidence = ptr[5];
+		if (min_dim != 5) {
+			ptr = output_data + i * nout;
+			score = ptr[4];
+			class_id = argmax(&ptr[5], m_class_num);
+			confidence = ptr[class_id + 5];
+		}
+		if (confidence > box_transformed_m_confThreshold)
+		{
+			float centerX = ptr[0];
+			float centerY = ptr[1];
+			float width = ptr[2];
+			float height = ptr[3];
+
+			YoloV5Box box;
+			if (!agnostic)
+				box.x = centerX - width / 2 + class_id * max_wh;
+			else
+				box.x = centerX - width / 2;
+			if (box.x < 0) box.x = 0;
+			if (!agnostic)
+				box.y = centerY - height / 2 + class_id * max_wh;
+			else
+				box.y = centerY - height / 2;
+			if (box.y < 0) box.y = 0;
+			box.width = width;
+			box.height = height;
+			box.class_id = class_id;
+			if (min_dim == 5)
+				confidence = sigmoid(confidence);
+			box.score = confidence * score;
+			yolobox_vec.push_back(box);
+		}
 #endif
+	}
+
+	NMS(yolobox_vec, m_nmsThreshold);
+	if (!agnostic)
+		for (auto& box : yolobox_vec) {
+			box.x -= box.class_id * max_wh;
+			box.y -= box.class_id * max_wh;
+			box.x = (box.x - tx1) / ratio;
+			if (box.x < 0) box.x = 0;
+			box.y = (box.y - ty1) / ratio;
+			if (box.y < 0) box.y = 0;
+			box.width = (box.width) / ratio;
+			if (box.x + box.width >= frame_width)
+				box.width = frame_width - box.x;
+			box.height = (box.height) / ratio;
+			if (box.y + box.height >= frame_height)
+				box.height = frame_height - box.y;
 		}
-		LOG_TS(m_ts, "post 2: filter boxes");
+	else
+		for (auto& box : yolobox_vec) {
+			box.x = (box.x - tx1) / ratio;
+			if (box.x < 0) box.x = 0;
+			box.y = (box.y - ty1) / ratio;
+			if (box.y < 0) box.y = 0;
+			box.width = (box.width) / ratio;
+			if (box.x + box.width >= frame_width)
+				box.width = frame_width - box.x;
+			box.height = (box.height) / ratio;
+			if (box.y + box.height >= frame_height)
+				box.height = frame_height - box.y;
+		}
+	result.assign(yolobox_vec.begin(), yolobox_vec.end());
+}
 
-		LOG_TS(m_ts, "post 3: nms");
-		NMS(yolobox_vec, m_nmsThreshold);
-		if (!agnostic)
-			for (auto& box : yolobox_vec) {
-				box.x -= box.class_id * max_wh;
-				box.y -= box.class_id * max_wh;
-				box.x = (box.x - tx1) / ratio;
-				if (box.x < 0) box.x = 0;
-				box.y = (box.y - ty1) / ratio;
-				if (box.y < 0) box.y = 0;
-				box.width = (box.width) / ratio;
-				if (box.x + box.width >= frame_width)
-					box.width = frame_width - box.x;
-				box.height = (box.height) / ratio;
-				if (box.y + box.height >= frame_height)
-					box.height = frame_height - box.y;
-			}
-		else
-			for (auto& box : yolobox_vec) {
-				box.x = (box.x - tx1) / ratio;
-				if (box.x < 0) box.x = 0;
-				box.y = (box.y - ty1) / ratio;
-				if (box.y < 0) box.y = 0;
-				box.width = (box.width) / ratio;
-				if (box.x + box.width >= frame_width)
-					box.width = frame_width - box.x;
-				box.height = (box.height) / ratio;
-				if (box.y + box.height >= frame_height)
-					box.height = frame_height - box.y;
-			}
-		LOG_TS(m_ts, "post 3: nms");
+int YoloV5::post_process_cpu_opt(const std::vector<bm_image>& images, std::vector<YoloV5BoxVec>& detected_boxes)
+{
+	std::vector<std::shared_ptr<BMNNTensor>> outputTensors(output_num);
+	for (int i = 0; i < output_num; i++) {
+		outputTensors[i] = m_bmNetwork->outputTensor(i);
+	}
 
-		detected_boxes.push_back(yolobox_vec);
+	// the output layout is the same for every image, resolve it once per batch
+	int min_idx = 0;
+	int box_num = 0;
+	min_dim = outputTensors[0]->get_shape()->num_dims;
+	for (int i = 0; i < output_num; i++) {
+		auto output_shape = outputTensors[i]->get_shape();
+		auto output_dims = output_shape->num_dims;
+		assert(output_dims == 3 || output_dims == 5);
+		if (output_dims == 5) {
+			box_num += output_shape->dims[1] * output_shape->dims[2] * output_shape->dims[3];
+		}
+
+		if (min_dim > output_dims) {
+			min_idx = i;
+			min_dim = output_dims;
+		}
+	}
+
+	auto out_tensor = outputTensors[min_idx];
+	int nout = out_tensor->get_shape()->dims[min_dim - 1];
+	m_class_num = nout - 5;
+
+	if (min_dim == 3 && output_num != 1) {
+		std::cout << "--> WARNING: the current bmodel has redundant outputs" << std::endl;
+		std::cout << "             you can remove the redundant outputs to improve performance" << std::endl;
+		std::cout << std::endl;
+	}
+
+	// fetch host data before the workers start, the lazy fetch in BMNNTensor is not thread safe
+	LOG_TS(m_ts, "post 1: get output");
+	if (min_dim == 5) {
+		for (int i = 0; i < output_num; i++) {
+			if (outputTensors[i]->get_dtype() == BM_INT8)
+				outputTensors[i]->get_cpu_int8_data();
+			else
+				outputTensors[i]->get_cpu_data();
+		}
 	}
+	else {
+		out_tensor->get_cpu_data();
+	}
+	LOG_TS(m_ts, "post 1: get output");
+
+	// each image is decoded, filtered and NMS'd independently, one per worker
+	LOG_TS(m_ts, "post 2: decode, filter and nms");
+	size_t base = detected_boxes.size();
+	detected_boxes.resize(base + images.size());
+	m_post_pool->parallel_for(images.size(), [&](int batch_idx, int worker_id) {
+		post_process_image(images[batch_idx], batch_idx, outputTensors, min_idx, box_num, nout,
+			m_post_scratch[worker_id], detected_boxes[base + batch_idx]);
+	});
+	LOG_TS(m_ts, "post 2: decode, filter and nms");
 
 	return 0;
 }
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef HRNET_KERNELS_HPP
+#define HRNET_KERNELS_HPP
+
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+/*
+ * Host side math of HRNetPose. It lives outside the class so that tests/ can
+ * check it against the OpenCV reference chains without a device or a model.
+ */
+
+// Crop of one person: the box padded to the input aspect ratio, scaled to the input without rotation,
+// input = scale * (frame - center) + net_center. Computed once per crop and shared by the crop
+// matrices and the keypoint back-projection.
+struct CropTransform {
+	float scale_x, scale_y;    // input pixels per frame pixel
+	float center_x, center_y;  // box center in the frame
+	float net_cx, net_cy;      // input center, ((W - 1) / 2, (H - 1) / 2)
+};
+
+// Pad the box around its center to the input aspect ratio and scale it to the input. There is no
+// rotation, so the transform is input = scale * (frame - center) + net_center on each axis, the same
+// mapping cv::getAffineTransform solved from three points before.
+inline CropTransform make_crop_transform(float x, float y, float width, float height, int net_w, int net_h) {
+
+	float hw_ratio = static_cast<float>(net_h) / net_w;
+	float w = width;
+	float h = height;
+	if (h / w > hw_ratio) {
+		w = h / hw_ratio;  // pad in width direction
+	}
+	else {
+		h = w * hw_ratio;  // pad in height direction
+	}
+
+	CropTransform trans;
+	trans.center_x = x + width / 2;
+	trans.center_y = y + height / 2;
+	trans.scale_x = (net_w - 1) / w;
+	trans.scale_y = (net_h - 1) / h;
+	trans.net_cx = (net_w - 1) / 2.0f;
+	trans.net_cy = (net_h - 1) / 2.0f;
+	return trans;
+}
+
+// The 2x3 row major matrix that maps input pixels back to the frame, the inverse of the crop
+// transform, as bmcv warp affine and cv::WARP_INVERSE_MAP expect it. A mirrored matrix reads
+// column W - 1 - x for output column x, which gives the horizontally flipped crop.
+inline void crop_matrix(const CropTransform& trans, bool mirrored, int net_w, float* m) {
+
+	m[0] = 1.0f / trans.scale_x;
+	m[1] = 0.0f;
+	m[2] = trans.center_x - trans.net_cx / trans.scale_x;
+	m[3] = 0.0f;
+	m[4] = 1.0f / trans.scale_y;
+	m[5] = trans.center_y - trans.net_cy / trans.scale_y;
+	if (mirrored) {
+		m[2] += m[0] * (net_w - 1);
+		m[0] = -m[0];
+	}
+}
+
+// Host reference of the device crop: warp one person out of the frame with a matrix of crop_matrix.
+inline void crop_person_cpu(const cv::Mat& frame, const float* m, int net_w, int net_h, cv::Mat& crop) {
+
+	cv::Mat trans(2, 3, CV_32F, const_cast<float*>(m));
+	cv::warpAffine(frame, crop, trans, cv::Size(net_w, net_h), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP);
+}
+
+// Flip test post process in one pass. out receives the average of the raw output of one person
+// and the flipped output brought back to the original orientation:
+//   out[j][y][x] = 0.5 * raw[j][y][x] + 0.5 * flipped[flip_index[j]][y][x == 0 ? w - 1 : w - x]
+// which is cv::flip, the joint swap, the one column shift and cv::addWeighted of the reference chain,
+// with the same float rounding.
+// out may be raw itself.
+inline void fuse_flip_heatmaps(float* out, const float* raw, const float* flipped, const std::vector<int>& flip_index, int joints, int h, int w) {
+
+	for (int j = 0; j < joints; j++) {
+		const float* src_joint = flipped + flip_index[j] * h * w;
+		const float* raw_joint = raw + j * h * w;
+		float* dst_joint = out + j * h * w;
+		for (int y = 0; y < h; y++) {
+			const float* src = src_joint + y * w;
+			const float* org = raw_joint + y * w;
+			float* dst = dst_joint + y * w;
+			dst[0] = 0.5f * org[0] + 0.5f * src[w - 1];
+			for (int x = 1; x < w; x++) {
+				dst[x] = 0.5f * org[x] + 0.5f * src[w - x];
+			}
+		}
+	}
+}
+
+#endif
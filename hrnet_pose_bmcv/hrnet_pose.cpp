@@ -11,6 +11,8 @@
 #include <string>
 #include <cmath>
 #include <fstream> 
+#include <cstring>
+#include <chrono>
 
 #include "json.hpp"
 #include "hrnet_pose.hpp"
@@ -131,6 +133,22 @@ int HRNetPose::Init(bool flip, const string& coco_names_file) {
 	ret = bm_image_create_batch(m_bmContext->handle(), m_net_h, m_net_w, FORMAT_RGB_PLANAR, img_dtype, m_converto_imgs.data(), max_batch);
 	assert(BM_SUCCESS == ret);
 
+	auto output_shape = m_bmNetwork->outputTensor(0)->get_shape();
+	m_keypoints_num = output_shape->dims[1];
+	m_heatmap_h = output_shape->dims[2];
+	m_heatmap_w = output_shape->dims[3];
+
+	// joint j of the flipped output is read from its mirrored partner
+	int keypoints_num = m_keypoints_num;
+	m_flip_index.resize(keypoints_num);
+	for (int j = 0; j < keypoints_num; j++) {
+		m_flip_index[j] = j;
+	}
+	for (const auto& pair : FLIP_PAIRS) {
+		m_flip_index[pair[0]] = pair[1];
+		m_flip_index[pair[1]] = pair[0];
+	}
+
 	linear_trans_param_.alpha_0 = scale_[0] / 255.0;
 	linear_trans_param_.alpha_1 = scale_[1] / 255.0;
 	linear_trans_param_.alpha_2 = scale_[2] / 255.0;
@@ -179,337 +197,140 @@ vector<vector<YoloV5Box>> HRNetPose::get_person_detection_boxes(vector<vector<Yo
 }
 
 
-// Adjust bounding box to fit a fixed aspect ratio
-YoloV5Box adjust_box(YoloV5Box& box, const cv::Size& fixed_size) {
-
-	float xmin = box.x;
-	float ymin = box.y;
-	float xmax = box.x + box.width;
-	float ymax = box.y + box.height;
-	float hw_ratio = static_cast<float>(fixed_size.height) / fixed_size.width;
+void HRNetPose::make_crop_transforms(const vector<YoloV5Box>& boxes, int start, int num) {
 
-	if (box.height / box.width > hw_ratio) {
-		// Need padding in width direction
-		float wi = box.height / hw_ratio;
-		float pad_w = (wi - box.width) / 2;
-		xmin -= pad_w;
-		xmax += pad_w;
+	m_crop_trans.resize(num);
+	for (int i = 0; i < num; i++) {
+		const YoloV5Box& box = boxes[start + i];
+		m_crop_trans[i] = make_crop_transform(box.x, box.y, box.width, box.height, m_net_w, m_net_h);
 	}
-	else {
-		// Need padding in height direction
-		float hi = box.width * hw_ratio;
-		float pad_h = (hi - box.height) / 2;
-		ymin -= pad_h;
-		ymax += pad_h;
-	}
-
-	box.x = xmin;
-	box.y = ymin;
-	box.width = xmax - xmin;
-	box.height = ymax - ymin;
-
-	return box;
 }
 
-// Get affine transform matrix 
-cv::Mat get_affine_transform(YoloV5Box& box, const cv::Size& fixed_size, bool inv = true) {
-
-	YoloV5Box adjustedBox = adjust_box(box, fixed_size);
-
-	// Get the box after adjust
-	float src_xmin = adjustedBox.x;
-	float src_ymin = adjustedBox.y;
-	float src_xmax = adjustedBox.x + adjustedBox.width;
-	float src_ymax = adjustedBox.y + adjustedBox.height;
-	float src_h = adjustedBox.height;
-	float src_w = adjustedBox.width;
+// Crop matrices of the persons in m_crop_trans, appended to matrices. The mirrored ones give the
+// horizontally flipped crops without touching the host.
+void HRNetPose::get_crop_matrices(bool mirrored, vector<bmcv_affine_matrix>& matrices) {
 
-	cv::Point2f src_center((src_xmin + src_xmax) / 2, (src_ymin + src_ymax) / 2);
-	cv::Point2f src_p2(src_center.x, src_center.y - src_h / 2);
-	cv::Point2f src_p3(src_center.x + src_w / 2, src_center.y);
-
-	cv::Point2f dst_center(static_cast<float>(fixed_size.width - 1) / 2.0f, static_cast<float>(fixed_size.height - 1) / 2.0f);
-	cv::Point2f dst_p2(static_cast<float>(fixed_size.width - 1) / 2.0f, 0);
-	cv::Point2f dst_p3(fixed_size.width - 1, static_cast<float>(fixed_size.height - 1) / 2.0f);
-
-	cv::Point2f src[3] = { src_center, src_p2, src_p3 };
-	cv::Point2f dst[3] = { dst_center, dst_p2, dst_p3 };
-
-	cv::Mat trans;
-	if (inv) {
-		trans = getAffineTransform(src, dst);
-	}
-	else {
-		for (int i = 0; i < 3; i++) {
-			dst[i].x /= 4.0f;
-			dst[i].y /= 4.0f;
-		}
-		trans = getAffineTransform(dst, src);
+	for (const CropTransform& trans : m_crop_trans) {
+		bmcv_affine_matrix matrix;
+		crop_matrix(trans, mirrored, m_net_w, matrix.m);
+		matrices.push_back(matrix);
 	}
+}
+
+// Warp all crops of one frame on the device in a single call, crop i goes to m_resized_imgs[i]
+int HRNetPose::crop_persons(bm_image& src, vector<bmcv_affine_matrix>& matrices) {
 
-	return trans;
+	bmcv_affine_image_matrix image_matrix;
+	image_matrix.matrix = matrices.data();
+	image_matrix.matrix_num = matrices.size();
+	return bmcv_image_warp_affine(m_bmContext->handle(), 1, &image_matrix, &src, m_resized_imgs.data(), 1);
 }
 
-int HRNetPose::pre_process(const bm_image& image, YoloV5Box& box) {
+// Crop the persons of m_crop_trans into the input slots and attach them to the input tensor.
+// CROP_BOTH puts the mirrored crops in slots [num, 2 * num) so the flip test shares one forward.
+int HRNetPose::pre_process(const bm_image& image, CropMode mode) {
 
 	int ret = 0;
 	shared_ptr<BMNNTensor> input_tensor = m_bmNetwork->inputTensor(0);
 
+	int num = m_crop_trans.size();
+	vector<bmcv_affine_matrix> matrices;
+	matrices.reserve(mode == CROP_BOTH ? 2 * num : num);
+	get_crop_matrices(mode == CROP_MIRRORED, matrices);
+	if (mode == CROP_BOTH) {
+		get_crop_matrices(true, matrices);
+	}
+	int slot_num = matrices.size();
+	assert(slot_num <= max_batch);
+
 	bm_image src;
 	ret = bm_image_create(m_bmContext->handle(), image.height, image.width, FORMAT_RGB_PLANAR, image.data_type, &src);
 	ret = bmcv_image_vpp_convert(m_bmContext->handle(), 1, image, &src);    //RGB
 
-	cv::Mat trans = get_affine_transform(box, cv::Size(m_net_w, m_net_h));
-
-	cv::Mat mat_src;
-	cv::bmcv::toMAT(&src, mat_src);
-
-	cv::Mat mat_dst;
-	cv::Size dst_size(m_net_w, m_net_h);
-	warpAffine(mat_src, mat_dst, trans, dst_size, cv::INTER_LINEAR);
-
-	// string fname = cv::format("affine_img_opencv.jpg");
-	// cv::imwrite(fname, mat_dst);
-
-	bm_image dst;
-	ret = bm_image_create(m_bmContext->handle(), m_net_h, m_net_w, src.image_format, src.data_type, &dst);
-	ret = cv::bmcv::toBMI(mat_dst, &dst, true);
+	ret = crop_persons(src, matrices);
+	CV_Assert(ret == 0);
 	bm_image_destroy(src);
 
-	bm_image image_aligned;
-	bool need_copy = dst.width & (64 - 1);
-
-	if (need_copy) {
-		int stride1[3], stride2[3];
-
-		ret = bm_image_get_stride(dst, stride1);
-		stride2[0] = FFALIGN(stride1[0], 64);
-		stride2[1] = FFALIGN(stride1[1], 64);
-		stride2[2] = FFALIGN(stride1[2], 64);
-
-		ret = bm_image_create(m_bmContext->handle(), dst.height, dst.width, dst.image_format, dst.data_type, &image_aligned, stride2);
-		ret = bm_image_alloc_dev_mem(image_aligned, BMCV_IMAGE_FOR_IN);
-
-		bmcv_copy_to_atrr_t copyToAttr;
-		memset(&copyToAttr, 0, sizeof(copyToAttr));
-
-		copyToAttr.start_x = 0;
-		copyToAttr.start_y = 0;
-		copyToAttr.if_padding = 1;
-
-		ret = bmcv_image_copy_to(m_bmContext->handle(), copyToAttr, dst, image_aligned);
-	}
-	else {
-		image_aligned = dst;
-	}
-
-	ret = bmcv_image_vpp_convert(m_bmContext->handle(), 1, image_aligned, m_resized_imgs.data());
-
-#if DUMP_FILE
-	cv::Mat cv_image_aligned;
-	cv::bmcv::toMAT(m_resized_imgs.data(), cv_image_aligned);
-	string fname = cv::format("resized_img.jpg");
-	cv::imwrite(fname, cv_image_aligned);
-#endif
-
-	ret = bm_image_destroy(dst);
-	if (need_copy) bm_image_destroy(image_aligned);
-
-	ret = bmcv_image_convert_to(m_bmContext->handle(), 1, linear_trans_param_, m_resized_imgs.data(), m_converto_imgs.data());
+	ret = bmcv_image_convert_to(m_bmContext->handle(), slot_num, linear_trans_param_, m_resized_imgs.data(), m_converto_imgs.data());
 	CV_Assert(ret == 0);
 
+	// run on the smallest stage that holds all crops
+	int stage_batch = m_bmNetwork->select_stage(slot_num);
 	bm_device_mem_t imput_dev_mem;
-	ret = bm_image_get_contiguous_device_mem(1, m_converto_imgs.data(), &imput_dev_mem);
+	ret = bm_image_get_contiguous_device_mem(stage_batch, m_converto_imgs.data(), &imput_dev_mem);
 	input_tensor->set_device_mem(&imput_dev_mem);
-	input_tensor->set_shape_by_dim(0, 1);
 
 	return ret;
 }
 
+// Decode num persons from contiguous [num, joints, h, w] heatmaps. Every joint map is scanned once
+// for its first maximum (the same tie rule as cv::minMaxLoc), the peak is moved a quarter pixel
+// towards the higher neighbour, and the result is mapped to the frame with the person's 2x3
+// heatmap-to-image transform trans[6 * i]. Joints without a positive peak give (-1, -1) mapped
+// through the transform and a maxval of 0.
+static void decode_keypoints(const float* heatmaps, int num, int joints, int h, int w, const float* trans,
+	vector<cv::Point2f>* keypoints, vector<float>* maxvals) {
+
+	int area = h * w;
+	for (int i = 0; i < num; i++) {
+		const float* t = trans + 6 * i;
+		keypoints[i].resize(joints);
+		maxvals[i].resize(joints);
+
+		for (int j = 0; j < joints; j++) {
+			const float* hm = heatmaps + (i * joints + j) * area;
+
+			int best = 0;
+			float maxval = hm[0];
+			for (int k = 1; k < area; k++) {
+				if (hm[k] > maxval) {
+					maxval = hm[k];
+					best = k;
+				}
+			}
 
-// Function to flip images along the width axis
-cv::Mat flip_image(const cv::Mat& image) {
-
-	cv::Mat flip_image;
-	cv::flip(image, flip_image, 1);
-
-	return flip_image;
-}
-
-//Function to flip the output back according to the matched parts
-void flip_back(vector<cv::Mat>& output_flipped, const vector<vector<int>>& matched_parts) {
-
-	for (cv::Mat& mat : output_flipped) {
-		cv::flip(mat, mat, 1);
-	}
-
-	for (const auto& pair : matched_parts) {
-		cv::Mat tmp = output_flipped[pair[0]];
-		output_flipped[pair[0]] = output_flipped[pair[1]];
-		output_flipped[pair[1]] = tmp;
-	}
-}
-
-// Function to shift the output
-void shift_output(vector<cv::Mat>& flippedBackMat) {
-
-	for (cv::Mat& mat : flippedBackMat) {
-
-		int width = mat.cols;
-		for (int col = width - 1; col >= 1; col--) {
-
-			cv::Mat beforeMatCol = mat(cv::Rect(col - 1, 0, 1, mat.rows));
-			cv::Mat matCol = mat(cv::Rect(col, 0, 1, mat.rows));
-			beforeMatCol.copyTo(matCol);
-
-		}
-	}
-}
-
-vector<cv::Mat> clone_output(vector<cv::Mat>& heatMaps) {
-
-	vector<cv::Mat> newMat;
-	for (cv::Mat& mat : heatMaps) {
-		cv::Mat newmat = mat.clone();
-		newMat.emplace_back(newmat);
-	}
-
-	return newMat;
-}
-
-vector<cv::Mat> add_mat(vector<cv::Mat>& outputMat, vector<cv::Mat>& finalFlippedMat) {
-
-	if (outputMat.size() != finalFlippedMat.size()) {
-		cout << "Vector sizes do not match." << endl;
-		exit(1);
-	}
-
-	vector<cv::Mat> result;
-	for (int i = 0; i < outputMat.size(); i++) {
-
-		if (outputMat[i].size() != finalFlippedMat[i].size()) {
-			cout << "Matrices sizes do not match at index " << i << "." << endl;
-			exit(1);
-		}
-
-		cv::Mat res(outputMat[i].size(), outputMat[i].type());
-		cv::addWeighted(outputMat[i], 0.5, finalFlippedMat[i], 0.5, 0.0, res);
-		result.emplace_back(res);
-	}
-
-	return result;
-}
-
-void get_output_mat(shared_ptr<BMNNTensor>& outputTensor, vector<cv::Mat>& outputMat) {
-
-	auto output_shape = outputTensor->get_shape();
-	auto output_dims = output_shape->dims;
-	int batch_size = output_shape->dims[0];
-	int keypoints_num = output_shape->dims[1];
-	int heatmap_h = output_shape->dims[2];
-	int heatmap_w = output_shape->dims[3];
-
-	// Return an array pointer to system memory of tensor.
-	float* predict = (float*)outputTensor->get_cpu_data();
-
-	// batch_size = 1
-	for (int i = 0; i < batch_size; i++) {
-
-		for (int j = 0; j < keypoints_num; j++) {
-
-			float* start_ptr = predict + i * keypoints_num * heatmap_h * heatmap_w + j * heatmap_h * heatmap_w;
-			cv::Mat single_heatmap(heatmap_h, heatmap_w, CV_32FC1, start_ptr);
-			outputMat.emplace_back(single_heatmap);
-		}
-	}
-}
-
-void get_max_preds(vector<cv::Mat>& heatmaps, vector<cv::Point2f>& preds, vector<float>& maxvals) {
-
-	int num_joints = heatmaps.size();
-	int h = heatmaps[0].rows;
-	int w = heatmaps[0].cols;
-
-	maxvals.resize(num_joints);
-	preds.resize(num_joints);
-
-	for (int i = 0; i < num_joints; ++i) {
-
-		double minVal, maxVal;
-		cv::Point minLoc, maxLoc;
-		cv::minMaxLoc(heatmaps[i], &minVal, &maxVal, &minLoc, &maxLoc);
-
-		float x = static_cast<float>(maxLoc.x);
-		float y = static_cast<float>(maxLoc.y);
+			float x = -1.0f, y = -1.0f;
+			if (maxval > 0.0f) {
+				int px = best % w;
+				int py = best / w;
+				x = static_cast<float>(px);
+				y = static_cast<float>(py);
+				if (1 < px && px < w - 1 && 1 < py && py < h - 1) {
+					x += std::copysign(0.25f, hm[best + 1] - hm[best - 1]);
+					y += std::copysign(0.25f, hm[best + w] - hm[best - w]);
+				}
+			}
+			else {
+				maxval = 0.0f;
+			}
 
-		if (maxVal > 0.0f) {
-			preds[i] = cv::Point2f(x, y);
-			maxvals[i] = static_cast<float>(maxVal);
-		}
-		else {
-			preds[i] = cv::Point2f(-1, -1);
-			maxvals[i] = 0.0f;
+			keypoints[i][j] = cv::Point2f(t[0] * x + t[1] * y + t[2], t[3] * x + t[4] * y + t[5]);
+			maxvals[i][j] = maxval;
 		}
 	}
 }
 
-cv::Point2f affine_points(cv::Point2f& pred, const cv::Mat& trans) {
-
-	cv::Mat point(3, 1, CV_32F);
-	point.at<float>(0) = pred.x;
-	point.at<float>(1) = pred.y;
-	point.at<float>(2) = 1.0f;
-
-	cv::Mat transformed_point;
-	cv::Mat trans_32f;
-	trans.convertTo(trans_32f, CV_32F);
-
-	cv::gemm(trans_32f, point, 1.0, cv::noArray(), 0.0, transformed_point);
-
-	return cv::Point2f(transformed_point.at<float>(0, 0), transformed_point.at<float>(1, 0));
-
-}
-
-void HRNetPose::transform_preds(vector<cv::Point2f>& preds, YoloV5Box& box, vector<cv::Point2f>& keypoints) {
-
-	keypoints.resize(preds.size());
-
-	cv::Mat trans = get_affine_transform(box, cv::Size(m_net_w, m_net_h), false);
-
-	for (int i = 0; i < preds.size(); i++) {
-		keypoints[i] = affine_points(preds[i], trans);
-	}
-
-}
-
-int HRNetPose::post_process(vector<cv::Mat>& heatMaps, YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals)
+// Keypoints of the persons in m_crop_trans from their heatmaps, keypoints[i] / maxvals[i] belong to crop i.
+// A heatmap pixel is stride input pixels, so the heatmap-to-image transform is the inverse crop
+// transform with the stride folded in.
+int HRNetPose::post_process(const float* heatmaps, vector<cv::Point2f>* keypoints, vector<float>* maxvals)
 {
-	vector<cv::Point2f> preds;
-	get_max_preds(heatMaps, preds, maxvals);
-
-	int heatmap_height = heatMaps[0].rows;
-	int heatmap_width = heatMaps[0].cols;
-
-	for (int i = 0; i < heatMaps.size(); i++) {
-		cv::Point2f& pred = preds[i];
-
-		int px = static_cast<int>(floor(pred.x + 0.5));
-		int py = static_cast<int>(std::floor(pred.y + 0.5));
-
-		if (1 < px && px < heatmap_width - 1 && 1 < py && py < heatmap_height - 1) {
-
-			float dx = heatMaps[i].at<float>(py, px + 1) - heatMaps[i].at<float>(py, px - 1);
-			float dy = heatMaps[i].at<float>(py + 1, px) - heatMaps[i].at<float>(py - 1, px);
-
-			float offset_x = std::copysign(0.25f, dx);
-			float offset_y = std::copysign(0.25f, dy);
-
-			pred.x += offset_x;
-			pred.y += offset_y;
-		}
+	int num = m_crop_trans.size();
+	float stride_x = static_cast<float>(m_net_w) / m_heatmap_w;
+	float stride_y = static_cast<float>(m_net_h) / m_heatmap_h;
+	m_heatmap_trans.resize(6 * num);
+	for (int i = 0; i < num; i++) {
+		const CropTransform& trans = m_crop_trans[i];
+		float* t = m_heatmap_trans.data() + 6 * i;
+		t[0] = stride_x / trans.scale_x;
+		t[1] = 0.0f;
+		t[2] = trans.center_x - trans.net_cx / trans.scale_x;
+		t[3] = 0.0f;
+		t[4] = stride_y / trans.scale_y;
+		t[5] = trans.center_y - trans.net_cy / trans.scale_y;
 	}
 
-	transform_preds(preds, box, keypoints);
+	decode_keypoints(heatmaps, num, m_keypoints_num, m_heatmap_h, m_heatmap_w, m_heatmap_trans.data(), keypoints, maxvals);
 
 	return 0;
 }
@@ -537,77 +358,131 @@ void HRNetPose::drawPose(vector<cv::Point2f> keypoints, cv::Mat& image) {
 	}
 }
 
-int HRNetPose::poseEstimate(const bm_image& image, YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals, vector<cv::Mat>& heatMaps) {
+// Run boxes[start, start + num) through the network, m_batch_heatmaps then holds the (flip averaged)
+// [num, joints, h, w] heatmaps of these persons. Without flip test it points straight into the
+// output tensor. With flip test the mirrored crops share the forward when 2 * num fits the model,
+// otherwise they run as a second forward, and the average goes to m_heatmaps.
+// m_batch_heatmaps stays valid until the next call.
+int HRNetPose::estimate_batch(const bm_image& image, const vector<YoloV5Box>& boxes, int start, int num) {
 
 	int ret = 0;
-	m_ts->save("hrnet preprocess", 1);
-	ret = pre_process(image, box);
+	bool fused_flip = m_flip && 2 * num <= max_batch;
+	m_ts->save("hrnet preprocess", num);
+	make_crop_transforms(boxes, start, num);
+	ret = pre_process(image, fused_flip ? CROP_BOTH : CROP_ORIGINAL);
 	CV_Assert(ret == 0);
-	m_ts->save("hrnet preprocess", 1);
+	m_ts->save("hrnet preprocess", num);
 
-	m_ts->save("hrnet inference", 1);
+	m_ts->save("hrnet inference", num);
 	ret = m_bmNetwork->forward();
 	CV_Assert(ret == 0);
-	m_ts->save("hrnet inference", 1);
-
-	m_ts->save("hrnet postprocess", 1);
-	shared_ptr<BMNNTensor> outputTensor = m_bmNetwork->outputTensor(0);
-	get_output_mat(outputTensor, heatMaps);
-	m_ts->save("hrnet postprocess", 1);
-
-	shared_ptr<BMNNTensor> outputTensorFlip;
-	vector<cv::Mat> heatMapsFlip;
-	if (m_flip) {
-
-		m_ts->save("hrnet postprocess", 1);
-		heatMaps = clone_output(heatMaps);
-		m_ts->save("hrnet postprocess", 1);
-		shared_ptr<BMNNTensor> input_tensor = m_bmNetwork->inputTensor(0);
+	m_ts->save("hrnet inference", num);
+
+	m_ts->save("hrnet postprocess", num);
+	m_output_tensor = m_bmNetwork->outputTensor(0);
+	int keypoints_num = m_keypoints_num;
+	int heatmap_h = m_heatmap_h;
+	int heatmap_w = m_heatmap_w;
+	int person_size = keypoints_num * heatmap_h * heatmap_w;
+	const float* predict = m_output_tensor->get_cpu_data();
+	m_batch_heatmaps = predict;
+
+	if (!m_flip) {
+		m_ts->save("hrnet postprocess", num);
+		return ret;
+	}
 
-		m_ts->save("hrnet preprocess", 1);
-		cv::Mat cv_mat_image;
-		bm_image bm_image_to_mat = m_resized_imgs[0];
-		ret = cv::bmcv::toMAT(&bm_image_to_mat, cv_mat_image);
+	m_heatmaps.resize(num * person_size);
+	const float* raw = predict;
+	const float* flipped = predict + num * person_size;
 
-		cv::Mat flipped_image = flip_image(cv_mat_image);
-		bm_image flipped_bm_image;
-		ret = bm_image_create(m_bmContext->handle(), m_net_h, m_net_w, m_resized_imgs[0].image_format, m_resized_imgs[0].data_type, &flipped_bm_image);
-		ret = cv::bmcv::toBMI(flipped_image, &flipped_bm_image, true);
+	if (!fused_flip) {
+		// the second forward reuses the output memory, keep the originals
+		memcpy(m_heatmaps.data(), predict, num * person_size * sizeof(float));
+		raw = m_heatmaps.data();
 
-		bm_image flipped_convert_bm_image;
-		ret = bm_image_create(m_bmContext->handle(), m_net_h, m_net_w, m_converto_imgs[0].image_format, m_converto_imgs[0].data_type, &flipped_convert_bm_image);
-		ret = bmcv_image_convert_to(m_bmContext->handle(), 1, linear_trans_param_, &flipped_bm_image, &flipped_convert_bm_image);
+		m_ts->save("hrnet postprocess", num);
 
-		bm_device_mem_t input_dev_mem_;
-		ret = bm_image_get_contiguous_device_mem(1, &flipped_convert_bm_image, &input_dev_mem_);
-		input_tensor->set_device_mem(&input_dev_mem_);
-		input_tensor->set_shape_by_dim(0, 1);
-		m_ts->save("hrnet preprocess", 1);
+		m_ts->save("hrnet preprocess", num);
+		ret = pre_process(image, CROP_MIRRORED);
+		CV_Assert(ret == 0);
+		m_ts->save("hrnet preprocess", num);
 
-		m_ts->save("hrnet inference", 1);
+		m_ts->save("hrnet inference", num);
 		ret = m_bmNetwork->forward();
 		CV_Assert(ret == 0);
-		m_ts->save("hrnet inference", 1);
-
-		ret = bm_image_destroy(flipped_bm_image);
-		ret = bm_image_destroy(flipped_convert_bm_image);
+		m_ts->save("hrnet inference", num);
 
-		m_ts->save("hrnet postprocess", 1);
-		outputTensorFlip = m_bmNetwork->outputTensor(0);
-		get_output_mat(outputTensorFlip, heatMapsFlip);
-		flip_back(heatMapsFlip, FLIP_PAIRS);
-		shift_output(heatMapsFlip);
-		heatMaps = add_mat(heatMaps, heatMapsFlip);
-		m_ts->save("hrnet postprocess", 1);
+		m_ts->save("hrnet postprocess", num);
+		m_output_tensor = m_bmNetwork->outputTensor(0);
+		flipped = m_output_tensor->get_cpu_data();
+	}
 
+	for (int i = 0; i < num; i++) {
+		float* person = m_heatmaps.data() + i * person_size;
+		fuse_flip_heatmaps(person, raw + i * person_size, flipped + i * person_size, m_flip_index, keypoints_num, heatmap_h, heatmap_w);
 	}
+	m_batch_heatmaps = m_heatmaps.data();
+	m_ts->save("hrnet postprocess", num);
+
+	return ret;
+}
+
+int HRNetPose::poseEstimate(const bm_image& image, const YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals) {
+
+	int ret = 0;
+	vector<YoloV5Box> boxes = { box };
+	ret = estimate_batch(image, boxes, 0, 1);
+	CV_Assert(ret == 0);
 
 	m_ts->save("hrnet postprocess", 1);
-	ret = post_process(heatMaps, box, keypoints, maxvals);
+	ret = post_process(m_batch_heatmaps, &keypoints, &maxvals);
 	CV_Assert(ret == 0);
 	m_ts->save("hrnet postprocess", 1);
 
 	return ret;
 }
 
+int HRNetPose::poseEstimate(const bm_image& image, const YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals, vector<cv::Mat>& heatMaps) {
+
+	int ret = poseEstimate(image, box, keypoints, maxvals);
+
+	// the batch heatmaps are reused by the next call, the caller gets its own copy
+	int area = m_heatmap_h * m_heatmap_w;
+	heatMaps.clear();
+	for (int j = 0; j < m_keypoints_num; j++) {
+		float* joint = const_cast<float*>(m_batch_heatmaps) + j * area;
+		heatMaps.emplace_back(cv::Mat(m_heatmap_h, m_heatmap_w, CV_32FC1, joint).clone());
+	}
+#if DUMP_FILE
+	get_log_json(heatMaps, "heatmaps.json");
+#endif
+
+	return ret;
+}
+
+int HRNetPose::poseEstimate(const bm_image& image, const vector<YoloV5Box>& boxes, vector<vector<cv::Point2f>>& keypoints, vector<vector<float>>& maxvals) {
+
+	int ret = 0;
+	int person_num = boxes.size();
+	keypoints.resize(person_num);
+	maxvals.resize(person_num);
+
+	// persons are packed into batches of the largest stage, the last one runs on the nearest stage.
+	// With flip test each person takes two slots, the original and the mirrored crop.
+	int chunk = (m_flip && max_batch >= 2) ? max_batch / 2 : max_batch;
+	for (int start = 0; start < person_num; start += chunk) {
+		int num = std::min(chunk, person_num - start);
+		ret = estimate_batch(image, boxes, start, num);
+		CV_Assert(ret == 0);
+
+		m_ts->save("hrnet postprocess", num);
+		ret = post_process(m_batch_heatmaps, &keypoints[start], &maxvals[start]);
+		CV_Assert(ret == 0);
+		m_ts->save("hrnet postprocess", num);
+	}
+
+	return ret;
+}
+
 
@@ -17,6 +17,7 @@
 #include "utils.hpp"
 #include "bm_wrapper.hpp"
 #include "yolov5.hpp"
+#include "hrnet_kernels.hpp"
 
 using namespace std;
 
@@ -29,6 +30,12 @@ class HRNetPose {
 	vector<bm_image> m_converto_imgs;
 
 	bool m_flip = true;
+	vector<int> m_flip_index;  // mirrored partner of every joint
+	shared_ptr<BMNNTensor> m_output_tensor;  // keeps the output of the current batch mapped until it is decoded
+	const float* m_batch_heatmaps = nullptr;  // heatmaps of the current batch, in the output tensor or m_heatmaps
+	vector<float> m_heatmaps;  // flip averaged heatmaps of the current batch
+	vector<float> m_heatmap_trans;  // heatmap-to-image transform of every person in the batch, 2x3 row major
+	int m_keypoints_num, m_heatmap_h, m_heatmap_w;
 	int max_batch;
 	int m_net_h, m_net_w;
 	vector<string> m_class_names;
@@ -39,9 +46,17 @@ class HRNetPose {
 
 private:
 
-	int pre_process(const bm_image& image, YoloV5Box& box);
-	int post_process(vector<cv::Mat>& heapMaps, YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals);
-	void transform_preds(vector<cv::Point2f>& preds, YoloV5Box& box, vector<cv::Point2f>& keypoints);
+	vector<CropTransform> m_crop_trans;  // crop transform of every person in the batch
+
+	// which crops pre_process writes: originals, mirrored (flip test), or both in one batch
+	enum CropMode { CROP_ORIGINAL, CROP_MIRRORED, CROP_BOTH };
+
+	void make_crop_transforms(const vector<YoloV5Box>& boxes, int start, int num);
+	int pre_process(const bm_image& image, CropMode mode);
+	void get_crop_matrices(bool mirrored, vector<bmcv_affine_matrix>& matrices);
+	int crop_persons(bm_image& src, vector<bmcv_affine_matrix>& matrices);
+	int estimate_batch(const bm_image& image, const vector<YoloV5Box>& boxes, int start, int num);
+	int post_process(const float* heatmaps, vector<cv::Point2f>* keypoints, vector<float>* maxvals);
 
 	vector<float> mean_ = { 0.485, 0.456, 0.406 };
 	vector<float> scale_ = { 1 / 0.229, 1 / 0.224, 1 / 0.225 };
@@ -62,7 +77,14 @@ public:
 
 	void drawPose(vector<cv::Point2f> keypoints, cv::Mat& image);
 
-	int poseEstimate(const bm_image& image, YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals, vector<cv::Mat>& heatMaps);
+	// Keypoints and maxvals of one box, the heatmaps are decoded in place
+	int poseEstimate(const bm_image& image, const YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals);
+
+	// Debug variant that also copies out the (flip averaged) heatmaps of the box
+	int poseEstimate(const bm_image& image, const YoloV5Box& box, vector<cv::Point2f>& keypoints, vector<float>& maxvals, vector<cv::Mat>& heatMaps);
+
+	// Estimate all boxes of one image, batched on the network stages
+	int poseEstimate(const bm_image& image, const vector<YoloV5Box>& boxes, vector<vector<cv::Point2f>>& keypoints, vector<vector<float>>& maxvals);
 
 	vector<vector<YoloV5Box>> get_person_detection_boxes(vector<vector<YoloV5Box>>& yolov5_boxes, float person_thresh);
 
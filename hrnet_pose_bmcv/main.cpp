@@ -132,10 +132,6 @@ int main(int argc, char* argv[]) {
 
 	HRNetPose hrnet_pose(bm_pose_context);
 	hrnet_pose.Init(flip, coco_names);
-	if (hrnet_pose.get_batch_size() != 1) {
-		cout << "Only supports batch size of 1 for HRNet." << endl;
-		exit(1);
-	}
 
 	TimeStamp pose_ts;
 	TimeStamp* ts = &pose_ts;
@@ -225,8 +221,7 @@ int main(int argc, char* argv[]) {
 						{
 							vector<cv::Point2f> keypoints;
 							vector<float> maxvals;
-							vector<cv::Mat> heatMaps;
-							hrnet_pose.poseEstimate(batch_decode_images[i], person_box, keypoints, maxvals, heatMaps);
+							hrnet_pose.poseEstimate(batch_decode_images[i], person_box, keypoints, maxvals);
 
 #if DRAW_OPENCV
 							hrnet_pose.drawPose(keypoints, cv_mat_image);
@@ -260,6 +255,8 @@ int main(int argc, char* argv[]) {
 		decoder.openDec(&h, input.c_str());
 
 		int id = 0;
+		// frames go back to the decoder's buffer pool when batch_frames is cleared
+		vector<DecodedFrame> batch_frames;
 		vector<bm_image> batch_decode_images;
 		vector<YoloV5BoxVec> yolov5_boxes;
 
@@ -268,15 +265,17 @@ int main(int argc, char* argv[]) {
 		while (!end_flag) {
 
 			ts->save("decode time");
-			bm_image* image = decoder.grab();
+			DecodedFrame frame;
+			GrabStatus status = decoder.grab(frame, -1);
 			ts->save("decode time");
 
-			if (!image) {
+			if (status != GRAB_READY) {
 				end_flag = true;
 			}
 
 			else {
-				batch_decode_images.push_back(*image);
+				batch_decode_images.push_back(frame.image());
+				batch_frames.push_back(std::move(frame));
 			}
 
 			if ((batch_decode_images.size() == batch_size || end_flag) && !batch_decode_images.empty()) {
@@ -306,9 +305,7 @@ int main(int argc, char* argv[]) {
 						{
 							vector<cv::Point2f> keypoints;
 							vector<float> maxvals;
-							vector<cv::Mat> heatMaps;
-
-							hrnet_pose.poseEstimate(batch_decode_images[i], person_box, keypoints, maxvals, heatMaps);
+							hrnet_pose.poseEstimate(batch_decode_images[i], person_box, keypoints, maxvals);
 
 #if DRAW_OPENCV
 							hrnet_pose.drawPose(keypoints, cv_mat_image);
@@ -317,9 +314,9 @@ int main(int argc, char* argv[]) {
 
 						}
 					}
-					bm_image_destroy(batch_decode_images[i]);
 				}
 
+				batch_frames.clear();
 				batch_decode_images.clear();
 				yolov5_boxes.clear();
 			}
@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Counting replacements of the global operator new and delete. They replace the
+ * program's allocator, so include this in exactly one translation unit of a test.
+ */
+static std::atomic<long> g_allocations{ 0 };  // calls to operator new, never decreases
+static std::atomic<long> g_live_allocations{ 0 };
+
+void* operator new(std::size_t size) {
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	g_allocations++;
+	g_live_allocations++;
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	if (!p) return;
+	g_live_allocations--;
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	operator delete(p);
+}
+
+#endif
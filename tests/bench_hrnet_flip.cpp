@@ -0,0 +1,62 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// Time of the flip test post process per person, fused kernel against the cv::Mat chain.
+// usage: bench_hrnet_flip [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "hrnet_kernels.hpp"
+#include "flip_reference.hpp"
+
+static double elapsed_us(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+
+	int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	const int sizes[][3] = { { 17, 64, 48 }, { 17, 96, 72 } };
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	printf("%-14s %12s %12s %8s\n", "heatmaps", "chain us", "fused us", "speedup");
+	for (const auto& s : sizes) {
+		int joints = s[0], h = s[1], w = s[2];
+		int size = joints * h * w;
+		std::vector<float> raw(size), flipped(size), fused(size);
+		for (int k = 0; k < size; k++) {
+			raw[k] = value(rng);
+			flipped[k] = value(rng);
+		}
+		std::vector<int> flip_index = make_flip_index(joints);
+
+		volatile float sink = 0;  // keeps the loops from being optimized out
+		auto t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			std::vector<cv::Mat> out = reference_flip_average(raw.data(), flipped.data(), joints, h, w);
+			sink += out[i % joints].ptr<float>()[0];
+		}
+		double chain = elapsed_us(t0) / iterations;
+
+		t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			fuse_flip_heatmaps(fused.data(), raw.data(), flipped.data(), flip_index, joints, h, w);
+			sink += fused[i % size];
+		}
+		double fused_us = elapsed_us(t0) / iterations;
+
+		char name[32];
+		snprintf(name, sizeof(name), "%dx%dx%d", joints, h, w);
+		printf("%-14s %12.2f %12.2f %7.1fx\n", name, chain, fused_us, chain / fused_us);
+	}
+	return 0;
+}
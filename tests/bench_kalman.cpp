@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// Time of one frame's prediction over 10 to 1000 tracks: the per track predict on each track's
+// own mean and covariance, as multi_predict ran it before, against the batched predict over
+// KalmanStates.
+// usage: bench_kalman [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "kalmanfilter.h"
+
+static double elapsed_ns(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+
+	int frames = argc > 1 ? atoi(argv[1]) : 2000;
+	const int sizes[] = { 10, 30, 100, 300, 1000 };
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> coord(10.f, 600.f), height(20.f, 300.f);
+	printf("%6s %14s %14s %8s\n", "tracks", "scalar ns/trk", "batched ns/trk", "speedup");
+	for (int tracks : sizes) {
+		KalmanFilter kf;
+		KalmanStates& states = kf.states();
+		std::vector<KalmanFilter::Mean> means(tracks);
+		std::vector<KalmanFilter::Covariance> covariances(tracks);
+		std::vector<int> slots(tracks);
+		for (int i = 0; i < tracks; i++) {
+			kf.initiate({ coord(rng), coord(rng), 0.5f, height(rng) }, means[i], covariances[i]);
+			slots[i] = states.acquire();
+			states.store(slots[i], means[i], covariances[i]);
+		}
+		auto t0 = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < tracks; i++) {
+				kf.predict(means[i], covariances[i]);
+			}
+		}
+		double scalar = elapsed_ns(t0) / ((double)frames * tracks);
+
+		t0 = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < tracks; i++) {
+				states.mark_predict(slots[i]);
+			}
+			kf.predict(states);
+		}
+		double batched = elapsed_ns(t0) / ((double)frames * tracks);
+
+		// keep both results alive
+		KalmanFilter::Mean m;
+		KalmanFilter::Covariance c;
+		states.load(slots[0], m, c);
+		volatile float sink = m[0] + means[0][0] + c[0] + covariances[0][0];
+		(void)sink;
+
+		printf("%6d %14.1f %14.1f %7.1fx\n", tracks, scalar, batched, scalar / batched);
+	}
+	return 0;
+}
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// Time of one LapSolver call at 10x10, 100x100 and 500x500.
+//   tracking: 1 - IoU like costs, every row overlaps a few columns and the rest costs 1
+//   uniform:  every pair uniform in [0, 1), the worst case for the augmenting searches
+// The sparse solve gets the pairs below the limit, as the grid pruned association does.
+// usage: bench_lapjv [seconds per case]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "lapjv.h"
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename F>
+static double time_us(F&& run, double seconds) {
+	int calls = 0;
+	auto t0 = Clock::now();
+	double elapsed = 0;
+	do {
+		run();
+		calls++;
+		elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+	} while (elapsed < seconds);
+	return elapsed * 1e6 / calls;
+}
+
+int main(int argc, char* argv[]) {
+
+	double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+	const int sizes[] = { 10, 100, 500 };
+	const float limit = 0.8f;
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	LapSolver solver;
+	printf("%-9s %-9s %12s %12s\n", "size", "costs", "dense us", "sparse us");
+	for (int n : sizes) {
+		for (int kind = 0; kind < 2; kind++) {
+			std::vector<float> cost(n * n);
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < n; j++) {
+					if (kind == 1) {
+						cost[i * n + j] = uniform(rng);
+					}
+					else {
+						// the matching detection and a couple of neighbours overlap
+						int d = std::abs(i - j);
+						cost[i * n + j] = d == 0 ? 0.1f + 0.3f * uniform(rng) : d <= 2 && uniform(rng) < 0.5f ? 0.5f + 0.5f * uniform(rng) : 1.f;
+					}
+				}
+			}
+			// shuffle the columns so the diagonal is not handed to the solver in order
+			std::vector<int> perm(n);
+			for (int j = 0; j < n; j++) perm[j] = j;
+			std::shuffle(perm.begin(), perm.end(), rng);
+			std::vector<float> shuffled(n * n);
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < n; j++) {
+					shuffled[i * n + perm[j]] = cost[i * n + j];
+				}
+			}
+
+			std::vector<int> row_ptr(1, 0), cols;
+			std::vector<float> costs;
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < n; j++) {
+					if (shuffled[i * n + j] < limit) {
+						cols.push_back(j);
+						costs.push_back(shuffled[i * n + j]);
+					}
+				}
+				row_ptr.push_back(cols.size());
+			}
+
+			std::vector<int> rowsol(n), colsol(n);
+			double dense = time_us([&] {
+				solver.solve(shuffled.data(), n, n, limit, rowsol.data(), colsol.data());
+			}, seconds);
+			double sparse = time_us([&] {
+				solver.solve_sparse(row_ptr.data(), cols.data(), costs.data(), n, n, limit, rowsol.data(), colsol.data());
+			}, seconds);
+
+			char name[16];
+			snprintf(name, sizeof(name), "%dx%d", n, n);
+			printf("%-9s %-9s %12.1f %12.1f\n", name, kind == 0 ? "tracking" : "uniform", dense, sparse);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,209 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// TrackerService throughput over 1 to 256 streams and 1 to hardware_concurrency workers, replaying
+// recorded detection traces. Every configuration is checked against the same streams tracked one
+// after the other on the calling thread: the tracks of each stream must be the same and arrive in
+// frame order.
+//   bench_tracker_service [frames] [det.txt ...]
+// frames per stream, default 300. det.txt files are MOTChallenge detections
+// (frame,id,x,y,w,h,score,...), stream s replays file s % count. Without files each stream replays
+// one of 16 synthetic traces of 40 people entering and leaving the scene.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tracker_service.h"
+
+using Trace = std::vector<std::vector<YoloV5Box>>;
+
+static const double FRAME_RATE = 30.0;
+
+static Trace synthetic_trace(int seed, int frames) {
+
+	struct Person {
+		float x, y, vx, vy;
+		int life;
+	};
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	auto enter = [&](Person& p) {
+		p = { uniform(rng) * 1800, uniform(rng) * 1000, uniform(rng) * 6 - 3, uniform(rng) * 4 - 2,
+			20 + (int)(uniform(rng) * 200) };
+	};
+	std::vector<Person> people(40);
+	for (Person& p : people) enter(p);
+
+	Trace trace(frames);
+	for (int f = 0; f < frames; f++) {
+		for (Person& p : people) {
+			p.x += p.vx;
+			p.y += p.vy;
+			if (--p.life < 0) {
+				if (p.life < -40) enter(p);
+				continue;
+			}
+			if (uniform(rng) < 0.05f) continue;
+			YoloV5Box box;
+			box.x = p.x + uniform(rng) * 2 - 1;
+			box.y = p.y;
+			box.width = 40;
+			box.height = 90;
+			box.score = uniform(rng) < 0.2f ? 0.3f : 0.9f;
+			box.class_id = 0;
+			trace[f].push_back(box);
+		}
+	}
+	return trace;
+}
+
+// MOTChallenge det.txt, frames are 1 based. Returns an empty trace when the file cannot be read.
+static Trace load_mot_trace(const char* path, int frames) {
+
+	Trace trace;
+	std::ifstream file(path);
+	if (!file) return trace;
+	trace.resize(frames);
+	std::string line;
+	while (std::getline(file, line)) {
+		for (char& c : line) {
+			if (c == ',') c = ' ';
+		}
+		std::istringstream fields(line);
+		int frame, id;
+		float x, y, w, h, score;
+		if (!(fields >> frame >> id >> x >> y >> w >> h >> score)) continue;
+		if (frame < 1 || frame > frames) continue;
+		YoloV5Box box;
+		box.x = x;
+		box.y = y;
+		box.width = w;
+		box.height = h;
+		box.score = score;
+		box.class_id = 0;
+		trace[frame - 1].push_back(box);
+	}
+	return trace;
+}
+
+// what a stream's output is compared by
+struct StreamResult {
+	long checksum = 0;
+	int last_frame = -1;
+	int order_errors = 0;
+
+	void add(int frame, const STracks& tracks) {
+		if (frame != last_frame + 1) order_errors++;
+		last_frame = frame;
+		for (const STrack* track : tracks) {
+			checksum = checksum * 31 + track->track_id * 7919 + (long)(track->tlwh[0] * 16) + (long)(track->tlwh[1] * 16);
+		}
+	}
+};
+
+static double run_serial(const bytetrack_params& params, const std::vector<const Trace*>& traces, int frames,
+	std::vector<StreamResult>& results) {
+
+	int streams_num = (int)traces.size();
+	std::vector<std::unique_ptr<BYTETracker>> trackers;
+	for (int s = 0; s < streams_num; s++) trackers.emplace_back(new BYTETracker(params));
+	results.assign(streams_num, StreamResult());
+	STracks output;
+	auto start = std::chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++) {
+		for (int s = 0; s < streams_num; s++) {
+			output.clear();
+			trackers[s]->update(output, (*traces[s])[f], f / FRAME_RATE);
+			results[s].add(f, output);
+		}
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double run_service(const bytetrack_params& params, const std::vector<const Trace*>& traces, int frames,
+	int threads_num, std::vector<StreamResult>& results) {
+
+	int streams_num = (int)traces.size();
+	results.assign(streams_num, StreamResult());
+	// calls for one stream never overlap, so each only touches its own result
+	TrackerService service(params, streams_num, threads_num, [&](int stream_id, double timestamp, const STracks& tracks) {
+		results[stream_id].add((int)(timestamp * FRAME_RATE + 0.5), tracks);
+	});
+	auto start = std::chrono::steady_clock::now();
+	for (int f = 0; f < frames; f++) {
+		for (int s = 0; s < streams_num; s++) {
+			service.submit(s, (*traces[s])[f], f / FRAME_RATE);
+		}
+	}
+	service.wait_idle();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+
+	// the report goes through printf, keep the tracker's constructor message out of it
+	std::cout.setstate(std::ios::failbit);
+	int frames = argc > 1 ? atoi(argv[1]) : 300;
+	if (frames <= 0) frames = 300;
+
+	std::vector<Trace> recorded;
+	for (int i = 2; i < argc; i++) {
+		Trace trace = load_mot_trace(argv[i], frames);
+		if (trace.empty()) {
+			fprintf(stderr, "cannot read %s\n", argv[i]);
+			return 1;
+		}
+		recorded.push_back(std::move(trace));
+	}
+	if (recorded.empty()) {
+		for (int i = 0; i < 16; i++) recorded.push_back(synthetic_trace(100 + i, frames));
+	}
+	printf("%d frames per stream, %d %s traces\n", frames, (int)recorded.size(), argc > 2 ? "recorded" : "synthetic");
+
+	int cores = (int)std::thread::hardware_concurrency();
+	if (cores < 1) cores = 1;
+	std::vector<int> thread_counts;
+	for (int t = 1; t < cores; t *= 2) thread_counts.push_back(t);
+	thread_counts.push_back(cores);
+
+	bytetrack_params params{ 0.5f, 0.5f, 0.5f, 0.8f, (int)FRAME_RATE, 30, 10 };
+	int failures = 0;
+	printf("%8s %8s %14s %10s %8s\n", "streams", "threads", "updates/s", "vs serial", "output");
+	for (int streams_num = 1; streams_num <= 256; streams_num *= 2) {
+		std::vector<const Trace*> traces;
+		for (int s = 0; s < streams_num; s++) traces.push_back(&recorded[s % recorded.size()]);
+		double updates = (double)streams_num * frames;
+
+		std::vector<StreamResult> expected, results;
+		double serial = run_serial(params, traces, frames, expected);
+		printf("%8d %8s %14.0f %10s %8s\n", streams_num, "serial", updates / serial, "1.00x", "-");
+		for (int threads_num : thread_counts) {
+			double seconds = run_service(params, traces, frames, threads_num, results);
+			bool same = true;
+			for (int s = 0; s < streams_num; s++) {
+				if (results[s].checksum != expected[s].checksum || results[s].order_errors != 0 ||
+					results[s].last_frame != frames - 1)
+					same = false;
+			}
+			if (!same) failures++;
+			printf("%8d %8d %14.0f %9.2fx %8s\n", streams_num, threads_num, updates / seconds, serial / seconds,
+				same ? "same" : "DIFFERS");
+		}
+		fflush(stdout);
+	}
+	return failures == 0 ? 0 : 1;
+}
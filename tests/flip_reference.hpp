@@ -0,0 +1,86 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+#ifndef FLIP_REFERENCE_HPP
+#define FLIP_REFERENCE_HPP
+
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+// The flip test post process HRNetPose ran before fuse_flip_heatmaps, one cv::Mat per joint.
+
+static const std::vector<std::vector<int>> FLIP_PAIRS = {
+	{1, 2}, {3, 4}, {5, 6}, {7, 8}, {9, 10}, {11, 12}, {13, 14}, {15, 16}
+};
+
+// Flip the output back according to the matched parts
+inline void flip_back(std::vector<cv::Mat>& output_flipped, const std::vector<std::vector<int>>& matched_parts) {
+
+	for (cv::Mat& mat : output_flipped) {
+		cv::flip(mat, mat, 1);
+	}
+
+	for (const auto& pair : matched_parts) {
+		cv::Mat tmp = output_flipped[pair[0]];
+		output_flipped[pair[0]] = output_flipped[pair[1]];
+		output_flipped[pair[1]] = tmp;
+	}
+}
+
+// Shift the output one column to the right
+inline void shift_output(std::vector<cv::Mat>& flippedBackMat) {
+
+	for (cv::Mat& mat : flippedBackMat) {
+		int width = mat.cols;
+		for (int col = width - 1; col >= 1; col--) {
+			cv::Mat beforeMatCol = mat(cv::Rect(col - 1, 0, 1, mat.rows));
+			cv::Mat matCol = mat(cv::Rect(col, 0, 1, mat.rows));
+			beforeMatCol.copyTo(matCol);
+		}
+	}
+}
+
+inline std::vector<cv::Mat> add_mat(std::vector<cv::Mat>& outputMat, std::vector<cv::Mat>& finalFlippedMat) {
+
+	std::vector<cv::Mat> result;
+	for (size_t i = 0; i < outputMat.size(); i++) {
+		cv::Mat res(outputMat[i].size(), outputMat[i].type());
+		cv::addWeighted(outputMat[i], 0.5, finalFlippedMat[i], 0.5, 0.0, res);
+		result.emplace_back(res);
+	}
+	return result;
+}
+
+// The whole chain on [joints, h, w] raw and flipped heatmaps of one person
+inline std::vector<cv::Mat> reference_flip_average(const float* raw, const float* flipped, int joints, int h, int w) {
+
+	std::vector<cv::Mat> heatMaps, heatMapsFlip;
+	for (int j = 0; j < joints; j++) {
+		heatMaps.emplace_back(cv::Mat(h, w, CV_32FC1, const_cast<float*>(raw + j * h * w)).clone());
+		heatMapsFlip.emplace_back(cv::Mat(h, w, CV_32FC1, const_cast<float*>(flipped + j * h * w)).clone());
+	}
+	flip_back(heatMapsFlip, FLIP_PAIRS);
+	shift_output(heatMapsFlip);
+	return add_mat(heatMaps, heatMapsFlip);
+}
+
+// m_flip_index of HRNetPose::Init
+inline std::vector<int> make_flip_index(int joints) {
+
+	std::vector<int> flip_index(joints);
+	for (int j = 0; j < joints; j++) {
+		flip_index[j] = j;
+	}
+	for (const auto& pair : FLIP_PAIRS) {
+		flip_index[pair[0]] = pair[1];
+		flip_index[pair[1]] = pair[0];
+	}
+	return flip_index;
+}
+
+#endif
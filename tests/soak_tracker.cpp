@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// Long run of BYTETracker over a scene where people keep entering and leaving, so track ids grow
+// without bound and tracks are removed all the time. The capture clock steps back to zero every
+// CLOCK_PERIOD frames, as after a camera reconnect. Memory held by the tracker and the update time
+// must stay flat: the live heap blocks and the time per frame of the last tenth of the run are
+// compared with the second tenth (the first one is the warm up).
+//   soak_tracker [frames] [objects]    default 10000000 frames, 40 objects
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "alloc_counter.hpp"
+#include "bytetrack.h"
+
+static const long CLOCK_PERIOD = 30000;
+
+struct Person {
+	float x, y, vx, vy;
+	int life;  // frames left in the scene, negative while away
+};
+
+static long rss_kb() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.rfind("VmRSS:", 0) == 0) return atol(line.c_str() + 6);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+
+	long frames = argc > 1 ? atol(argv[1]) : 10000000;
+	int people_num = argc > 2 ? atoi(argv[2]) : 40;
+	if (frames < 10) frames = 10;
+	long report = frames / 10;
+
+	bytetrack_params params{ 0.5f, 0.5f, 0.5f, 0.8f, 30, 30, 10 };
+	BYTETracker tracker(params);
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	auto enter = [&](Person& p) {
+		p = { uniform(rng) * 1800, uniform(rng) * 1000, uniform(rng) * 6 - 3, uniform(rng) * 4 - 2,
+			20 + (int)(uniform(rng) * 200) };
+	};
+	std::vector<Person> people(people_num);
+	for (Person& p : people) enter(p);
+
+	std::vector<YoloV5Box> detections;
+	detections.reserve(people_num);
+	STracks output;
+	long live_second = 0, live_last = 0;
+	double us_second = 0, us_last = 0;
+	int max_id = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long f = 0; f < frames; f++) {
+		detections.clear();
+		for (Person& p : people) {
+			p.x += p.vx;
+			p.y += p.vy;
+			if (--p.life < 0) {
+				if (p.life < -40) enter(p);
+				continue;
+			}
+			if (uniform(rng) < 0.05f) continue;  // missed
+			YoloV5Box box;
+			box.x = p.x + uniform(rng) * 2 - 1;
+			box.y = p.y;
+			box.width = 40;
+			box.height = 90;
+			box.score = uniform(rng) < 0.2f ? 0.3f : 0.9f;
+			box.class_id = 0;
+			detections.push_back(box);
+		}
+		double timestamp = (f % CLOCK_PERIOD) / 30.0 + (uniform(rng) - 0.5f) * 0.004;
+		output.clear();
+		tracker.update(output, detections, timestamp);
+		for (const STrack* track : output) {
+			if (track->track_id > max_id) max_id = track->track_id;
+		}
+
+		if ((f + 1) % report == 0) {
+			auto now = std::chrono::steady_clock::now();
+			double us = std::chrono::duration<double, std::micro>(now - start).count() / report;
+			start = now;
+			long live = g_live_allocations;
+			printf("frame %10ld  live blocks %6ld  rss %7ld kB  %8.2f us/frame  max id %d\n", f + 1, live, rss_kb(), us, max_id);
+			fflush(stdout);
+			if ((f + 1) / report == 2) {
+				live_second = live;
+				us_second = us;
+			}
+			live_last = live;
+			us_last = us;
+		}
+	}
+
+	// a few blocks of slack for buffers that reach a new peak late in the run
+	bool memory_flat = live_last <= live_second + 16;
+	bool time_flat = us_last <= us_second * 1.5;
+	printf("live blocks %ld -> %ld: %s\n", live_second, live_last, memory_flat ? "flat" : "GROWING");
+	printf("update time %.2f -> %.2f us/frame: %s\n", us_second, us_last, time_flat ? "flat" : "GROWING");
+	bool ok = memory_flat && time_flat;
+	printf("%s\n", ok ? "PASSED" : "FAILED");
+	return ok ? 0 : 1;
+}
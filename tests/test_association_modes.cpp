@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// The sparse association modes of BYTETracker against the dense reference path.
+// - sparse, no gating: the grid only skips pairs that do not overlap, which can never match, so a
+//   tracker in this mode must output the same tracks, ids and boxes, in the same order, as a dense
+//   one on the same scene.
+// - sparse with motion gating: the only documented difference is that pairs outside the Kalman
+//   chi-square gate cannot match. Every association of a gated tracker is compared with the dense
+//   solve of the same costs where the pairs outside the gate are made unmatchable.
+// The scenes have people crossing, misses, low scores, and detections that jump, so the gate
+// actually rejects pairs.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bytetrack.h"
+
+using Handles = std::vector<int>;
+using Matches = std::vector<std::pair<int, int>>;
+
+struct BYTETrackerTestAccess {
+	BYTETracker& tracker;
+
+	STrackPool& pool() { return tracker.pool; }
+	Handles current_tracks() {
+		Handles tracks = tracker.tracked_stracks;
+		tracks.insert(tracks.end(), tracker.lost_stracks.begin(), tracker.lost_stracks.end());
+		return tracks;
+	}
+	void associate(const Handles& a, const Handles& b, float thresh, Matches& matches, std::vector<int>& unmatched_a,
+		std::vector<int>& unmatched_b) {
+		tracker.associate(a, b, thresh, matches, unmatched_a, unmatched_b);
+	}
+	void iou_distance(const Handles& a, const Handles& b, std::vector<float>& cost) { tracker.iou_distance(a, b, cost); }
+	void linear_assignment(const std::vector<float>& cost, int rows, int cols, float thresh, Matches& matches,
+		std::vector<int>& unmatched_a, std::vector<int>& unmatched_b) {
+		tracker.linear_assignment(cost, rows, cols, thresh, matches, unmatched_a, unmatched_b);
+	}
+	KalmanFilter& kalman_filter() { return tracker.kalman_filter; }
+};
+
+using Scene = std::vector<std::vector<YoloV5Box>>;
+
+static Scene make_scene(int people_num, int frames, int seed) {
+
+	struct Person {
+		float x, y, vx, vy;
+		int life;
+	};
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	// a crowded area, so paths cross and boxes overlap
+	float side = 120.f * std::sqrt((float)people_num);
+	auto enter = [&](Person& p) {
+		p = { uniform(rng) * side, uniform(rng) * side, uniform(rng) * 6 - 3, uniform(rng) * 4 - 2,
+			20 + (int)(uniform(rng) * 200) };
+	};
+	std::vector<Person> people(people_num);
+	for (Person& p : people) enter(p);
+
+	Scene scene(frames);
+	for (int f = 0; f < frames; f++) {
+		for (Person& p : people) {
+			p.x += p.vx;
+			p.y += p.vy;
+			if (--p.life < 0) {
+				if (p.life < -40) enter(p);
+				continue;
+			}
+			if (uniform(rng) < 0.05f) continue;
+			YoloV5Box box;
+			box.x = p.x + uniform(rng) * 2 - 1;
+			box.y = p.y;
+			box.width = 40;
+			box.height = 90;
+			if (uniform(rng) < 0.03f) box.x += 14;  // a detection off by a third of the width
+			box.score = uniform(rng) < 0.2f ? 0.3f : 0.9f;
+			box.class_id = 0;
+			scene[f].push_back(box);
+		}
+	}
+	return scene;
+}
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what, int people_num, int frame) {
+	if (!ok) {
+		failures++;
+		if (failures <= 20) printf("FAIL %s, %d people, frame %d\n", what, people_num, frame);
+	}
+}
+
+// dense and sparse trackers must agree on every frame
+static void compare_dense_sparse(const Scene& scene, int people_num) {
+
+	bytetrack_params dense_params{ 0.5f, 0.5f, 0.5f, 0.8f, 30, 30, 10 };
+	bytetrack_params sparse_params = dense_params;
+	sparse_params.sparse_association = true;
+	BYTETracker dense(dense_params), sparse(sparse_params);
+
+	STracks dense_out, sparse_out;
+	long tracks_num = 0;
+	for (int f = 0; f < (int)scene.size(); f++) {
+		dense_out.clear();
+		sparse_out.clear();
+		dense.update(dense_out, scene[f]);
+		sparse.update(sparse_out, scene[f]);
+		bool same = dense_out.size() == sparse_out.size();
+		for (size_t k = 0; same && k < dense_out.size(); k++) {
+			same = dense_out[k]->track_id == sparse_out[k]->track_id && dense_out[k]->tlwh == sparse_out[k]->tlwh;
+		}
+		expect(same, "sparse output differs from dense", people_num, f);
+		tracks_num += dense_out.size();
+	}
+	printf("%4d people: dense and sparse agree on %ld output tracks\n", people_num, tracks_num);
+}
+
+// every association of a gated tracker against the dense solve with the out of gate pairs removed
+static void compare_gated(const Scene& scene, int people_num) {
+
+	bytetrack_params params{ 0.5f, 0.5f, 0.5f, 0.8f, 30, 30, 10 };
+	params.sparse_association = true;
+	params.motion_gating = true;
+	BYTETracker tracker(params);
+	BYTETrackerTestAccess access{ tracker };
+	STrackPool& pool = access.pool();
+
+	long gated_pairs = 0, associations = 0;
+	STracks output;
+	std::vector<float> cost, distances;
+	std::vector<KalmanFilter::Measurement> measurements;
+	for (int f = 0; f < (int)scene.size(); f++) {
+		// the frame's detections as pooled tracks, as update() makes them
+		Handles detections;
+		for (const YoloV5Box& box : scene[f]) {
+			int h = pool.acquire();
+			STrack::Box tlbr = { { box.x, box.y, box.x + box.width, box.y + box.height } };
+			pool[h].init(STrack::tlbr_to_tlwh(tlbr), box.score, box.class_id, 0.0);
+			detections.push_back(h);
+		}
+		Handles tracks = access.current_tracks();
+
+		const float thresholds[] = { 0.8f, 0.5f };
+		for (float thresh : thresholds) {
+			Matches matches, expected_matches;
+			std::vector<int> unmatched_a, unmatched_b, expected_a, expected_b;
+			access.associate(tracks, detections, thresh, matches, unmatched_a, unmatched_b);
+
+			int rows = tracks.size(), cols = detections.size();
+			access.iou_distance(tracks, detections, cost);
+			KalmanFilter::Mean mean;
+			KalmanFilter::Covariance covariance;
+			for (int i = 0; i < rows; i++) {
+				if (cols == 0 || !pool[tracks[i]].get_kalman_state(mean, covariance)) continue;
+				measurements.resize(cols);
+				for (int j = 0; j < cols; j++) {
+					const STrack::Box& b = pool[detections[j]].tlbr;
+					float w = b[2] - b[0], h = b[3] - b[1];
+					measurements[j] = { b[0] + w / 2, b[1] + h / 2, w / h, h };
+				}
+				access.kalman_filter().gating_distance(mean, covariance, measurements, distances);
+				for (int j = 0; j < cols; j++) {
+					if (distances[j] > KalmanFilter::kGatingThreshold) {
+						if (cost[i * cols + j] < thresh) gated_pairs++;
+						cost[i * cols + j] = 1.f;
+					}
+				}
+			}
+			access.linear_assignment(cost, rows, cols, thresh, expected_matches, expected_a, expected_b);
+			expect(matches == expected_matches && unmatched_a == expected_a && unmatched_b == expected_b,
+				"gated association differs from the dense one without out of gate pairs", people_num, f);
+			associations++;
+		}
+
+		for (int h : detections) pool.release(h);
+		output.clear();
+		tracker.update(output, scene[f]);
+	}
+	printf("%4d people: %ld gated associations agree, %ld candidate pairs rejected by the gate\n", people_num,
+		associations, gated_pairs);
+	expect(gated_pairs > 0, "the scene never exercised the gate", people_num, -1);
+}
+
+int main() {
+
+	const int sizes[] = { 10, 40, 200 };
+	for (int people_num : sizes) {
+		Scene scene = make_scene(people_num, 400, people_num);
+		compare_dense_sparse(scene, people_num);
+		compare_gated(scene, people_num);
+	}
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
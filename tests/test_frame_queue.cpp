@@ -0,0 +1,193 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// FrameQueue between a producer and a consumer thread under both policies. Every item owns a heap
+// block, like a decoded image, and is released by whoever ends up with it: the consumer, the
+// producer for an evicted or refused item, or the drain after close. Checks that items come out in
+// order, none is lost or released twice, backpressure drops nothing, drop-oldest keeps the newest,
+// and close wakes a blocked side. Also worth running under -fsanitize=thread.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "frame_queue.hpp"
+
+struct Item {
+	int seq;
+	int* data;
+};
+
+static std::atomic<int> live_items{ 0 };
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+	if (!ok) {
+		failures++;
+		printf("FAIL %s\n", what);
+	}
+}
+
+static Item make_item(int seq) {
+	live_items++;
+	return Item{ seq, new int(seq) };
+}
+
+static void release_item(Item& item) {
+	expect(*item.data == item.seq, "item released intact");
+	delete item.data;
+	live_items--;
+}
+
+static const char* policy_name(FrameQueuePolicy policy) {
+	return policy == FRAME_QUEUE_DROP_OLDEST ? "drop oldest" : "backpressure";
+}
+
+// producer_us / consumer_us slow one side down, timeout_ms is passed to pop()
+static void run(FrameQueuePolicy policy, int items_num, int producer_us, int consumer_us, int timeout_ms) {
+
+	FrameQueue<Item> queue(5);
+	queue.set_policy(policy);
+	std::thread producer([&] {
+		for (int seq = 0; seq < items_num; seq++) {
+			Item item = make_item(seq);
+			Item evicted;
+			int ret = queue.push(item, evicted);
+			if (ret == 1) release_item(evicted);
+			if (ret < 0) {
+				release_item(item);
+				break;
+			}
+			if (producer_us) std::this_thread::sleep_for(std::chrono::microseconds(producer_us));
+		}
+		queue.close();
+	});
+
+	int last = -1, received = 0, timeouts = 0;
+	bool in_order = true;
+	while (true) {
+		Item item;
+		FrameQueueStatus status = queue.pop(item, timeout_ms);
+		if (status == FRAME_QUEUE_TIMEOUT) {
+			timeouts++;
+			std::this_thread::yield();
+			continue;
+		}
+		if (status == FRAME_QUEUE_CLOSED) break;
+		if (item.seq <= last) in_order = false;
+		last = item.seq;
+		received++;
+		release_item(item);
+		if (consumer_us) std::this_thread::sleep_for(std::chrono::microseconds(consumer_us));
+	}
+	producer.join();
+
+	FrameQueueStats stats = queue.stats();
+	printf("%-12s %6d items, producer %4d us, consumer %3d us, timeout %2d ms: received %6d dropped %6llu timeouts %d\n",
+		policy_name(policy), items_num, producer_us, consumer_us, timeout_ms, received,
+		(unsigned long long)stats.dropped, timeouts);
+	expect(in_order, "items in order");
+	expect(received + (int)stats.dropped == items_num, "every item received or dropped");
+	expect(stats.pushed == (uint64_t)items_num && stats.popped == (uint64_t)received, "push and pop counters");
+	expect(stats.depth == 0, "empty after close");
+	expect(live_items == 0, "every item released once");
+	if (policy == FRAME_QUEUE_BACKPRESSURE) expect(stats.dropped == 0, "backpressure drops nothing");
+}
+
+// without a consumer, drop-oldest keeps the last capacity items
+static void keeps_newest() {
+
+	FrameQueue<Item> queue(4);
+	queue.set_policy(FRAME_QUEUE_DROP_OLDEST);
+	for (int seq = 0; seq < 10; seq++) {
+		Item item = make_item(seq);
+		Item evicted;
+		int ret = queue.push(item, evicted);
+		expect(ret == (seq < 4 ? 0 : 1), "push evicts only when full");
+		if (ret == 1) {
+			expect(evicted.seq == seq - 4, "the oldest item is evicted");
+			release_item(evicted);
+		}
+	}
+	queue.close();
+	Item item;
+	int seq = 6;
+	while (queue.pop(item, 0) == FRAME_QUEUE_READY) {
+		expect(item.seq == seq++, "the newest items are kept");
+		release_item(item);
+	}
+	expect(seq == 10, "all kept items handed out after close");
+	expect(live_items == 0, "every item released once");
+	printf("drop oldest keeps the newest: %s\n", seq == 10 ? "ok" : "FAIL");
+}
+
+// close() wakes a producer blocked on a full queue, and the queued items can still be drained
+static void close_wakes_producer() {
+
+	FrameQueue<Item> queue(3);
+	Item evicted;
+	for (int seq = 0; seq < 3; seq++) {
+		Item item = make_item(seq);
+		queue.push(item, evicted);
+	}
+	int ret = 0;
+	std::thread producer([&] {
+		Item item = make_item(3);
+		ret = queue.push(item, evicted);
+		if (ret < 0) release_item(item);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	queue.close();
+	producer.join();
+
+	Item item;
+	int drained = 0;
+	while (queue.try_pop(item)) {
+		release_item(item);
+		drained++;
+	}
+	expect(ret == -1, "blocked push fails on close");
+	expect(drained == 3, "queued items drained after close");
+	expect(live_items == 0, "every item released once");
+	printf("close wakes a blocked producer: drained %d\n", drained);
+}
+
+// close() wakes a consumer waiting without a timeout
+static void close_wakes_consumer() {
+
+	FrameQueue<Item> queue(3);
+	FrameQueueStatus status = FRAME_QUEUE_READY;
+	std::thread consumer([&] {
+		Item item;
+		status = queue.pop(item, -1);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	queue.close();
+	consumer.join();
+	expect(status == FRAME_QUEUE_CLOSED, "blocked pop returns closed");
+	printf("close wakes a blocked consumer: %s\n", status == FRAME_QUEUE_CLOSED ? "ok" : "FAIL");
+}
+
+int main() {
+
+	const FrameQueuePolicy policies[] = { FRAME_QUEUE_BACKPRESSURE, FRAME_QUEUE_DROP_OLDEST };
+	for (FrameQueuePolicy policy : policies) {
+		run(policy, 200000, 0, 0, -1);  // both sides as fast as they go
+		run(policy, 2000, 0, 50, -1);   // slow consumer
+		run(policy, 2000, 0, 50, 10);
+		run(policy, 300, 2000, 0, 1);   // slow producer, the consumer times out
+		run(policy, 300, 2000, 0, 0);   // polling consumer
+	}
+	keeps_newest();
+	close_wakes_producer();
+	close_wakes_consumer();
+
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
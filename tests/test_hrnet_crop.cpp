@@ -0,0 +1,179 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// HRNet crop matrices and host crops against the get_affine_transform path they replaced:
+// the padded box solved with cv::getAffineTransform from three points, inverted for the device,
+// and the forward cv::warpAffine crop (mirrored with cv::flip).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "hrnet_kernels.hpp"
+
+struct Box {
+	float x, y, width, height;
+};
+
+static const int NET_W = 192;
+static const int NET_H = 256;
+
+// ---- reference path ----
+
+static Box adjust_box(Box box, const cv::Size& fixed_size) {
+
+	float xmin = box.x;
+	float ymin = box.y;
+	float xmax = box.x + box.width;
+	float ymax = box.y + box.height;
+	float hw_ratio = static_cast<float>(fixed_size.height) / fixed_size.width;
+
+	if (box.height / box.width > hw_ratio) {
+		float wi = box.height / hw_ratio;
+		float pad_w = (wi - box.width) / 2;
+		xmin -= pad_w;
+		xmax += pad_w;
+	}
+	else {
+		float hi = box.width * hw_ratio;
+		float pad_h = (hi - box.height) / 2;
+		ymin -= pad_h;
+		ymax += pad_h;
+	}
+
+	box.x = xmin;
+	box.y = ymin;
+	box.width = xmax - xmin;
+	box.height = ymax - ymin;
+	return box;
+}
+
+static cv::Mat get_affine_transform(const Box& box, const cv::Size& fixed_size) {
+
+	Box adjusted = adjust_box(box, fixed_size);
+	float src_xmin = adjusted.x;
+	float src_ymin = adjusted.y;
+	float src_xmax = adjusted.x + adjusted.width;
+	float src_ymax = adjusted.y + adjusted.height;
+	float src_h = adjusted.height;
+	float src_w = adjusted.width;
+
+	cv::Point2f src_center((src_xmin + src_xmax) / 2, (src_ymin + src_ymax) / 2);
+	cv::Point2f src_p2(src_center.x, src_center.y - src_h / 2);
+	cv::Point2f src_p3(src_center.x + src_w / 2, src_center.y);
+
+	cv::Point2f dst_center(static_cast<float>(fixed_size.width - 1) / 2.0f, static_cast<float>(fixed_size.height - 1) / 2.0f);
+	cv::Point2f dst_p2(static_cast<float>(fixed_size.width - 1) / 2.0f, 0);
+	cv::Point2f dst_p3(fixed_size.width - 1, static_cast<float>(fixed_size.height - 1) / 2.0f);
+
+	cv::Point2f src[3] = { src_center, src_p2, src_p3 };
+	cv::Point2f dst[3] = { dst_center, dst_p2, dst_p3 };
+	return cv::getAffineTransform(src, dst);
+}
+
+// the matrix the device path was given before the closed form
+static void reference_matrix(const Box& box, bool mirrored, float* m) {
+
+	cv::Mat trans = get_affine_transform(box, cv::Size(NET_W, NET_H));
+	cv::Mat inv_trans;
+	cv::invertAffineTransform(trans, inv_trans);
+	for (int k = 0; k < 6; k++) {
+		m[k] = static_cast<float>(inv_trans.at<double>(k / 3, k % 3));
+	}
+	if (mirrored) {
+		m[2] += m[0] * (NET_W - 1);
+		m[0] = -m[0];
+		m[5] += m[3] * (NET_W - 1);
+		m[3] = -m[3];
+	}
+}
+
+static void reference_crop(const cv::Mat& frame, const Box& box, bool mirrored, cv::Mat& crop) {
+
+	cv::Mat trans = get_affine_transform(box, cv::Size(NET_W, NET_H));
+	cv::warpAffine(frame, crop, trans, cv::Size(NET_W, NET_H), cv::INTER_LINEAR);
+	if (mirrored) {
+		cv::flip(crop, crop, 1);
+	}
+}
+
+// ---- checks ----
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what, int i) {
+	if (!ok) {
+		failures++;
+		if (failures <= 20) printf("FAIL %s, box %d\n", what, i);
+	}
+}
+
+static cv::Mat make_frame(int width, int height) {
+
+	// smooth, so the sub-pixel differences between the two paths stay within interpolation rounding
+	cv::Mat frame(height, width, CV_8UC3);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			cv::Vec3b& px = frame.at<cv::Vec3b>(y, x);
+			px[0] = cv::saturate_cast<uchar>(128 + 100 * std::sin(x / 23.0) * std::cos(y / 17.0));
+			px[1] = cv::saturate_cast<uchar>(x * 255 / width);
+			px[2] = cv::saturate_cast<uchar>(128 + 90 * std::sin((x + y) / 31.0));
+		}
+	}
+	return frame;
+}
+
+int main() {
+
+	const int boxes_num = 200;
+	cv::Mat frame = make_frame(640, 480);
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> cx(140.f, 500.f), cy(120.f, 360.f);
+	std::uniform_real_distribution<float> bw(16.f, 110.f), bh(24.f, 150.f);
+
+	double max_matrix_diff = 0, max_pixel_diff = 0;
+	for (int i = 0; i < boxes_num; i++) {
+		Box box;
+		box.width = bw(rng);
+		box.height = bh(rng);
+		box.x = cx(rng) - box.width / 2;
+		box.y = cy(rng) - box.height / 2;
+		CropTransform trans = make_crop_transform(box.x, box.y, box.width, box.height, NET_W, NET_H);
+
+		for (int mirrored = 0; mirrored < 2; mirrored++) {
+			float m[6], ref[6];
+			crop_matrix(trans, mirrored != 0, NET_W, m);
+			reference_matrix(box, mirrored != 0, ref);
+
+			// compare where the two matrices send the input corners, in frame pixels
+			double diff = 0;
+			for (int k = 0; k < 4; k++) {
+				float ix = (k & 1) ? NET_W - 1 : 0;
+				float iy = (k & 2) ? NET_H - 1 : 0;
+				diff = std::max(diff, (double)std::fabs((m[0] * ix + m[1] * iy + m[2]) - (ref[0] * ix + ref[1] * iy + ref[2])));
+				diff = std::max(diff, (double)std::fabs((m[3] * ix + m[4] * iy + m[5]) - (ref[3] * ix + ref[4] * iy + ref[5])));
+			}
+			max_matrix_diff = std::max(max_matrix_diff, diff);
+			expect(diff < 1e-2, mirrored ? "mirrored crop matrix" : "crop matrix", i);
+
+			cv::Mat crop, expected, abs_diff;
+			crop_person_cpu(frame, m, NET_W, NET_H, crop);
+			reference_crop(frame, box, mirrored != 0, expected);
+			cv::absdiff(crop, expected, abs_diff);
+			double pixel_diff = 0;
+			cv::minMaxLoc(abs_diff.reshape(1), nullptr, &pixel_diff);
+			max_pixel_diff = std::max(max_pixel_diff, pixel_diff);
+			expect(pixel_diff <= 2, mirrored ? "mirrored host crop" : "host crop", i);
+		}
+	}
+
+	printf("%d boxes: max corner diff %.5f px, max pixel diff %.0f\n", boxes_num, max_matrix_diff, max_pixel_diff);
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// fuse_flip_heatmaps against flip_back + shift_output + addWeighted on random heatmaps,
+// bit for bit, out of place and in place.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include "hrnet_kernels.hpp"
+#include "flip_reference.hpp"
+
+static int check(int joints, int h, int w, std::mt19937& rng) {
+
+	std::uniform_real_distribution<float> value(-0.05f, 1.0f);
+	int size = joints * h * w;
+	std::vector<float> raw(size), flipped(size), fused(size);
+	for (int k = 0; k < size; k++) {
+		raw[k] = value(rng);
+		flipped[k] = value(rng);
+	}
+	std::vector<int> flip_index = make_flip_index(joints);
+	std::vector<cv::Mat> expected = reference_flip_average(raw.data(), flipped.data(), joints, h, w);
+
+	fuse_flip_heatmaps(fused.data(), raw.data(), flipped.data(), flip_index, joints, h, w);
+	std::vector<float> in_place = raw;
+	fuse_flip_heatmaps(in_place.data(), in_place.data(), flipped.data(), flip_index, joints, h, w);
+
+	int mismatches = 0;
+	for (int j = 0; j < joints; j++) {
+		const float* ref = expected[j].ptr<float>();
+		if (memcmp(ref, fused.data() + j * h * w, h * w * sizeof(float)) != 0) mismatches++;
+		if (memcmp(ref, in_place.data() + j * h * w, h * w * sizeof(float)) != 0) mismatches++;
+	}
+	printf("%2d x %3d x %3d: %s\n", joints, h, w, mismatches == 0 ? "ok" : "MISMATCH");
+	return mismatches;
+}
+
+int main() {
+
+	std::mt19937 rng(2024);
+	int failures = 0;
+	// the model output, odd sizes, and a single column
+	failures += check(17, 64, 48, rng);
+	failures += check(17, 96, 72, rng);
+	failures += check(17, 7, 5, rng);
+	failures += check(17, 3, 1, rng);
+	for (int i = 0; i < 20; i++) {
+		failures += check(17, 1 + rng() % 80, 1 + rng() % 80, rng);
+	}
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// KalmanFilter against the cv::KalmanFilter(8, 4) wrapper it replaced, and the batched predict over
+// KalmanStates against the per track predict.
+// - initiate, predict, update and gating_distance follow a copy of the old cv::Mat math, on dense
+//   float matrices, over random tracks filtered for many frames with missed detections.
+// - the batched predict runs on random filtered tracks, random subsets of flagged slots and several
+//   frame intervals.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "kalmanfilter.h"
+
+static double rel_diff(float a, float b) {
+	return std::fabs((double)a - b) / (1.0 + std::fabs((double)b));
+}
+
+// ---- reference, the old wrapper's math on dense float matrices ----
+
+struct DenseMat {
+	int rows, cols;
+	std::vector<float> v;
+	DenseMat(int r, int c) : rows(r), cols(c), v(r * c, 0.f) {}
+	float& operator()(int i, int j) { return v[i * cols + j]; }
+	float operator()(int i, int j) const { return v[i * cols + j]; }
+};
+
+// products accumulate in double, as cv::gemm does for float matrices
+static DenseMat mul(const DenseMat& a, const DenseMat& b) {
+	DenseMat c(a.rows, b.cols);
+	for (int i = 0; i < a.rows; i++) {
+		for (int j = 0; j < b.cols; j++) {
+			double sum = 0;
+			for (int k = 0; k < a.cols; k++) sum += (double)a(i, k) * b(k, j);
+			c(i, j) = (float)sum;
+		}
+	}
+	return c;
+}
+
+static DenseMat transpose(const DenseMat& a) {
+	DenseMat c(a.cols, a.rows);
+	for (int i = 0; i < a.rows; i++)
+		for (int j = 0; j < a.cols; j++) c(j, i) = a(i, j);
+	return c;
+}
+
+static DenseMat add(const DenseMat& a, const DenseMat& b, float sign = 1.f) {
+	DenseMat c = a;
+	for (size_t i = 0; i < c.v.size(); i++) c.v[i] += sign * b.v[i];
+	return c;
+}
+
+// a^-1 b by Gaussian elimination with partial pivoting, in place of cv::solve on a well conditioned a
+static DenseMat solve(const DenseMat& a, const DenseMat& b) {
+	int n = a.rows, m = b.cols;
+	std::vector<double> x(n * (n + m));
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) x[i * (n + m) + j] = a(i, j);
+		for (int j = 0; j < m; j++) x[i * (n + m) + n + j] = b(i, j);
+	}
+	for (int c = 0; c < n; c++) {
+		int pivot = c;
+		for (int r = c + 1; r < n; r++)
+			if (std::fabs(x[r * (n + m) + c]) > std::fabs(x[pivot * (n + m) + c])) pivot = r;
+		for (int j = 0; j < n + m; j++) std::swap(x[c * (n + m) + j], x[pivot * (n + m) + j]);
+		for (int r = 0; r < n; r++) {
+			if (r == c) continue;
+			double f = x[r * (n + m) + c] / x[c * (n + m) + c];
+			for (int j = c; j < n + m; j++) x[r * (n + m) + j] -= f * x[c * (n + m) + j];
+		}
+	}
+	DenseMat c(n, m);
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < m; j++) c(i, j) = (float)(x[i * (n + m) + n + j] / x[i * (n + m) + i]);
+	return c;
+}
+
+static DenseMat eye(int n) {
+	DenseMat c(n, n);
+	for (int i = 0; i < n; i++) c(i, i) = 1.f;
+	return c;
+}
+
+// KalmanFilter as it was, the mean a 1x8 row, cv::KalmanFilter::predict and correct written out
+struct ReferenceKalman {
+	float _std_weight_position = 1.f / 20;
+	float _std_weight_velocity = 1.f / 160;
+	DenseMat transitionMatrix = DenseMat(8, 8);
+	DenseMat measurementMatrix = DenseMat(4, 8);
+
+	ReferenceKalman() {
+		for (int i = 0; i < 8; i++) transitionMatrix(i, i) = 1.f;
+		for (int i = 0; i < 4; i++) {
+			transitionMatrix(i, i + 4) = 1.f;
+			measurementMatrix(i, i) = 1.f;
+		}
+	}
+
+	void initiate(const DenseMat& measurement, DenseMat& mean, DenseMat& var) const {
+		mean = DenseMat(1, 8);
+		for (int i = 0; i < 4; i++) mean(0, i) = measurement(0, i);
+		float h = measurement(0, 3);
+		float std_dev[8] = {
+			2 * _std_weight_position * h, 2 * _std_weight_position * h, 1e-2f, 2 * _std_weight_position * h,
+			10 * _std_weight_velocity * h, 10 * _std_weight_velocity * h, 1e-5f, 10 * _std_weight_velocity * h };
+		var = DenseMat(8, 8);
+		for (int i = 0; i < 8; i++) var(i, i) = std_dev[i] * std_dev[i];
+	}
+
+	void predict(DenseMat& mean, DenseMat& covariance) const {
+		float std_pos = _std_weight_position * mean(0, 3) * _std_weight_position * mean(0, 3);
+		float std_vel = _std_weight_velocity * mean(0, 3) * _std_weight_velocity * mean(0, 3);
+		const float q[8] = { std_pos, std_pos, 1e-4f, std_pos, std_vel, std_vel, 1e-10f, std_vel };
+		DenseMat processNoiseCov(8, 8);
+		for (int i = 0; i < 8; i++) processNoiseCov(i, i) = q[i];
+
+		DenseMat statePre = mul(transitionMatrix, transpose(mean));
+		DenseMat errorCovPre = add(mul(mul(transitionMatrix, covariance), transpose(transitionMatrix)), processNoiseCov);
+		mean = transpose(statePre);
+		covariance = errorCovPre;
+	}
+
+	void update(DenseMat& mean, DenseMat& covariance, const DenseMat& measurement) const {
+		float std_pos = _std_weight_position * mean(0, 3) * _std_weight_position * mean(0, 3);
+		const float r[4] = { std_pos, std_pos, 1e-2f, std_pos };
+		DenseMat measurementNoiseCov(4, 4);
+		for (int i = 0; i < 4; i++) measurementNoiseCov(i, i) = r[i];
+
+		DenseMat temp2 = mul(measurementMatrix, covariance);
+		DenseMat temp3 = add(mul(temp2, transpose(measurementMatrix)), measurementNoiseCov);
+		DenseMat gain = transpose(solve(temp3, temp2));
+		DenseMat innovation = add(transpose(measurement), mul(measurementMatrix, transpose(mean)), -1.f);
+		mean = transpose(add(transpose(mean), mul(gain, innovation)));
+		covariance = add(covariance, mul(gain, temp2), -1.f);
+	}
+
+	// The old code took factor.inv(cv::DECOMP_CHOLESKY) of the upper factor, which is the plain
+	// inverse only for a diagonal factor. H P H^T is diagonal for every state initiate, predict and
+	// update produce, each coordinate only correlates with its own velocity, so the plain inverse
+	// stands for it here.
+	std::vector<float> gating_distance(const DenseMat& mean, const DenseMat& covariance,
+		const std::vector<DenseMat>& measurements) const {
+		const float std_dev[4] = { _std_weight_position * mean(0, 3), _std_weight_position * mean(0, 3), 1e-1f,
+			_std_weight_position * mean(0, 3) };
+		DenseMat mean1 = mul(measurementMatrix, transpose(mean));
+		DenseMat covariance1 = mul(mul(measurementMatrix, covariance), transpose(measurementMatrix));
+		for (int i = 0; i < 4; i++) covariance1(i, i) += std_dev[i] * std_dev[i];
+
+		DenseMat d(measurements.size(), 4);
+		for (int m = 0; m < d.rows; m++)
+			for (int i = 0; i < 4; i++) d(m, i) = measurements[m](0, i) - mean1(i, 0);
+
+		// Cholesky(): the lower factor, transposed
+		DenseMat factor(4, 4);
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j <= i; j++) {
+				double s = covariance1(i, j);
+				for (int k = 0; k < j; k++) s -= (double)factor(k, i) * factor(k, j);
+				factor(j, i) = (float)(i == j ? std::sqrt(s) : s / factor(j, j));
+			}
+		}
+		DenseMat z = mul(solve(factor, eye(4)), transpose(d));
+		std::vector<float> square_maha(z.cols, 0.f);
+		for (int m = 0; m < z.cols; m++)
+			for (int i = 0; i < 4; i++) square_maha[m] += z(i, m) * z(i, m);
+		return square_maha;
+	}
+};
+
+static DenseMat row(const float* values, int n) {
+	DenseMat c(1, n);
+	for (int i = 0; i < n; i++) c(0, i) = values[i];
+	return c;
+}
+
+// compares, then carries the reference on from the new state so that rounding does not add up
+// over the frames
+static double max_rel_diff(const KalmanFilter::Mean& mean, const KalmanFilter::Covariance& covariance,
+	DenseMat& ref_mean, DenseMat& ref_covariance) {
+	double diff = 0;
+	for (int i = 0; i < 8; i++) diff = std::max(diff, rel_diff(mean[i], ref_mean(0, i)));
+	for (int i = 0; i < 64; i++) diff = std::max(diff, rel_diff(covariance[i], ref_covariance.v[i]));
+	ref_mean = row(mean.data(), 8);
+	ref_covariance.v.assign(covariance.begin(), covariance.end());
+	return diff;
+}
+
+// tracks followed for a while by both filters, with misses, starting from the same measurement
+static int check_reference(int tracks, int frames, std::mt19937& rng) {
+
+	std::uniform_real_distribution<float> coord(10.f, 600.f), height(20.f, 300.f), ratio(0.3f, 0.8f);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f), noise(-1.f, 1.f);
+	KalmanFilter kf;
+	ReferenceKalman ref;
+
+	double max_diff = 0, max_gating_diff = 0;
+	std::vector<KalmanFilter::Measurement> measurements;
+	std::vector<DenseMat> ref_measurements;
+	std::vector<float> distances;
+	for (int t = 0; t < tracks; t++) {
+		float truth[4] = { coord(rng), coord(rng), ratio(rng), height(rng) };
+		const float velocity[4] = { noise(rng) * 5, noise(rng) * 3, noise(rng) * 1e-3f, noise(rng) };
+
+		KalmanFilter::Measurement z = { truth[0], truth[1], truth[2], truth[3] };
+		KalmanFilter::Mean mean;
+		KalmanFilter::Covariance covariance;
+		DenseMat ref_mean(1, 8), ref_covariance(8, 8);
+		kf.initiate(z, mean, covariance);
+		ref.initiate(row(z.data(), 4), ref_mean, ref_covariance);
+		max_diff = std::max(max_diff, max_rel_diff(mean, covariance, ref_mean, ref_covariance));
+
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < 4; i++) truth[i] += velocity[i];
+			kf.predict(mean, covariance);
+			ref.predict(ref_mean, ref_covariance);
+			max_diff = std::max(max_diff, max_rel_diff(mean, covariance, ref_mean, ref_covariance));
+
+			// candidates around the track, near and far
+			measurements.resize(8);
+			ref_measurements.clear();
+			for (KalmanFilter::Measurement& m : measurements) {
+				float spread = uniform(rng) < 0.5f ? 2.f : 40.f;
+				m = { truth[0] + noise(rng) * spread, truth[1] + noise(rng) * spread, truth[2] + noise(rng) * 0.02f,
+					truth[3] + noise(rng) * spread };
+				ref_measurements.push_back(row(m.data(), 4));
+			}
+			kf.gating_distance(mean, covariance, measurements, distances);
+			std::vector<float> ref_distances = ref.gating_distance(ref_mean, ref_covariance, ref_measurements);
+			for (size_t m = 0; m < distances.size(); m++) {
+				max_gating_diff = std::max(max_gating_diff, rel_diff(distances[m], ref_distances[m]));
+			}
+
+			if (uniform(rng) < 0.2f) continue;  // missed
+			z = { truth[0] + noise(rng), truth[1] + noise(rng), truth[2], truth[3] + noise(rng) };
+			kf.update(mean, covariance, z);
+			ref.update(ref_mean, ref_covariance, row(z.data(), 4));
+			max_diff = std::max(max_diff, max_rel_diff(mean, covariance, ref_mean, ref_covariance));
+		}
+	}
+
+	bool ok = max_diff < 1e-5 && max_gating_diff < 1e-5;
+	printf("%4d tracks over %d frames: max rel diff to the old math %.3g, gating %.3g: %s\n", tracks, frames, max_diff,
+		max_gating_diff, ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+// ---- batched predict ----
+
+static int check(int tracks, std::mt19937& rng) {
+
+	std::uniform_real_distribution<float> coord(10.f, 600.f), height(20.f, 300.f), noise(-4.f, 4.f);
+	std::uniform_real_distribution<float> ratio(0.3f, 0.8f);
+	KalmanFilter kf;
+	KalmanStates& states = kf.states();
+
+	std::vector<int> slots(tracks);
+	std::vector<KalmanFilter::Mean> means(tracks);
+	std::vector<KalmanFilter::Covariance> covariances(tracks);
+	for (int i = 0; i < tracks; i++) {
+		KalmanFilter::Measurement z = { coord(rng), coord(rng), ratio(rng), height(rng) };
+		kf.initiate(z, means[i], covariances[i]);
+		// a few filter steps so that the covariance is dense
+		for (int s = 0; s < 3; s++) {
+			kf.predict(means[i], covariances[i]);
+			KalmanFilter::Measurement zz = { means[i][0] + noise(rng), means[i][1] + noise(rng), means[i][2], means[i][3] + noise(rng) };
+			kf.update(means[i], covariances[i], zz);
+		}
+		slots[i] = states.acquire();
+		states.store(slots[i], means[i], covariances[i]);
+		// the reference keeps the symmetrized covariance the states hold
+		states.load(slots[i], means[i], covariances[i]);
+	}
+
+	const float dts[] = { 1.f, 0.5f, 2.f, 3.25f };
+	double max_diff = 0;
+	int unflagged_changed = 0;
+	for (float dt : dts) {
+		std::vector<char> flagged(tracks);
+		for (int i = 0; i < tracks; i++) {
+			flagged[i] = rng() % 4 != 0;
+			if (flagged[i]) {
+				states.mark_predict(slots[i]);
+				kf.predict(means[i], covariances[i], dt);
+			}
+		}
+		kf.predict(states, dt);
+
+		for (int i = 0; i < tracks; i++) {
+			KalmanFilter::Mean m;
+			KalmanFilter::Covariance c;
+			states.load(slots[i], m, c);
+			for (int k = 0; k < 8; k++) {
+				if (!flagged[i] && m[k] != means[i][k]) unflagged_changed++;
+				max_diff = std::max(max_diff, rel_diff(m[k], means[i][k]));
+			}
+			for (int k = 0; k < 64; k++) {
+				// the scalar path leaves P F^T F P asymmetric by rounding, compare with its symmetric part
+				float expected = 0.5f * (covariances[i][k] + covariances[i][(k % 8) * 8 + k / 8]);
+				if (!flagged[i] && c[k] != covariances[i][k]) unflagged_changed++;
+				max_diff = std::max(max_diff, rel_diff(c[k], expected));
+			}
+			// carry on from the batched result so that rounding does not add up over the rounds
+			means[i] = m;
+			covariances[i] = c;
+		}
+	}
+
+	bool ok = max_diff < 1e-5 && unflagged_changed == 0;
+	printf("%4d tracks: max rel diff %.3g, unflagged values changed %d: %s\n", tracks, max_diff, unflagged_changed, ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+int main() {
+
+	std::mt19937 rng(99);
+	int failures = 0;
+	failures += check_reference(200, 100, rng);
+	const int sizes[] = { 1, 7, 64, 65, 300, 1000 };
+	for (int tracks : sizes) {
+		failures += check(tracks, rng);
+	}
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// LapSolver against an exhaustive search on small random dense and sparse problems, and dense
+// against sparse on larger ones. Both solvers are run on one instance so that reused buffers
+// are covered as well.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "lapjv.h"
+
+static int failures = 0;
+
+static void fail(const char* what, int n_rows, int n_cols) {
+	failures++;
+	if (failures <= 20) printf("FAIL %s, %d x %d\n", what, n_rows, n_cols);
+}
+
+// Minimum of sum(cost - limit) over matched pairs, pairs at or above the limit and pairs that
+// are not allowed excluded. Dynamic programming over the set of used columns.
+static double best_objective(const std::vector<float>& cost, const std::vector<char>& allowed,
+	int n_rows, int n_cols, float limit) {
+
+	const double inf = 1e30;
+	std::vector<double> best(1 << n_cols, inf), next(1 << n_cols);
+	best[0] = 0;
+	for (int i = 0; i < n_rows; i++) {
+		next = best;  // row i unmatched
+		for (int mask = 0; mask < (1 << n_cols); mask++) {
+			if (best[mask] >= inf) continue;
+			for (int j = 0; j < n_cols; j++) {
+				float c = cost[i * n_cols + j];
+				if ((mask >> j & 1) || !allowed[i * n_cols + j] || !(c < limit)) continue;
+				double v = best[mask] + (c - limit);
+				if (v < next[mask | 1 << j]) next[mask | 1 << j] = v;
+			}
+		}
+		best.swap(next);
+	}
+	return *std::min_element(best.begin(), best.end());
+}
+
+// checks that the solution is a matching of allowed pairs below the limit and returns its objective
+static double objective(const std::vector<float>& cost, const std::vector<char>& allowed, int n_rows, int n_cols,
+	float limit, const std::vector<int>& rowsol, const std::vector<int>& colsol, const char* what) {
+
+	double total = 0;
+	int matched = 0;
+	for (int i = 0; i < n_rows; i++) {
+		int j = rowsol[i];
+		if (j < 0) continue;
+		if (j >= n_cols || colsol[j] != i) fail(what, n_rows, n_cols);
+		else if (!allowed[i * n_cols + j] || !(cost[i * n_cols + j] < limit)) fail(what, n_rows, n_cols);
+		else total += cost[i * n_cols + j] - limit;
+		matched++;
+	}
+	for (int j = 0; j < n_cols; j++) {
+		if (colsol[j] >= 0) matched--;
+	}
+	if (matched != 0) fail(what, n_rows, n_cols);
+	return total;
+}
+
+// CSR of the allowed pairs, in a random order within each row
+static void to_sparse(const std::vector<float>& cost, const std::vector<char>& allowed, int n_rows, int n_cols,
+	std::mt19937& rng, std::vector<int>& row_ptr, std::vector<int>& cols, std::vector<float>& costs) {
+
+	row_ptr.assign(1, 0);
+	cols.clear();
+	costs.clear();
+	std::vector<int> js;
+	for (int i = 0; i < n_rows; i++) {
+		js.clear();
+		for (int j = 0; j < n_cols; j++) {
+			if (allowed[i * n_cols + j]) js.push_back(j);
+		}
+		std::shuffle(js.begin(), js.end(), rng);
+		for (int j : js) {
+			cols.push_back(j);
+			costs.push_back(cost[i * n_cols + j]);
+		}
+		row_ptr.push_back(cols.size());
+	}
+}
+
+// costs like the tracker's 1 - IoU: many pairs at 1, ties, and values right at the limit
+static void random_problem(std::mt19937& rng, int n_rows, int n_cols, float limit, float density,
+	std::vector<float>& cost, std::vector<char>& allowed) {
+
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	cost.resize(n_rows * n_cols);
+	allowed.resize(n_rows * n_cols);
+	for (int k = 0; k < n_rows * n_cols; k++) {
+		float r = uniform(rng);
+		cost[k] = r < 0.25f ? 1.f : r < 0.3f ? 0.5f : r < 0.33f ? limit : std::round(uniform(rng) * 1000) / 1000;
+		allowed[k] = uniform(rng) < density;
+	}
+}
+
+int main() {
+
+	std::mt19937 rng(41);
+	LapSolver solver;
+	std::vector<float> cost, costs;
+	std::vector<char> allowed, all;
+	std::vector<int> row_ptr, cols;
+	const float limits[] = { 0.3f, 0.5f, 0.8f };
+
+	// small problems against the exhaustive optimum
+	int small = 0;
+	for (int t = 0; t < 5000; t++) {
+		int n_rows = rng() % 9, n_cols = rng() % 9;
+		float limit = limits[rng() % 3];
+		float density = (rng() % 2) ? 1.f : 0.4f;
+		random_problem(rng, n_rows, n_cols, limit, density, cost, allowed);
+		all.assign(n_rows * n_cols, 1);
+		std::vector<int> rowsol(n_rows), colsol(n_cols);
+
+		double best = best_objective(cost, all, n_rows, n_cols, limit);
+		if (solver.solve(cost.data(), n_rows, n_cols, limit, rowsol.data(), colsol.data()) != 0) {
+			fail("dense solve returned an error", n_rows, n_cols);
+			continue;
+		}
+		if (std::fabs(objective(cost, all, n_rows, n_cols, limit, rowsol, colsol, "dense matching") - best) > 1e-5) {
+			fail("dense objective", n_rows, n_cols);
+		}
+
+		double best_sparse = best_objective(cost, allowed, n_rows, n_cols, limit);
+		to_sparse(cost, allowed, n_rows, n_cols, rng, row_ptr, cols, costs);
+		if (solver.solve_sparse(row_ptr.data(), cols.data(), costs.data(), n_rows, n_cols, limit, rowsol.data(), colsol.data()) != 0) {
+			fail("sparse solve returned an error", n_rows, n_cols);
+			continue;
+		}
+		if (std::fabs(objective(cost, allowed, n_rows, n_cols, limit, rowsol, colsol, "sparse matching") - best_sparse) > 1e-5) {
+			fail("sparse objective", n_rows, n_cols);
+		}
+		small++;
+	}
+
+	// larger problems, dense against sparse with every pair stored
+	int large = 0;
+	for (int t = 0; t < 200; t++) {
+		int n_rows = 1 + rng() % 120, n_cols = 1 + rng() % 120;
+		float limit = limits[rng() % 3];
+		random_problem(rng, n_rows, n_cols, limit, 1.f, cost, allowed);
+		std::vector<int> rowsol(n_rows), colsol(n_cols), rowsol2(n_rows), colsol2(n_cols);
+		solver.solve(cost.data(), n_rows, n_cols, limit, rowsol.data(), colsol.data());
+		to_sparse(cost, allowed, n_rows, n_cols, rng, row_ptr, cols, costs);
+		solver.solve_sparse(row_ptr.data(), cols.data(), costs.data(), n_rows, n_cols, limit, rowsol2.data(), colsol2.data());
+		double dense = objective(cost, allowed, n_rows, n_cols, limit, rowsol, colsol, "large dense matching");
+		double sparse = objective(cost, allowed, n_rows, n_cols, limit, rowsol2, colsol2, "large sparse matching");
+		if (std::fabs(dense - sparse) > 1e-4) fail("dense and sparse objectives differ", n_rows, n_cols);
+		large++;
+	}
+
+	printf("%d small problems against the exhaustive optimum, %d large dense against sparse\n", small, large);
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
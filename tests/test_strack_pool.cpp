@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// STrackPool and the Kalman state slots under a counting allocator: the pool grows in chunks
+// without moving tracks, and once it has grown, recycling tracks allocates nothing.
+
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include "alloc_counter.hpp"
+#include "strack.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what, long value) {
+	printf("%-58s %8ld  %s\n", what, value, ok ? "ok" : "FAIL");
+	if (!ok) failures++;
+}
+
+int main() {
+
+	const int peak = 200;  // live tracks, a bit over three chunks
+	KalmanFilter kf;
+	STrackPool pool;
+	std::vector<int> handles;
+	std::vector<const STrack*> addresses;
+	handles.reserve(peak);
+	addresses.reserve(peak);
+
+	// growth: a few allocations per chunk, not one per track, and tracks do not move
+	long before = g_allocations;
+	for (int i = 0; i < peak; i++) {
+		int h = pool.acquire();
+		pool[h].init(STrack::Box{ { 10.f * i, 20.f, 40.f, 90.f } }, 0.9f, 0, 0.0);
+		pool[h].activate(kf, 1, i + 1);
+		handles.push_back(h);
+		addresses.push_back(&pool[h]);
+	}
+	long growth = g_allocations - before;
+	expect(growth <= 40, "allocations while growing to 200 tracks", growth);
+	int moved = 0;
+	for (int i = 0; i < peak; i++) {
+		if (&pool[handles[i]] != addresses[i]) moved++;
+	}
+	expect(moved == 0, "tracks moved while the pool grew", moved);
+
+	// recycling: released handles come back before the pool grows
+	std::set<int> first(handles.begin(), handles.end());
+	for (int h : handles) {
+		pool.release(h);
+	}
+	handles.clear();
+	before = g_allocations;
+	for (int i = 0; i < peak; i++) {
+		int h = pool.acquire();
+		pool[h].init(STrack::Box{ { 5.f * i, 30.f, 50.f, 100.f } }, 0.8f, 0, 1.0);
+		pool[h].activate(kf, 2, peak + i + 1);
+		handles.push_back(h);
+	}
+	expect(g_allocations == before, "allocations reacquiring 200 released tracks", g_allocations - before);
+	long outside = 0;
+	for (int h : handles) {
+		outside += first.count(h) == 0;
+	}
+	expect(outside == 0, "handles outside the first 200", outside);
+	expect(pool.capacity() == 256, "pool capacity", pool.capacity());
+
+	// churn: tracks come and go at random under the peak, with their Kalman states
+	std::mt19937 rng(44);
+	before = g_allocations;
+	long live_before = g_live_allocations;
+	for (int round = 0; round < 100000; round++) {
+		if (!handles.empty() && (handles.size() == peak || rng() % 2)) {
+			size_t k = rng() % handles.size();
+			pool[handles[k]].mark_removed();
+			pool.release(handles[k]);
+			handles[k] = handles.back();
+			handles.pop_back();
+		}
+		else {
+			int h = pool.acquire();
+			pool[h].init(STrack::Box{ { (float)(rng() % 1000), (float)(rng() % 600), 40.f, 90.f } }, 0.7f, 0, round * 0.04);
+			pool[h].activate(kf, round + 3, round + 1000);
+			handles.push_back(h);
+		}
+	}
+	expect(g_allocations == before, "allocations over 100000 acquire / release rounds", g_allocations - before);
+	expect(g_live_allocations == live_before, "live allocations changed over the churn", g_live_allocations - live_before);
+	expect(pool.capacity() == 256, "pool capacity after the churn", pool.capacity());
+
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// BYTETracker's track list set operations against the std::map / std::find versions they replaced,
+// copied below as the reference. Random lists of pooled tracks go through both, which must give the
+// same tracks in the same order: joint_stracks (also with the result aliasing the first list, as
+// update() calls it), sub_stracks, and remove_duplicate_stracks in the dense and the sparse mode.
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+#include "bytetrack.h"
+
+using Handles = std::vector<int>;
+
+struct BYTETrackerTestAccess {
+	BYTETracker& tracker;
+
+	STrackPool& pool() { return tracker.pool; }
+	void set_sparse(bool sparse) { tracker.sparse_association = sparse; }
+	void joint_stracks(Handles& a, Handles& b, Handles& results) { tracker.joint_stracks(a, b, results); }
+	void sub_stracks(Handles& a, Handles& b) { tracker.sub_stracks(a, b); }
+	void remove_duplicate_stracks(Handles& resa, Handles& resb, Handles& a, Handles& b) {
+		tracker.remove_duplicate_stracks(resa, resb, a, b);
+	}
+	void iou_distance(const Handles& a, const Handles& b, std::vector<float>& cost) { tracker.iou_distance(a, b, cost); }
+};
+
+// ---- reference, the versions keyed by track id ----
+
+static void reference_joint_stracks(const STrackPool& pool, Handles& tlista, Handles& tlistb, Handles& results) {
+
+	std::map<int, int> exists;
+	for (int i = 0; i < results.size(); i++)
+		exists.insert(std::pair<int, int>(pool[results[i]].track_id, 1));
+
+	for (int i = 0; i < tlista.size(); i++) {
+		int tid = pool[tlista[i]].track_id;
+		if (!exists[tid] || exists.count(tid) == 0) {
+			exists[tid] = 1;
+			results.push_back(tlista[i]);
+		}
+	}
+	for (int i = 0; i < tlistb.size(); i++) {
+		int tid = pool[tlistb[i]].track_id;
+		if (!exists[tid] || exists.count(tid) == 0) {
+			exists[tid] = 1;
+			results.push_back(tlistb[i]);
+		}
+	}
+}
+
+static void reference_sub_stracks(const STrackPool& pool, Handles& tlista, Handles& tlistb) {
+
+	std::map<int, int> stracks;
+	for (int i = 0; i < tlista.size(); i++)
+		stracks.insert(std::pair<int, int>(pool[tlista[i]].track_id, tlista[i]));
+	for (int i = 0; i < tlistb.size(); i++) {
+		int tid = pool[tlistb[i]].track_id;
+		if (stracks.count(tid) != 0) stracks.erase(tid);
+	}
+	tlista.clear();
+	for (std::map<int, int>::iterator it = stracks.begin(); it != stracks.end(); ++it)
+		tlista.push_back(it->second);
+}
+
+static void reference_remove_duplicate_stracks(BYTETrackerTestAccess& access, Handles& resa, Handles& resb,
+	Handles& stracksa, Handles& stracksb) {
+
+	const STrackPool& pool = access.pool();
+	std::vector<float> dists;
+	access.iou_distance(stracksa, stracksb, dists);
+	int n_cols = stracksb.size();
+	std::vector<std::pair<int, int>> pairs;
+	for (int i = 0; i < stracksa.size(); i++) {
+		for (int j = 0; j < n_cols; j++) {
+			if (dists[i * n_cols + j] < 0.15) {
+				pairs.push_back(std::pair<int, int>(i, j));
+			}
+		}
+	}
+
+	std::vector<int> dupa, dupb;
+	for (int i = 0; i < pairs.size(); i++) {
+		const STrack& p = pool[stracksa[pairs[i].first]];
+		const STrack& q = pool[stracksb[pairs[i].second]];
+		int timep = p.frame_id - p.start_frame;
+		int timeq = q.frame_id - q.start_frame;
+		if (timep > timeq)
+			dupb.push_back(pairs[i].second);
+		else
+			dupa.push_back(pairs[i].first);
+	}
+
+	for (int i = 0; i < stracksa.size(); i++) {
+		std::vector<int>::iterator iter = find(dupa.begin(), dupa.end(), i);
+		if (iter == dupa.end()) {
+			resa.push_back(stracksa[i]);
+		}
+	}
+	for (int i = 0; i < stracksb.size(); i++) {
+		std::vector<int>::iterator iter = find(dupb.begin(), dupb.end(), i);
+		if (iter == dupb.end()) {
+			resb.push_back(stracksb[i]);
+		}
+	}
+}
+
+// ---- checks ----
+
+static int failures = 0;
+
+static void expect_same(const Handles& got, const Handles& expected, const char* what, int round) {
+	if (got != expected) {
+		failures++;
+		if (failures <= 20) printf("FAIL %s, round %d: %d tracks, expected %d\n", what, round, (int)got.size(), (int)expected.size());
+	}
+}
+
+int main() {
+
+	bytetrack_params params{ 0.5f, 0.5f, 0.5f, 0.8f, 30, 30, 10 };
+	BYTETracker tracker(params);
+	BYTETrackerTestAccess access{ tracker };
+	STrackPool& pool = access.pool();
+	std::mt19937 rng(2024);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+	// tracks on a few spots with a pixel of jitter, so that duplicate pairs are common; ids are a
+	// permutation so that id order and handle order differ
+	const int tracks_num = 300;
+	Handles handles(tracks_num);
+	std::vector<int> ids(tracks_num);
+	for (int i = 0; i < tracks_num; i++) ids[i] = i + 1;
+	std::shuffle(ids.begin(), ids.end(), rng);
+	for (int i = 0; i < tracks_num; i++) {
+		int h = pool.acquire();
+		int spot = rng() % 40;
+		STrack::Box tlwh = { { (spot % 8) * 200 + uniform(rng) * 2, (spot / 8) * 200 + uniform(rng) * 2, 40, 90 } };
+		pool[h].init(tlwh, 0.9f, 0, 0.0);
+		pool[h].track_id = ids[i];
+		pool[h].start_frame = rng() % 50;
+		pool[h].frame_id = pool[h].start_frame + rng() % 50;
+		handles[i] = h;
+	}
+
+	// a random list of distinct tracks in random order
+	auto random_list = [&]() {
+		Handles list = handles;
+		std::shuffle(list.begin(), list.end(), rng);
+		list.resize(rng() % 80);
+		return list;
+	};
+
+	const int rounds = 3000;
+	for (int round = 0; round < rounds; round++) {
+		Handles a = random_list(), b = random_list(), r = random_list();
+
+		Handles got = r, expected = r;
+		access.joint_stracks(a, b, got);
+		reference_joint_stracks(pool, a, b, expected);
+		expect_same(got, expected, "joint_stracks", round);
+
+		got = a;
+		expected = a;
+		access.joint_stracks(got, b, got);
+		reference_joint_stracks(pool, expected, b, expected);
+		expect_same(got, expected, "joint_stracks into its first list", round);
+
+		got = a;
+		expected = a;
+		access.sub_stracks(got, b);
+		reference_sub_stracks(pool, expected, b);
+		expect_same(got, expected, "sub_stracks", round);
+
+		Handles ref_resa, ref_resb;
+		reference_remove_duplicate_stracks(access, ref_resa, ref_resb, a, b);
+		for (int sparse = 0; sparse < 2; sparse++) {
+			access.set_sparse(sparse != 0);
+			Handles resa, resb;
+			access.remove_duplicate_stracks(resa, resb, a, b);
+			expect_same(resa, ref_resa, sparse ? "remove_duplicate_stracks a, sparse" : "remove_duplicate_stracks a", round);
+			expect_same(resb, ref_resb, sparse ? "remove_duplicate_stracks b, sparse" : "remove_duplicate_stracks b", round);
+		}
+		access.set_sparse(false);
+	}
+
+	printf("%d rounds of joint, sub and duplicate removal over %d tracks\n", rounds, tracks_num);
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (C) 2022 Sophgo Technologies Inc.  All rights reserved.
+//
+// SOPHON-DEMO is licensed under the 2-Clause BSD License except for the
+// third-party components.
+//
+//===----------------------------------------------------------------------===//
+
+// BYTETracker::update under a counting allocator: the steady state allocates nothing.
+// A recorded scene of objects wandering with missed detections and score changes, so tracks are
+// created, lost, recovered and removed all the time, ends with empty frames until every track has
+// been removed and aged out. Replaying it then repeats the same list sizes, so once one pass has
+// grown every buffer to its peak, further passes must not allocate at all, in the dense and in the
+// sparse gated association mode.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "alloc_counter.hpp"
+#include "bytetrack.h"
+
+using Scene = std::vector<std::vector<YoloV5Box>>;
+
+struct Object {
+	float x, y, vx, vy;
+};
+
+static Scene make_scene(int objects_num, int frames, int empty_frames) {
+
+	std::mt19937 rng(objects_num);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	std::vector<Object> objects(objects_num);
+	for (Object& o : objects) {
+		o = { uniform(rng) * 1800, uniform(rng) * 1000, uniform(rng) * 6 - 3, uniform(rng) * 4 - 2 };
+	}
+
+	// the tracker confirms tracks of its very first frame at once, which a replay would not, so the
+	// scene starts with an empty frame
+	Scene scene(1 + frames + empty_frames);
+	for (int f = 1; f <= frames; f++) {
+		for (Object& o : objects) {
+			o.x += o.vx;
+			o.y += o.vy;
+			if (o.x < 0 || o.x > 1800) o.vx = -o.vx;
+			if (o.y < 0 || o.y > 1000) o.vy = -o.vy;
+			if (uniform(rng) < 0.05f) continue;  // missed
+			YoloV5Box box;
+			box.x = o.x + uniform(rng) * 2 - 1;
+			box.y = o.y;
+			box.width = 40;
+			box.height = 90;
+			box.score = uniform(rng) < 0.2f ? 0.3f : 0.9f;  // some only match in the second pass
+			box.class_id = 0;
+			scene[f].push_back(box);
+		}
+	}
+	return scene;
+}
+
+static int run(const Scene& scene, int objects_num, bool sparse) {
+
+	bytetrack_params params{ 0.5f, 0.5f, 0.5f, 0.8f, 30, 30, 10 };
+	params.sparse_association = sparse;
+	params.motion_gating = sparse;
+	BYTETracker tracker(params);
+	STracks output;
+
+	const int passes = 3;
+	long warm = 0;
+	for (int pass = 0; pass < passes; pass++) {
+		if (pass == 1) warm = g_allocations;
+		for (const std::vector<YoloV5Box>& detections : scene) {
+			output.clear();
+			tracker.update(output, detections);
+		}
+	}
+	long steady = g_allocations - warm;
+	bool ok = steady == 0;
+	printf("%4d objects, %-6s: %ld allocations over %d replayed frames: %s\n", objects_num, sparse ? "sparse" : "dense",
+		steady, (passes - 1) * (int)scene.size(), ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+int main() {
+
+	int failures = 0;
+	const int sizes[] = { 10, 100, 300 };
+	for (int n : sizes) {
+		// 100 empty frames are well past max_time_lost twice, lost then removed
+		Scene scene = make_scene(n, 1000, 100);
+		failures += run(scene, n, false);
+		failures += run(scene, n, true);
+	}
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
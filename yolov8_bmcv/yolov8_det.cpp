@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 #define USE_ASPECT_RATIO 1
 #define DUMP_FILE 0
 #define USE_MULTICLASS_NMS 1
@@ -22,8 +23,17 @@ const std::vector<std::vector<int>> colors = {
 	{255, 170, 255}, {255, 255, 255}, {170, 255, 255}, {85, 255, 255} };
 
 int YoloV8_det::Detect(const std::vector<bm_image>& input_images, std::vector<YoloV8BoxVec>& boxes) {
-	assert(input_images.size() <= batch_size);
 	int ret = 0;
+	// split batches that the largest stage cannot hold
+	if ((int)input_images.size() > batch_size) {
+		for (size_t start = 0; start < input_images.size(); start += batch_size) {
+			size_t end = std::min(start + batch_size, input_images.size());
+			std::vector<bm_image> chunk(input_images.begin() + start, input_images.begin() + end);
+			ret = Detect(chunk, boxes);
+			assert(ret == 0);
+		}
+		return ret;
+	}
 	bm_tensor_t input_tensor;
 	std::vector<bm_tensor_t> output_tensors;
 	output_tensors.resize(netinfo->output_num);
@@ -61,20 +71,29 @@ float YoloV8_det::get_aspect_scaled_ratio(int src_w, int src_h, int dst_w, int d
 	return ratio;
 }
 
-int YoloV8_det::pre_process(const std::vector<bm_image>& images,
-	bm_tensor_t& input_tensor,
-	std::vector<std::pair<int, int>>& txy_batch,
-	std::vector<std::pair<float, float>>& ratios_batch) {
-	int ret = 0;
-	std::vector<bm_image> m_resized_imgs;
-	std::vector<bm_image> m_converto_imgs;
+// Smallest stage whose batch can hold real_batch, the largest stage otherwise.
+int YoloV8_det::get_stage_index(int real_batch) {
+	int stage_idx = -1;
+	int max_idx = 0;
+	for (int s = 0; s < netinfo->stage_num; s++) {
+		int batch = netinfo->stages[s].input_shapes[0].dims[0];
+		if (batch > netinfo->stages[max_idx].input_shapes[0].dims[0]) {
+			max_idx = s;
+		}
+		if (batch >= real_batch && (stage_idx < 0 || batch < netinfo->stages[stage_idx].input_shapes[0].dims[0])) {
+			stage_idx = s;
+		}
+	}
+	return stage_idx < 0 ? max_idx : stage_idx;
+}
+
+void YoloV8_det::init_buffers() {
 	m_resized_imgs.resize(batch_size);
 	m_converto_imgs.resize(batch_size);
 
-	//create bm_images
 	int aligned_net_w = FFALIGN(m_net_w, 64);
 	int strides[3] = { aligned_net_w, aligned_net_w, aligned_net_w };
-	ret = bm_image_create_batch(handle, m_net_h, m_net_w, FORMAT_RGB_PLANAR, DATA_TYPE_EXT_1N_BYTE, m_resized_imgs.data(), batch_size, strides);
+	auto ret = bm_image_create_batch(handle, m_net_h, m_net_w, FORMAT_RGB_PLANAR, DATA_TYPE_EXT_1N_BYTE, m_resized_imgs.data(), batch_size, strides);
 	assert(BM_SUCCESS == ret);
 
 	bm_image_data_format_ext img_dtype = DATA_TYPE_EXT_FLOAT32;
@@ -84,25 +103,35 @@ int YoloV8_det::pre_process(const std::vector<bm_image>& images,
 	else if (netinfo->input_dtypes[0] == BM_UINT8) {
 		img_dtype = DATA_TYPE_EXT_1N_BYTE;
 	}
-	ret = bm_image_create_batch(handle, m_net_h, m_net_w, FORMAT_RGB_PLANAR, img_dtype, m_converto_imgs.data(), batch_size, NULL, -1, false);
+	// contiguous, so the first n images can be used as the input tensor directly
+	ret = bm_image_create_batch(handle, m_net_h, m_net_w, FORMAT_RGB_PLANAR, img_dtype, m_converto_imgs.data(), batch_size);
 	assert(BM_SUCCESS == ret);
 
+	m_staging_pool.reset(new BMImagePool(handle));
+
+	int post_workers = std::min({ batch_size, 4, (int)std::max(1u, std::thread::hardware_concurrency()) });
+	m_post_pool.reset(new WorkerPool(post_workers));
+	m_post_scratch.resize(m_post_pool->size());
+}
+
+int YoloV8_det::pre_process(const std::vector<bm_image>& images,
+	bm_tensor_t& input_tensor,
+	std::vector<std::pair<int, int>>& txy_batch,
+	std::vector<std::pair<float, float>>& ratios_batch) {
+	int ret = 0;
+	int stage_idx = get_stage_index(images.size());
+	int stage_batch = netinfo->stages[stage_idx].input_shapes[0].dims[0];
+
 	int image_n = images.size();
 	// 1. resize image letterbox
 	for (int i = 0; i < image_n; ++i) {
 		bm_image image1 = images[i];
 		bm_image image_aligned;
-		bool need_copy = image1.width & (64 - 1);
+		// images decoded with 64 aligned strides go to vpp directly, others are staged
+		// through a pooled aligned copy
+		bool need_copy = !BMImagePool::is_stride_aligned(image1);
 		if (need_copy) {
-			int stride1[3], stride2[3];
-			bm_image_get_stride(image1, stride1);
-			stride2[0] = FFALIGN(stride1[0], 64);
-			stride2[1] = FFALIGN(stride1[1], 64);
-			stride2[2] = FFALIGN(stride1[2], 64);
-			bm_image_create(handle, image1.height, image1.width, image1.image_format, image1.data_type,
-				&image_aligned, stride2);
-
-			bm_image_alloc_dev_mem(image_aligned, BMCV_IMAGE_FOR_IN);
+			image_aligned = m_staging_pool->get(image1);
 			bmcv_copy_to_atrr_t copyToAttr;
 			memset(&copyToAttr, 0, sizeof(copyToAttr));
 			copyToAttr.start_x = 0;
@@ -152,28 +181,18 @@ int YoloV8_det::pre_process(const std::vector<bm_image>& images,
 		ratios_batch.push_back(std::make_pair((float)m_net_w / images[i].width, (float)m_net_h / images[i].height));
 #endif
 		assert(BM_SUCCESS == ret);
-		if (need_copy)
-			bm_image_destroy(image_aligned);
 	}
 
-	// create tensor for converto_img to attach
-	ret = bmrt_tensor(&input_tensor, bmrt, netinfo->input_dtypes[0], netinfo->stages[0].input_shapes[0]);
-	assert(true == ret);
-	bm_image_attach_contiguous_mem(batch_size, m_converto_imgs.data(), input_tensor.device_mem);
-
 	// 2. converto img /= 255
 	ret = bmcv_image_convert_to(handle, image_n, converto_attr, m_resized_imgs.data(),
 		m_converto_imgs.data());
 	assert(ret == 0);
 
-	// destroy bm_images
-	bm_image_destroy_batch(m_resized_imgs.data(), batch_size);
-#if BMCV_VERSION_MAJOR > 1
-	bm_image_detach_contiguous_mem(batch_size, m_converto_imgs.data());
-#else
-	bm_image_dettach_contiguous_mem(batch_size, m_converto_imgs.data());
-#endif
-	bm_image_destroy_batch(m_converto_imgs.data(), batch_size, false);
+	// 3. the first stage_batch converto images back the input tensor
+	input_tensor.dtype = netinfo->input_dtypes[0];
+	input_tensor.shape = netinfo->stages[stage_idx].input_shapes[0];
+	input_tensor.st_mode = BM_STORE_1N;
+	bm_image_get_contiguous_device_mem(stage_batch, m_converto_imgs.data(), &input_tensor.device_mem);
 
 	return 0;
 }
@@ -190,7 +209,6 @@ int YoloV8_det::forward(bm_tensor_t& input_tensor, std::vector<bm_tensor_t>& out
 	assert(ok == true);
 	auto ret = bm_thread_sync(handle);
 	assert(BM_SUCCESS == ret);
-	bm_free_device(handle, input_tensor.device_mem);
 	return 0;
 }
 
@@ -297,6 +315,99 @@ float* YoloV8_det::get_cpu_data(bm_tensor_t* tensor, float scale) {
 	return pFP32;
 }
 
+/**
+ * @name    get_cpu_int8_data
+ * @brief   get raw int8 data of tensor, without dequantizing it.
+ *
+ * @param   [in]           tensor   int8 tensor.
+ * @retval  int8_t*        mapped device memory in soc mode, a host copy in pcie mode.
+ */
+int8_t* YoloV8_det::get_cpu_int8_data(bm_tensor_t* tensor) {
+	assert(BM_INT8 == tensor->dtype);
+	int ret = 0;
+	int8_t* pI8 = NULL;
+	if (misc_info.pcie_soc_mode == 1) { //soc
+		unsigned long long addr;
+		ret = bm_mem_mmap_device_mem(handle, &tensor->device_mem, &addr);
+		assert(BM_SUCCESS == ret);
+		ret = bm_mem_invalidate_device_mem(handle, &tensor->device_mem);
+		assert(BM_SUCCESS == ret);
+		pI8 = (int8_t*)addr;
+	}
+	else { //pcie
+		int tensor_size = bmrt_tensor_bytesize(tensor);
+		pI8 = new int8_t[tensor_size];
+		ret = bm_memcpy_d2s_partial(handle, pI8, tensor->device_mem, tensor_size);
+		assert(BM_SUCCESS == ret);
+	}
+	return pI8;
+}
+
+/**
+ * @name    get_candidates
+ * @brief   collect boxes whose class confidence passes conf_thresh.
+ *          T is float (scale = 1) or int8_t, in which case conf_thresh is already quantized
+ *          and only the passing values are dequantized.
+ */
+template <typename T>
+void YoloV8_det::get_candidates(const T* batch_data_box, float scale, float conf_thresh, int box_num, int nout,
+	YoloV8BoxVec& yolobox_vec) {
+	int offset = is_output_transposed ? 1 : box_num;
+	for (int i = 0; i < box_num; i++) {
+		int box_index = is_output_transposed ? i * nout : i;
+		//transposed output_tensor's last dim: [x, y, w, h, cls_conf0, ..., cls_conf14, rotate_angle]
+		const T* cls_conf = batch_data_box + box_index + 4 * offset;
+#if USE_MULTICLASS_NMS
+		// multilabel
+		for (int j = 0; j < m_class_num; j++) {
+			T cur_value = cls_conf[j * offset];
+			if (cur_value > conf_thresh) {
+				YoloV8Box box;
+				box.score = cur_value * scale;
+				box.class_id = j;
+				float centerX = batch_data_box[box_index] * scale;
+				float centerY = batch_data_box[box_index + 1 * offset] * scale;
+				float width = batch_data_box[box_index + 2 * offset] * scale;
+				float height = batch_data_box[box_index + 3 * offset] * scale;
+
+				int c = agnostic ? 0 : box.class_id * max_wh;
+				box.x1 = centerX - width / 2 + c;
+				box.y1 = centerY - height / 2 + c;
+				box.x2 = box.x1 + width;
+				box.y2 = box.y1 + height;
+				yolobox_vec.push_back(box);
+			}
+		}
+#else
+		// best class
+		T max_value = 0;
+		int max_index = 0;
+		for (int j = 0; j < m_class_num; j++) {
+			T cur_value = cls_conf[j * offset];
+			if (cur_value > max_value) {
+				max_value = cur_value;
+				max_index = j;
+			}
+		}
+		if (max_value <= conf_thresh) {
+			continue;
+		}
+		YoloV8Box box;
+		box.class_id = max_index;
+		box.score = max_value * scale;
+		int c = agnostic ? 0 : box.class_id * max_wh;
+		float centerX = batch_data_box[box_index] * scale;
+		float centerY = batch_data_box[box_index + 1 * offset] * scale;
+		float width = batch_data_box[box_index + 2 * offset] * scale;
+		float height = batch_data_box[box_index + 3 * offset] * scale;
+		box.x1 = centerX - width / 2 + c;
+		box.y1 = centerY - height / 2 + c;
+		box.x2 = box.x1 + width;
+		box.y2 = box.y1 + height;
+		yolobox_vec.push_back(box);
+#endif
+	}
+}
 
 int YoloV8_det::post_process(const std::vector<bm_image>& input_images,
 	std::vector<bm_tensor_t>& output_tensors,
@@ -304,86 +415,41 @@ int YoloV8_det::post_process(const std::vector<bm_image>& input_images,
 	const std::vector<std::pair<float, float>>& ratios_batch,
 	std::vector<YoloV8BoxVec>& detected_boxes) {
 	float* data_box = NULL;
+	int8_t* data_box_int8 = NULL;
+	float box_scale = 1.f;
 	bm_tensor_t tensor_box;
 	for (int i = 0; i < output_tensors.size(); i++) {
 		if (output_tensors[i].shape.num_dims == 3) {
 			tensor_box = output_tensors[i];
-			data_box = get_cpu_data(&output_tensors[i], netinfo->output_scales[i]);
+			box_scale = netinfo->output_scales[i];
+			// int8 heads are thresholded on raw values, only the survivors get dequantized
+			if (output_tensors[i].dtype == BM_INT8)
+				data_box_int8 = get_cpu_int8_data(&output_tensors[i]);
+			else
+				data_box = get_cpu_data(&output_tensors[i], box_scale);
 		}
 	}
 
-	for (int batch_idx = 0; batch_idx < input_images.size(); ++batch_idx) {
-		YoloV8BoxVec yolobox_vec;
+	// images are decoded and NMS'd independently, each worker reuses its own box buffer
+	size_t base = detected_boxes.size();
+	detected_boxes.resize(base + input_images.size());
+	m_post_pool->parallel_for(input_images.size(), [&](int batch_idx, int worker_id) {
+		YoloV8BoxVec& yolobox_vec = m_post_scratch[worker_id];
+		yolobox_vec.clear();
 		auto& frame = input_images[batch_idx];
 		int frame_width = frame.width;
 		int frame_height = frame.height;
 
 		int box_num = is_output_transposed ? tensor_box.shape.dims[1] : tensor_box.shape.dims[2];
 		int nout = is_output_transposed ? tensor_box.shape.dims[2] : tensor_box.shape.dims[1];
-		float* batch_data_box = data_box + batch_idx * box_num * nout; //output_tensor: [bs, box_num, class_num + 5]
-		int offset = is_output_transposed ? 1 : box_num;
-
-		// Candidates
-		for (int i = 0; i < box_num; i++) {
-			int box_index = is_output_transposed ? i * nout : i;
-			//transposed output_tensor's last dim: [x, y, w, h, cls_conf0, ..., cls_conf14, rotate_angle]
-			float* cls_conf = batch_data_box + box_index + 4 * offset;
-#if USE_MULTICLASS_NMS
-			// multilabel
-			for (int j = 0; j < m_class_num; j++) {
-				float cur_value = cls_conf[j * offset];
-				if (cur_value > m_confThreshold) {
-					YoloV8Box box;
-					box.score = cur_value;
-					box.class_id = j;
-					float centerX = batch_data_box[box_index];
-					float centerY = batch_data_box[box_index + 1 * offset];
-					float width = batch_data_box[box_index + 2 * offset];
-					float height = batch_data_box[box_index + 3 * offset];
-
-					int c = agnostic ? 0 : box.class_id * max_wh;
-					box.x1 = centerX - width / 2 + c;
-					box.y1 = centerY - height / 2 + c;
-					box.x2 = box.x1 + width;
-					box.y2 = box.y1 + height;
-					yolobox_vec.push_back(box);
-				}
-			}
-#else
-			// best class
-			YoloV8Box box;
-			if (is_output_transposed) {
-				box.class_id = argmax(batch_data_box + box_index + 4, m_class_num);
-				box.score = batch_data_box[box_index + 4 + box.class_id];
-			}
-			else {
-				float max_value = 0.0;
-				int max_index = 0;
-				for (int j = 0; j < m_class_num; j++) {
-					float cur_value = cls_conf[i + j * box_num];
-					if (cur_value > max_value) {
-						max_value = cur_value;
-						max_index = j;
-					}
-				}
-				box.class_id = max_index;
-				box.score = max_value;
-			}
-
-			if (box.score <= m_confThreshold) {
-				continue;
-			}
-			int c = agnostic ? 0 : box.class_id * max_wh;
-			float centerX = batch_data_box[box_index];
-			float centerY = batch_data_box[box_index + 1 * offset];
-			float width = batch_data_box[box_index + 2 * offset];
-			float height = batch_data_box[box_index + 3 * offset];
-			box.x1 = centerX - width / 2 + c;
-			box.y1 = centerY - height / 2 + c;
-			box.x2 = box.x1 + width;
-			box.y2 = box.y1 + height;
-			yolobox_vec.push_back(box);
-#endif
+		//output_tensor: [bs, box_num, class_num + 5]
+		if (data_box_int8 != NULL) {
+			// x * scale > t <=> x > floor(t / scale)
+			float quant_thresh = std::floor(m_confThreshold / box_scale);
+			get_candidates(data_box_int8 + batch_idx * box_num * nout, box_scale, quant_thresh, box_num, nout, yolobox_vec);
+		}
+		else {
+			get_candidates(data_box + batch_idx * box_num * nout, 1.f, m_confThreshold, box_num, nout, yolobox_vec);
 		}
 		NMS(yolobox_vec, m_nmsThreshold);
 
@@ -414,13 +480,23 @@ int YoloV8_det::post_process(const std::vector<bm_image>& input_images,
 			yolobox_vec[i].y2 = std::round((yolobox_vec[i].y2 - ty1) * inv_ratio_y);
 		}
 		clip_boxes(yolobox_vec, frame_width, frame_height);
-		detected_boxes.push_back(yolobox_vec);
-	}
+		detected_boxes[base + batch_idx].assign(yolobox_vec.begin(), yolobox_vec.end());
+	});
 
 	for (int i = 0; i < output_tensors.size(); i++) {
 		float* tensor_data = NULL;
 		if (output_tensors[i].shape.num_dims == 3) {
 			tensor_data = data_box;
+			if (data_box_int8 != NULL) {
+				if (misc_info.pcie_soc_mode == 1) { // soc
+					int tensor_size = bm_mem_get_device_size(output_tensors[i].device_mem);
+					bm_status_t ret = bm_mem_unmap_device_mem(handle, data_box_int8, tensor_size);
+					assert(BM_SUCCESS == ret);
+				}
+				else {
+					delete[] data_box_int8;
+				}
+			}
 		}
 
 		if (misc_info.pcie_soc_mode == 1) { // soc
@@ -12,12 +12,16 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include "opencv2/opencv.hpp"
+#include "bmnn_utils.h"
 #include "utils.hpp"
 // Define USE_OPENCV for enabling OPENCV related funtions in bm_wrapper.hpp
 #define USE_OPENCV 1
 #include "bm_wrapper.hpp"
+#include "bm_image_pool.hpp"
+#include "worker_pool.hpp"
 #define DEBUG 0
 
 struct YoloV8Box {
@@ -29,6 +33,8 @@ struct YoloV8Box {
 using YoloV8BoxVec = std::vector<YoloV8Box>;
 
 class YoloV8_det {
+	// owns the device handle and runtime, possibly shared with other models
+	std::shared_ptr<BMNNContext> m_bmContext;
 	bm_handle_t handle;
 	void* bmrt = NULL;
 	const bm_net_info_t* netinfo = NULL;
@@ -48,14 +54,28 @@ class YoloV8_det {
 	TimeStamp tmp_ts;
 	bool is_output_transposed = true;
 
+	// preprocess buffers, allocated once for the largest stage
+	std::vector<bm_image> m_resized_imgs;
+	std::vector<bm_image> m_converto_imgs;
+	std::unique_ptr<BMImagePool> m_staging_pool;
+	// per-image post processing workers and their box buffers
+	std::unique_ptr<WorkerPool> m_post_pool;
+	std::vector<YoloV8BoxVec> m_post_scratch;
+
 private:
 
+	void init_buffers();
 	int pre_process(const std::vector<bm_image>& images,
 		bm_tensor_t& input_tensor,
 		std::vector<std::pair<int, int>>& txy_batch,
 		std::vector<std::pair<float, float>>& ratios_batch);
+	int get_stage_index(int real_batch);
 	int forward(bm_tensor_t& input_tensor, std::vector<bm_tensor_t>& output_tensors);
 	float* get_cpu_data(bm_tensor_t* tensor, float scale);
+	int8_t* get_cpu_int8_data(bm_tensor_t* tensor);
+	template <typename T>
+	void get_candidates(const T* batch_data_box, float scale, float conf_thresh, int box_num, int nout,
+		YoloV8BoxVec& yolobox_vec);
 	int post_process(const std::vector<bm_image>& input_images,
 		std::vector<bm_tensor_t>& output_tensors,
 		const std::vector<std::pair<int, int>>& txy_batch,
@@ -72,7 +92,13 @@ public:
 	int batch_size = -1;
 	TimeStamp* m_ts = NULL;
 
-	YoloV8_det(std::string bmodel_file, std::string coco_names_file, int dev_id = 0, float confThresh = 0.25, float nmsThresh = 0.7) {
+	YoloV8_det(std::string bmodel_file, std::string coco_names_file, int dev_id = 0, float confThresh = 0.25, float nmsThresh = 0.7)
+		: YoloV8_det(std::make_shared<BMNNContext>(std::make_shared<BMNNHandle>(dev_id), bmodel_file.c_str()),
+			coco_names_file, confThresh, nmsThresh) {}
+
+	// runs on the handle and runtime of context, which already holds the bmodel
+	YoloV8_det(std::shared_ptr<BMNNContext> context, std::string coco_names_file = "", float confThresh = 0.25, float nmsThresh = 0.7)
+		: m_bmContext(context) {
 		std::ifstream ifs(coco_names_file);
 		if (ifs.is_open()) {
 			std::string line;
@@ -86,38 +112,28 @@ public:
 		m_confThreshold = confThresh;
 		m_nmsThreshold = nmsThresh;
 
-		// get handle
-		auto ret = bm_dev_request(&handle, dev_id);
-		assert(BM_SUCCESS == ret);
+		handle = m_bmContext->handle();
+		bmrt = m_bmContext->bmrt();
 
 		// judge now is pcie or soc
-		ret = bm_get_misc_info(handle, &misc_info);
+		auto ret = bm_get_misc_info(handle, &misc_info);
 		assert(BM_SUCCESS == ret);
 
-		// create bmrt
-		bmrt = bmrt_create(handle);
-		if (!bmrt_load_bmodel(bmrt, bmodel_file.c_str())) {
-			std::cout << "load bmodel(" << bmodel_file << ") failed" << std::endl;
-		}
-
 		// get network names from bmodel
-		const char** names;
 		int num = bmrt_get_network_number(bmrt);
 		if (num > 1) {
 			std::cout << "This bmodel have " << num << " networks, and this program will only take network 0." << std::endl;
 		}
-
-		bmrt_get_network_names(bmrt, &names);
 		for (int i = 0; i < num; ++i) {
-			network_names.push_back(names[i]);
+			network_names.push_back(m_bmContext->network_name(i));
 		}
 
 		// get netinfo by netname
 		netinfo = bmrt_get_network_info(bmrt, network_names[0].c_str());
-		if (netinfo->stage_num > 1) {
-			std::cout << "This bmodel have " << netinfo->stage_num << " stages, and this program will only take stage 0." << std::endl;
+		// batch_size is the largest stage, each Detect runs on the smallest stage that fits
+		for (int s = 0; s < netinfo->stage_num; s++) {
+			batch_size = std::max(batch_size, netinfo->stages[s].input_shapes[0].dims[0]);
 		}
-		batch_size = netinfo->stages[0].input_shapes[0].dims[0];
 		m_net_h = netinfo->stages[0].input_shapes[0].dims[2];
 		m_net_w = netinfo->stages[0].input_shapes[0].dims[3];
 
@@ -146,13 +162,15 @@ public:
 
 		// set temp timestamp
 		m_ts = &tmp_ts;
+
+		init_buffers();
 	}
 	~YoloV8_det() {
-		if (bmrt != NULL) {
-			bmrt_destroy(bmrt);
-			bmrt = NULL;
-		}
-		bm_dev_free(handle);
+		// staging images are freed through handle, release them before the context
+		m_post_pool.reset();
+		m_staging_pool.reset();
+		bm_image_destroy_batch(m_resized_imgs.data(), batch_size);
+		bm_image_destroy_batch(m_converto_imgs.data(), batch_size);
 	};
 	int Detect(const std::vector<bm_image>& images, std::vector<YoloV8BoxVec>& boxes);
 	void draw_result(cv::Mat& img, YoloV8BoxVec& result);